@@ -0,0 +1,187 @@
+/*arena.c*/
+
+//
+// Scratch arena for the nuPython executor.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+// to eliminate warnings about stdlib in Visual Studio
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>  // true, false
+#include <stddef.h>   // max_align_t
+
+#include "arena.h"
+#include "quota.h"
+#include "output.h"
+
+
+//
+// Private functions:
+//
+
+//
+// panic
+//
+// Outputs the given error message and exits.
+//
+static void panic(char* msg)
+{
+  output_flush();
+
+  printf("**ARENA ERROR\n");
+  printf("**ARENA ERROR: %s\n", msg);
+  printf("**ARENA ERROR\n");
+  exit(-1);
+}
+
+//
+// align_up
+//
+// Rounds the given size up to a multiple of the strictest
+// alignment, so every allocation is suitably aligned.
+//
+static size_t align_up(size_t size)
+{
+  size_t align = sizeof(max_align_t);
+
+  return (size + align - 1) & ~(align - 1);
+}
+
+//
+// block_size
+//
+// Returns the total # of bytes allocated for a block
+// with the given capacity.
+//
+static size_t block_size(size_t capacity)
+{
+  return sizeof(struct ARENA_BLOCK) + capacity;
+}
+
+//
+// new_block
+//
+// Allocates a block with room for the given # of bytes.
+//
+static struct ARENA_BLOCK* new_block(size_t capacity, struct ARENA_BLOCK* next)
+{
+  struct ARENA_BLOCK* block = (struct ARENA_BLOCK*)malloc(block_size(capacity));
+  if (block == NULL)
+    panic("out of memory (arena)");
+
+  block->next = next;
+  block->capacity = capacity;
+
+  return block;
+}
+
+
+//
+// Public functions:
+//
+
+//
+// arena_create
+//
+struct ARENA* arena_create(size_t capacity)
+{
+  struct ARENA* arena = (struct ARENA*)malloc(sizeof(struct ARENA));
+  if (arena == NULL)
+    panic("out of memory (arena_create)");
+
+  capacity = align_up(capacity);
+
+  arena->blocks = new_block(capacity, NULL);
+  arena->used = 0;
+  arena->charged = 0;
+
+  return arena;
+}
+
+//
+// arena_destroy
+//
+void arena_destroy(struct ARENA* arena)
+{
+  if (arena == NULL)
+    panic("arena ptr is null (arena_destroy)");
+
+  struct ARENA_BLOCK* block = arena->blocks;
+
+  while (block != NULL) {
+    struct ARENA_BLOCK* next = block->next;
+    free(block);
+    block = next;
+  }
+
+  quota_release(arena->charged);
+  free(arena);
+}
+
+//
+// arena_alloc
+//
+void* arena_alloc(struct ARENA* arena, size_t size)
+{
+  if (!quota_charge(size))
+    return NULL;
+
+  arena->charged += size;
+
+  size = align_up(size);
+
+  if (arena->used + size > arena->blocks->capacity) {
+    //
+    // current block is full, start a new one that is at
+    // least twice as big:
+    //
+    size_t capacity = 2 * arena->blocks->capacity;
+
+    if (capacity < size)
+      capacity = size;
+
+    arena->blocks = new_block(capacity, arena->blocks);
+    arena->used = 0;
+  }
+
+  void* p = arena->blocks->data + arena->used;
+
+  arena->used += size;
+
+  return p;
+}
+
+//
+// arena_reset
+//
+void arena_reset(struct ARENA* arena)
+{
+  if (arena->blocks->next != NULL) {
+    //
+    // we overflowed into more than one block; replace them
+    // all with one block that can hold everything:
+    //
+    size_t capacity = 0;
+    struct ARENA_BLOCK* block = arena->blocks;
+
+    while (block != NULL) {
+      struct ARENA_BLOCK* next = block->next;
+      capacity += block->capacity;
+      free(block);
+      block = next;
+    }
+
+    arena->blocks = new_block(capacity, NULL);
+  }
+
+  quota_release(arena->charged);
+
+  arena->used = 0;
+  arena->charged = 0;
+}
@@ -0,0 +1,80 @@
+/*arena.h*/
+
+//
+// Scratch arena for the nuPython executor. Temporaries that
+// need memory while a statement executes (e.g. the result of
+// a string concatenation) are allocated from the arena, and
+// the arena is reset once the statement is done. Nothing is
+// freed individually.
+//
+// The arena keeps its memory between resets, so once it has
+// grown large enough for the biggest statement, execution no
+// longer calls malloc at all.
+//
+// What is allocated from the arena is charged against the
+// memory quota (see quota.h), byte for byte, until the arena
+// is reset; the blocks it keeps between resets are not.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+#pragma once
+
+#include <stddef.h>  // size_t
+
+
+struct ARENA_BLOCK
+{
+  struct ARENA_BLOCK* next;  // next (older) block, or NULL
+  size_t capacity;           // # of bytes available in data[]
+  char   data[];
+};
+
+struct ARENA
+{
+  struct ARENA_BLOCK* blocks;  // current block, newest first
+  size_t used;                 // # of bytes used in current block
+  size_t charged;              // # of bytes charged since the last reset
+};
+
+
+//
+// Public functions:
+//
+
+//
+// arena_create
+//
+// Returns a pointer to a dynamically-allocated arena with
+// an initial capacity of the given # of bytes.
+//
+struct ARENA* arena_create(size_t capacity);
+
+//
+// arena_destroy
+//
+// Frees all the memory associated with the given arena.
+//
+void arena_destroy(struct ARENA* arena);
+
+//
+// arena_alloc
+//
+// Returns a pointer to the given # of bytes in the arena,
+// suitably aligned for any type. The memory remains valid
+// until the next call to arena_reset(). Returns NULL if the
+// allocation would exceed the memory quota.
+//
+void* arena_alloc(struct ARENA* arena, size_t size);
+
+//
+// arena_reset
+//
+// Releases everything allocated from the arena (and its
+// charge against the quota). If the arena had to grow since
+// the last reset, its blocks are merged into one block big
+// enough to hold all of it.
+//
+void arena_reset(struct ARENA* arena);
@@ -0,0 +1,6 @@
+x = 1
+p = &x
+q = p + 5
+print(x)
+y = *q
+print(y)
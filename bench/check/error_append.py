@@ -0,0 +1,5 @@
+s = "a"
+x = 1
+x = x + 0.5
+s = s + x
+print(s)
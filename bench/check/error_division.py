@@ -0,0 +1,10 @@
+print("before")
+x = 7
+y = 0
+i = 0
+while i < 3:
+{
+  i = i + 1
+}
+z = x / y
+print(z)
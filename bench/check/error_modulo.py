@@ -0,0 +1,5 @@
+print("before")
+x = 7
+y = 0
+z = x % y
+print(z)
@@ -0,0 +1,3 @@
+x = "a"
+y = x + 1
+print(y)
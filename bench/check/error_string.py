@@ -0,0 +1,2 @@
+x = int("abc")
+print(x)
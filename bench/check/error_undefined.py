@@ -0,0 +1,3 @@
+x = 1
+y = z + 1
+print(y)
@@ -0,0 +1,22 @@
+a = 17
+b = 5
+c = a / b
+print(c)
+c = a % b
+print(c)
+m = 0 - 2147483647
+m = m - 1
+n = 0 - 1
+q = m / n
+print(q)
+r = m % n
+print(r)
+d = 0 - 17
+e = d / b
+print(e)
+e = d % b
+print(e)
+x = "s"
+x = 9
+x = x / 2
+print(x)
@@ -0,0 +1,38 @@
+x = 1
+i = 0
+while i < 3:
+{
+  x = x + 0.5
+  i = i + 1
+}
+print(x)
+a = 1
+b = 2.5
+j = 0
+while j < 3:
+{
+  a = a + b
+  j = j + 1
+}
+print(a)
+c = 3 / 2.0
+print(c)
+d = 2 ** 0.5
+print(d)
+f = 7 == 7.0
+print(f)
+s = "ab"
+s = s + "cd"
+print(s)
+t = s < "b"
+print(t)
+u = s == "abcd"
+print(u)
+v = "x"
+v = 1
+v = v + 2
+print(v)
+w = input("")
+n = int(w)
+n = n * 3
+print(n)
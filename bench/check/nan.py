@@ -0,0 +1,7 @@
+v = 5 % 0.0
+print(v)
+w = 0.0 / 0.0
+print(w)
+x = 1.5
+y = x * v
+print(y)
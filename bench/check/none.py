@@ -0,0 +1,5 @@
+x = print(3)
+y = x
+print("y is None")
+z = y == x
+print(z)
@@ -0,0 +1,27 @@
+x = 10
+y = 20
+p = &x
+q = &y
+a = *p
+print(a)
+b = *q + 1
+print(b)
+r = p + 1
+c = *r
+print(c)
+print()
+*p = 2.5
+print(x)
+print()
+*q = "str"
+print(y)
+s = "a"
+t = &s
+i = 0
+while i < 3:
+{
+  s = s + "b"
+  i = i + 1
+}
+u = *t
+print(u)
@@ -0,0 +1,15 @@
+x = 1
+while x < 3:
+{
+  x = x + 0.5
+}
+print(x)
+b = 2.5
+a = b
+while a < 10:
+{
+  a = a + b
+}
+print(a)
+s = "q"
+s = s + b
@@ -0,0 +1,29 @@
+x = 1.5
+y = 0.25
+z = x + y
+print(z)
+z = x - y
+print(z)
+z = x * y
+print(z)
+z = x / y
+print(z)
+z = x ** y
+print(z)
+z = x % y
+print(z)
+b = x < y
+print(b)
+b = x >= y
+print(b)
+i = 0
+r = 0.0
+while i < 10:
+{
+  r = r + 0.1
+  i = i + 1
+}
+print(r)
+t = 7.5
+t = t % 2
+print(t)
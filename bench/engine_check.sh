@@ -0,0 +1,80 @@
+#!/bin/sh
+#
+# engine_check.sh
+#
+# Checks the execution engines against each other. Each nuPython
+# program is run by every engine (--engine=tree, vm, closure and
+# ssa), with no memory quota and with one (--quota), and each
+# output must be the same as the tree engine's. A run that takes
+# longer than the time limit fails too, so an update in place
+# that goes quadratic (s = s + t on a string that lives in
+# memory, say) is caught. A program reads its input, if any,
+# from the file of the same name ending in .in.
+#
+# Build nupy first, then run from the repository root:
+#
+#   sh bench/engine_check.sh [program.py ...]
+#
+# The programs default to bench/*.py and bench/check/*.py. The
+# interpreter is ./nupy, or $NUPY; the quota is $QUOTA bytes
+# (default 1000000000), and the time limit $LIMIT seconds
+# (default 5).
+#
+# NOTE: the high-water mark output with a quota can differ
+# between engines (see ssa.h), so it isn't compared.
+#
+# Hajo Wolfram
+# Northwestern University
+# CS 211
+#
+
+NUPY=${NUPY:-./nupy}
+QUOTA=${QUOTA:-1000000000}
+LIMIT=${LIMIT:-5}
+
+if [ $# -eq 0 ]; then
+  set -- bench/*.py bench/check/*.py
+fi
+
+work=$(mktemp -d) || exit 1
+trap 'rm -rf "$work"' EXIT
+
+failed=0
+checked=0
+
+for program in "$@"; do
+  input=${program%.py}.in
+  [ -f "$input" ] || input=/dev/null
+
+  for quota in "" "--quota=$QUOTA"; do
+    checked=$((checked + 1))
+
+    for engine in tree vm closure ssa; do
+      timeout "$LIMIT" "$NUPY" --engine=$engine $quota "$program" < "$input" > "$work/$engine.log" 2>&1
+
+      #
+      # timeout exits with 124 when the time limit is reached:
+      #
+      if [ $? -eq 124 ]; then
+        echo "FAILED (time): $program --engine=$engine $quota"
+        failed=$((failed + 1))
+        continue 2
+      fi
+
+      grep -av 'HIGH-WATER MARK' "$work/$engine.log" > "$work/$engine"
+    done
+
+    for engine in vm closure ssa; do
+      if ! cmp -s "$work/tree" "$work/$engine"; then
+        echo "FAILED (output): $program --engine=$engine $quota"
+        diff "$work/tree" "$work/$engine" | head -10
+        failed=$((failed + 1))
+        continue 2
+      fi
+    done
+  done
+done
+
+echo "$checked checked, $failed failed"
+
+[ $failed -eq 0 ]
@@ -0,0 +1,200 @@
+/*format_bench.c*/
+
+//
+// Benchmark: formatting numbers with format_int / format_real
+// vs. snprintf("%d") / snprintf("%lf"), for several kinds of
+// values. Each value is formatted both ways and the results
+// compared, so the benchmark doubles as a check that the two
+// agree.
+//
+// Build and run from the repository root:
+//
+//   gcc -O2 -I. bench/format_bench.c format.c -lm
+//   ./a.out [N]
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+// to eliminate warnings about stdlib in Visual Studio
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "format.h"
+
+
+//
+// seconds
+//
+// Returns a monotonic timestamp in seconds.
+//
+static double seconds(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//
+// random_bits
+//
+// Returns 64 pseudo-random bits (xorshift64*), the same ones
+// every run.
+//
+static uint64_t random_bits(void)
+{
+  static uint64_t state = 0x9E3779B97F4A7C15ULL;
+
+  state ^= state >> 12;
+  state ^= state << 25;
+  state ^= state >> 27;
+
+  return state * 0x2545F4914F6CDD1DULL;
+}
+
+//
+// uniform
+//
+// Returns a pseudo-random real in [0, 1).
+//
+static double uniform(void)
+{
+  return (random_bits() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+
+//
+// The kinds of values:
+//
+static int small_int(int i)   { return (int)(random_bits() % 100); }
+static int medium_int(int i)  { return (int)(random_bits() % 1000000); }
+static int any_int(int i)     { return (int)(uint32_t)random_bits(); }
+
+static double unit_real(int i)   { return uniform(); }
+static double money_real(int i)  { return (double)(random_bits() % 100000000) / 100.0; }
+static double wide_real(int i)   { return (uniform() - 0.5) * pow(10.0, 18.0 * uniform() - 8.0); }
+static double whole_real(int i)  { return (double)(int)(uint32_t)random_bits(); }
+static double tie_real(int i)    { return (double)(random_bits() % 1000000) / 128.0; }  // m + j/128: exact ties
+
+//
+// A random bit pattern: any finite real, including huge and
+// subnormal ones:
+//
+static double bits_real(int i)
+{
+  double d;
+
+  do {
+    uint64_t bits = random_bits();
+    memcpy(&d, &bits, sizeof(d));
+  } while (!isfinite(d));
+
+  return d;
+}
+
+
+//
+// bench_ints
+//
+static void bench_ints(char* name, int (*generate)(int), int N)
+{
+  int* values = (int*)malloc(sizeof(int) * N);
+  char expected[FORMAT_INT_SIZE];
+  char got[FORMAT_INT_SIZE];
+  int mismatches = 0;
+  size_t sink = 0;
+
+  for (int i = 0; i < N; i++)
+    values[i] = generate(i);
+
+  for (int i = 0; i < N; i++) {
+    snprintf(expected, sizeof(expected), "%d", values[i]);
+    format_int(got, values[i]);
+
+    if (strcmp(expected, got) != 0 && mismatches++ == 0)
+      printf("  MISMATCH: %s vs %s\n", expected, got);
+  }
+
+  double start = seconds();
+  for (int i = 0; i < N; i++)
+    sink += snprintf(expected, sizeof(expected), "%d", values[i]);
+  double libc_time = seconds() - start;
+
+  start = seconds();
+  for (int i = 0; i < N; i++)
+    sink += format_int(got, values[i]);
+  double format_time = seconds() - start;
+
+  printf("%-12s %8.1f ns %8.1f ns %6.1fx   %d mismatches (%zu)\n", name,
+    libc_time / N * 1e9, format_time / N * 1e9, libc_time / format_time, mismatches, sink % 10);
+
+  free(values);
+}
+
+//
+// bench_reals
+//
+static void bench_reals(char* name, double (*generate)(int), int N)
+{
+  double* values = (double*)malloc(sizeof(double) * N);
+  char expected[FORMAT_REAL_SIZE];
+  char got[FORMAT_REAL_SIZE];
+  int mismatches = 0;
+  size_t sink = 0;
+
+  for (int i = 0; i < N; i++)
+    values[i] = generate(i);
+
+  for (int i = 0; i < N; i++) {
+    snprintf(expected, sizeof(expected), "%lf", values[i]);
+    format_real(got, values[i]);
+
+    if (strcmp(expected, got) != 0 && mismatches++ == 0)
+      printf("  MISMATCH: %s vs %s (%a)\n", expected, got, values[i]);
+  }
+
+  double start = seconds();
+  for (int i = 0; i < N; i++)
+    sink += snprintf(expected, sizeof(expected), "%lf", values[i]);
+  double libc_time = seconds() - start;
+
+  start = seconds();
+  for (int i = 0; i < N; i++)
+    sink += format_real(got, values[i]);
+  double format_time = seconds() - start;
+
+  printf("%-12s %8.1f ns %8.1f ns %6.1fx   %d mismatches (%zu)\n", name,
+    libc_time / N * 1e9, format_time / N * 1e9, libc_time / format_time, mismatches, sink % 10);
+
+  free(values);
+}
+
+
+int main(int argc, char* argv[])
+{
+  int N = (argc > 1) ? atoi(argv[1]) : 1000000;
+
+  printf("%-12s %11s %11s %7s\n", "values", "snprintf", "format", "speedup");
+
+  bench_ints("small int", small_int, N);
+  bench_ints("medium int", medium_int, N);
+  bench_ints("any int", any_int, N);
+
+  bench_reals("[0, 1)", unit_real, N);
+  bench_reals("money", money_real, N);
+  bench_reals("wide", wide_real, N);
+  bench_reals("whole", whole_real, N);
+  bench_reals("ties", tie_real, N);
+  bench_reals("any bits", bits_real, N);
+
+  return 0;
+}
@@ -0,0 +1,147 @@
+/*snapshot_bench.c*/
+
+//
+// Benchmark: restoring memory from a snapshot vs. re-executing
+// the initialization section of a program. The initialization
+// section assigns N variables (ints, reals and strings); each
+// trial either executes it from scratch into a fresh memory,
+// or restores a snapshot taken after it ran once.
+//
+// Build and run from the repository root:
+//
+//   gcc -O2 -I. bench/snapshot_bench.c snapshot.c execute.c runtime.c vm.c jit.c closure.c ssa.c escape.c walk.c builtins.c arena.c quota.c output.c format.c scanner.c compiler.o -lm
+//   ./a.out [N] [trials]
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+// to eliminate warnings about stdlib in Visual Studio
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "parser.h"
+#include "programgraph.h"
+#include "ram.h"
+#include "execute.h"
+#include "snapshot.h"
+
+
+//
+// seconds
+//
+// Returns a monotonic timestamp in seconds.
+//
+static double seconds(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+//
+// write_init_section
+//
+// Writes a nuPython program that initializes N variables.
+//
+static void write_init_section(FILE* output, int N)
+{
+  for (int i = 0; i < N; i++) {
+    switch (i % 3) {
+    case 0:
+      fprintf(output, "v%d = %d\n", i, i);
+      break;
+    case 1:
+      fprintf(output, "v%d = %d.5\n", i, i);
+      break;
+    default:
+      fprintf(output, "v%d = 'value number %d'\n", i, i);
+      break;
+    }
+  }
+
+  fprintf(output, "$\n");
+}
+
+
+int main(int argc, char* argv[])
+{
+  int N = (argc > 1) ? atoi(argv[1]) : 1000;
+  int trials = (argc > 2) ? atoi(argv[2]) : 100;
+
+  FILE* input = tmpfile();
+  if (input == NULL) {
+    printf("**ERROR: unable to create temporary file.\n");
+    return 0;
+  }
+
+  write_init_section(input, N);
+  rewind(input);
+
+  parser_init();
+
+  struct TokenQueue* tokens = parser_parse(input);
+  if (tokens == NULL)
+    return 0;
+
+  struct STMT* program = programgraph_build(tokens);
+
+  //
+  // re-executing the initialization section:
+  //
+  double start = seconds();
+
+  for (int t = 0; t < trials; t++) {
+    struct RAM* memory = ram_init();
+    execute(program, memory);
+    ram_destroy(memory);
+  }
+
+  double execute_time = (seconds() - start) / trials;
+
+  //
+  // restoring from a snapshot; the memory is dirtied
+  // between trials so each restore has work to do:
+  //
+  struct RAM* memory = ram_init();
+  execute(program, memory);
+
+  struct RAM_SNAPSHOT* snapshot = ram_snapshot(memory);
+
+  struct RAM_VALUE dirty;
+  dirty.value_type = RAM_TYPE_INT;
+  dirty.types.i = -1;
+
+  double restore_time = 0.0;
+
+  for (int t = 0; t < trials; t++) {
+    for (int i = 0; i < memory->num_values; i += 2)
+      ram_write_cell_by_addr(memory, dirty, i);
+
+    start = seconds();
+    ram_restore(memory, snapshot);
+    restore_time += seconds() - start;
+  }
+
+  restore_time /= trials;
+
+  printf("variables:        %d\n", N);
+  printf("snapshot size:    %zu bytes\n", snapshot->size);
+  printf("re-execute init:  %10.1f us\n", execute_time * 1e6);
+  printf("restore snapshot: %10.1f us\n", restore_time * 1e6);
+  printf("speedup:          %10.1fx\n", execute_time / restore_time);
+
+  ram_snapshot_destroy(snapshot);
+  ram_destroy(memory);
+  programgraph_destroy(program);
+  tokenqueue_destroy(tokens);
+  fclose(input);
+
+  return 0;
+}
@@ -0,0 +1,9 @@
+s = ""
+i = 0
+while i < 100000:
+{
+  s = s + "abcdefgh"
+  i = i + 1
+}
+n = len(s)
+print(n)
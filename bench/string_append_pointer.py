@@ -0,0 +1,11 @@
+s = ""
+p = &s
+i = 0
+while i < 100000:
+{
+  s = s + "abcdefgh"
+  i = i + 1
+}
+t = *p
+n = len(t)
+print(n)
@@ -0,0 +1,92 @@
+#!/bin/sh
+#
+# transpile_check.sh
+#
+# Checks the transpiler against the interpreter. Each nuPython
+# program is run by nupy, and also transpiled (--transpile),
+# compiled with -Wall -Werror and run; the two outputs must be
+# the same. A program reads its input, if any, from the file of
+# the same name ending in .in (e.g. prog.in for prog.py).
+#
+# Build nupy first, then run from the repository root:
+#
+#   sh bench/transpile_check.sh [program.py ...]
+#
+# The programs default to bench/*.py and bench/check/*.py
+# (reals, mixed types, pointers and errors). The interpreter
+# is ./nupy, or $NUPY; the C compiler is cc, or $CC.
+#
+# Hajo Wolfram
+# Northwestern University
+# CS 211
+#
+
+NUPY=${NUPY:-./nupy}
+CC=${CC:-cc}
+
+if [ $# -eq 0 ]; then
+  set -- bench/*.py bench/check/*.py
+fi
+
+work=$(mktemp -d) || exit 1
+trap 'rm -rf "$work"' EXIT
+
+#
+# output: what the program output when nupy ran it, the lines
+# between **executing... and **done (an error message isn't
+# followed by a newline, so **done can end the last line):
+#
+output()
+{
+  awk '
+    /^\*\*done/ { running = 0 }
+    running && /\*\*done$/ { sub(/\*\*done$/, ""); print; running = 0 }
+    running { print }
+    /^\*\*executing\.\.\.$/ { running = 1 }
+  '
+}
+
+failed=0
+checked=0
+
+for program in "$@"; do
+  checked=$((checked + 1))
+
+  input=${program%.py}.in
+  [ -f "$input" ] || input=/dev/null
+
+  name=$(basename "$program" .py)
+
+  "$NUPY" --transpile="$work/$name.c" "$program" > "$work/$name.log" 2>&1
+
+  if [ ! -s "$work/$name.c" ]; then
+    echo "FAILED (transpile): $program"
+    grep '^\*\*.*ERROR' "$work/$name.log"
+    failed=$((failed + 1))
+    continue
+  fi
+
+  if ! "$CC" -O2 -Wall -Werror -o "$work/$name" "$work/$name.c" -lm 2> "$work/$name.err"; then
+    echo "FAILED (compile): $program"
+    cat "$work/$name.err"
+    failed=$((failed + 1))
+    continue
+  fi
+
+  "$NUPY" "$program" < "$input" 2>&1 | output > "$work/$name.expected"
+  "$work/$name" < "$input" > "$work/$name.actual" 2>&1
+
+  #
+  # an error message may or may not end the output with a
+  # newline, so compare what's there, not how it ends:
+  #
+  if [ "$(cat "$work/$name.expected")" != "$(cat "$work/$name.actual")" ]; then
+    echo "FAILED (output): $program"
+    diff "$work/$name.expected" "$work/$name.actual" | head -10
+    failed=$((failed + 1))
+  fi
+done
+
+echo "$checked checked, $failed failed"
+
+[ $failed -eq 0 ]
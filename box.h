@@ -0,0 +1,297 @@
+/*box.h*/
+
+//
+// Boxed values for the nuPython executor. A boxed value is the
+// executor's representation of a temporary --- the value of an
+// element, a unary expression, or an intermediate result ---
+// passed around by value instead of being malloc'd.
+//
+// Two layouts are available, selected at build time:
+//
+//   default            struct RAM_VALUE, i.e. a type tag plus a
+//                      union (16 bytes with padding)
+//
+//   -DNUPY_NAN_BOXING  a single 64-bit word: reals are stored as
+//                      IEEE doubles, and every other type is packed
+//                      into the payload of a quiet NaN (8 bytes)
+//
+// The rest of the executor only uses the functions below, so
+// both layouts behave identically.
+//
+// NOTE: a boxed string is never owned by the box, it refers to a
+// string owned by someone else (a memory cell, the program graph,
+// or the executor). Writing a boxed value to memory duplicates
+// the string, as usual.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+#pragma once
+
+#include <stdbool.h>  // true, false
+#include <stdint.h>   // uint64_t, uintptr_t
+#include <string.h>   // memcpy
+
+#include "ram.h"
+
+
+#if defined(NUPY_NAN_BOXING)
+
+//
+// NaN-boxed layout:
+//
+// A double is a NaN when its exponent bits are all 1 and its
+// mantissa is non-zero. Hardware only ever produces the default
+// quiet NaN (0x7FF8... or 0xFFF8...), so every 64-bit pattern
+// whose top 16 bits are 0xFFF9 or higher is free to encode
+// another type, with a 48-bit payload below it:
+//
+//   0xFFF9 | 32-bit int       int
+//   0xFFFA | 32-bit address   ptr
+//   0xFFFB | 0 or 1           boolean
+//   0xFFFC | 0                None
+//   0xFFFD | 48-bit pointer   str
+//
+// Anything below 0xFFF9 << 48 is a real.
+//
+struct BOXED_VALUE
+{
+  uint64_t bits;
+};
+
+#define BOX_TAG_SHIFT    48
+#define BOX_TAG_INT      0xFFF9ULL
+#define BOX_TAG_PTR      0xFFFAULL
+#define BOX_TAG_BOOLEAN  0xFFFBULL
+#define BOX_TAG_NONE     0xFFFCULL
+#define BOX_TAG_STR      0xFFFDULL
+#define BOX_PAYLOAD_MASK 0x0000FFFFFFFFFFFFULL
+#define BOX_CANONICAL_NAN 0x7FF8000000000000ULL
+#define BOX_SIGN_BIT     0x8000000000000000ULL
+
+static inline struct BOXED_VALUE box_tagged(uint64_t tag, uint64_t payload)
+{
+  struct BOXED_VALUE v;
+  v.bits = (tag << BOX_TAG_SHIFT) | (payload & BOX_PAYLOAD_MASK);
+  return v;
+}
+
+static inline int unbox_type(struct BOXED_VALUE v)
+{
+  if (v.bits < (BOX_TAG_INT << BOX_TAG_SHIFT))
+    return RAM_TYPE_REAL;
+
+  switch (v.bits >> BOX_TAG_SHIFT) {
+  case BOX_TAG_INT:     return RAM_TYPE_INT;
+  case BOX_TAG_PTR:     return RAM_TYPE_PTR;
+  case BOX_TAG_BOOLEAN: return RAM_TYPE_BOOLEAN;
+  case BOX_TAG_STR:     return RAM_TYPE_STR;
+  default:              return RAM_TYPE_NONE;
+  }
+}
+
+static inline struct BOXED_VALUE box_int(int i)
+{
+  return box_tagged(BOX_TAG_INT, (uint32_t)i);
+}
+
+static inline struct BOXED_VALUE box_ptr(int address)
+{
+  return box_tagged(BOX_TAG_PTR, (uint32_t)address);
+}
+
+static inline struct BOXED_VALUE box_bool(bool b)
+{
+  return box_tagged(BOX_TAG_BOOLEAN, b ? 1 : 0);
+}
+
+static inline struct BOXED_VALUE box_none(void)
+{
+  return box_tagged(BOX_TAG_NONE, 0);
+}
+
+static inline struct BOXED_VALUE box_str(char* s)
+{
+  return box_tagged(BOX_TAG_STR, (uint64_t)(uintptr_t)s);
+}
+
+static inline struct BOXED_VALUE box_real(double d)
+{
+  struct BOXED_VALUE v;
+
+  memcpy(&v.bits, &d, sizeof(double));
+
+  //
+  // NaN? Make sure it can't be mistaken for a tag, but keep its
+  // sign, which print shows (-nan); 0xFFF8... is below the tags:
+  //
+  if (d != d)
+    v.bits = BOX_CANONICAL_NAN | (v.bits & BOX_SIGN_BIT);
+
+  return v;
+}
+
+//
+// unbox_int is valid for int, ptr and boolean values:
+//
+static inline int unbox_int(struct BOXED_VALUE v)
+{
+  return (int)(uint32_t)v.bits;
+}
+
+static inline double unbox_real(struct BOXED_VALUE v)
+{
+  double d;
+  memcpy(&d, &v.bits, sizeof(double));
+  return d;
+}
+
+static inline char* unbox_str(struct BOXED_VALUE v)
+{
+  return (char*)(uintptr_t)(v.bits & BOX_PAYLOAD_MASK);
+}
+
+#else
+
+//
+// Tagged layout: the same representation as a memory cell.
+//
+struct BOXED_VALUE
+{
+  struct RAM_VALUE v;
+};
+
+static inline int unbox_type(struct BOXED_VALUE v)
+{
+  return v.v.value_type;
+}
+
+static inline struct BOXED_VALUE box_int(int i)
+{
+  struct BOXED_VALUE v;
+  v.v.value_type = RAM_TYPE_INT;
+  v.v.types.i = i;
+  return v;
+}
+
+static inline struct BOXED_VALUE box_ptr(int address)
+{
+  struct BOXED_VALUE v;
+  v.v.value_type = RAM_TYPE_PTR;
+  v.v.types.i = address;
+  return v;
+}
+
+static inline struct BOXED_VALUE box_bool(bool b)
+{
+  struct BOXED_VALUE v;
+  v.v.value_type = RAM_TYPE_BOOLEAN;
+  v.v.types.i = b ? 1 : 0;
+  return v;
+}
+
+static inline struct BOXED_VALUE box_none(void)
+{
+  struct BOXED_VALUE v;
+  v.v.value_type = RAM_TYPE_NONE;
+  v.v.types.i = 0;
+  return v;
+}
+
+static inline struct BOXED_VALUE box_str(char* s)
+{
+  struct BOXED_VALUE v;
+  v.v.value_type = RAM_TYPE_STR;
+  v.v.types.s = s;
+  return v;
+}
+
+static inline struct BOXED_VALUE box_real(double d)
+{
+  struct BOXED_VALUE v;
+  v.v.value_type = RAM_TYPE_REAL;
+  v.v.types.d = d;
+  return v;
+}
+
+static inline int unbox_int(struct BOXED_VALUE v)
+{
+  return v.v.types.i;
+}
+
+static inline double unbox_real(struct BOXED_VALUE v)
+{
+  return v.v.types.d;
+}
+
+static inline char* unbox_str(struct BOXED_VALUE v)
+{
+  return v.v.types.s;
+}
+
+#endif
+
+
+//
+// box_from_ram
+// box_to_ram
+//
+// Converts between a boxed value and the representation
+// stored in a memory cell. Strings are not copied. In the
+// tagged layout the two representations are the same, so
+// this is just a copy.
+//
+#if defined(NUPY_NAN_BOXING)
+
+static inline struct BOXED_VALUE box_from_ram(struct RAM_VALUE value)
+{
+  switch (value.value_type) {
+  case RAM_TYPE_INT:     return box_int(value.types.i);
+  case RAM_TYPE_REAL:    return box_real(value.types.d);
+  case RAM_TYPE_STR:     return box_str(value.types.s);
+  case RAM_TYPE_PTR:     return box_ptr(value.types.i);
+  case RAM_TYPE_BOOLEAN: return box_bool(value.types.i != 0);
+  default:               return box_none();
+  }
+}
+
+static inline struct RAM_VALUE box_to_ram(struct BOXED_VALUE v)
+{
+  struct RAM_VALUE value;
+
+  value.value_type = unbox_type(v);
+
+  switch (value.value_type) {
+  case RAM_TYPE_REAL:
+    value.types.d = unbox_real(v);
+    break;
+
+  case RAM_TYPE_STR:
+    value.types.s = unbox_str(v);
+    break;
+
+  default:
+    value.types.i = unbox_int(v);
+    break;
+  }
+
+  return value;
+}
+
+#else
+
+static inline struct BOXED_VALUE box_from_ram(struct RAM_VALUE value)
+{
+  struct BOXED_VALUE v;
+  v.v = value;
+  return v;
+}
+
+static inline struct RAM_VALUE box_to_ram(struct BOXED_VALUE v)
+{
+  return v.v;
+}
+
+#endif
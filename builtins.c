@@ -0,0 +1,363 @@
+/*builtins.c*/
+
+//
+// The builtin functions of nuPython, see builtins.h.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+// to eliminate warnings about stdlib in Visual Studio
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>  // true, false
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#include "ram.h"
+#include "box.h"
+#include "arena.h"
+#include "output.h"
+#include "format.h"
+#include "runtime.h"
+#include "builtins.h"
+
+
+//
+// Private functions:
+//
+
+//
+// starts_with_zero
+//
+// Returns true if the given string starts with a
+// '0', false if not. Starting with a 0 is all you
+// need for atoi() and atof() to work successfully.
+//
+static bool starts_with_zero(char* s)
+{
+  if (strlen(s) > 0 && s[0] == '0')
+    return true;
+
+  return false;
+}
+
+//
+// copy_string
+//
+// Copies the given n chars into the scratch arena, null-
+// terminated, and stores the copy in *result. Returns
+// RUNTIME_OK, or RUNTIME_OUT_OF_QUOTA.
+//
+static int copy_string(struct ARENA* scratch, char* s, size_t n, struct BOXED_VALUE* result)
+{
+  char* copy = (char*)arena_alloc(scratch, n + 1);
+  if (copy == NULL)
+    return RUNTIME_OUT_OF_QUOTA;
+
+  memcpy(copy, s, n);
+  copy[n] = '\0';
+
+  *result = box_str(copy);
+
+  return RUNTIME_OK;
+}
+
+
+//
+// The builtins:
+//
+
+//
+// print()
+// print(x)
+//
+// Outputs x followed by a newline (an empty line if no x),
+// and returns None.
+//
+static int builtin_print(struct ARENA* scratch, struct BOXED_VALUE* args, int num_args, struct BOXED_VALUE* result)
+{
+  *result = box_none();
+
+  if (num_args == 0) {
+    output_char('\n');
+    return RUNTIME_OK;
+  }
+
+  return runtime_print(args[0]);
+}
+
+//
+// input()
+// input(prompt)
+//
+// Outputs the prompt, if any, and returns the next line of
+// input, without the end of line ("" at the end of input).
+//
+static int builtin_input(struct ARENA* scratch, struct BOXED_VALUE* args, int num_args, struct BOXED_VALUE* result)
+{
+  if (num_args > 0) {
+    if (unbox_type(args[0]) != RAM_TYPE_STR)
+      return RUNTIME_INVALID_ARGUMENTS;
+
+    char* prompt = unbox_str(args[0]);
+
+    output_write(prompt, strlen(prompt));
+  }
+
+  //
+  // the prompt (and whatever came before) must show before
+  // we wait for input:
+  //
+  output_flush();
+
+  //
+  // read the line a chunk at a time, so it can be any length:
+  //
+  char chunk[256];
+  char* line = NULL;
+  size_t length = 0;
+
+  while (fgets(chunk, sizeof(chunk), stdin) != NULL) {
+    size_t n = strlen(chunk);
+    char* longer = (char*)arena_alloc(scratch, length + n + 1);
+
+    if (longer == NULL)
+      return RUNTIME_OUT_OF_QUOTA;
+
+    if (length > 0)
+      memcpy(longer, line, length);
+    memcpy(longer + length, chunk, n + 1);
+
+    line = longer;
+    length += n;
+
+    if (n > 0 && chunk[n - 1] == '\n')
+      break;
+  }
+
+  if (line == NULL) {
+    *result = box_str("");
+    return RUNTIME_OK;
+  }
+
+  //
+  // delete EOL chars from input:
+  //
+  while (length > 0 && (line[length - 1] == '\n' || line[length - 1] == '\r'))
+    line[--length] = '\0';
+
+  *result = box_str(line);
+
+  return RUNTIME_OK;
+}
+
+//
+// int(x)
+//
+// x as an int: a real is truncated, a boolean is 0 or 1, and
+// a string is converted as atoi() does, provided it's a valid
+// number.
+//
+static int builtin_int(struct ARENA* scratch, struct BOXED_VALUE* args, int num_args, struct BOXED_VALUE* result)
+{
+  struct BOXED_VALUE x = args[0];
+
+  switch (unbox_type(x)) {
+  case RAM_TYPE_INT:
+    *result = x;
+    return RUNTIME_OK;
+
+  case RAM_TYPE_BOOLEAN:
+    *result = box_int(unbox_int(x));
+    return RUNTIME_OK;
+
+  case RAM_TYPE_REAL: {
+    double d = unbox_real(x);
+
+    if (!(d > -2147483649.0 && d < 2147483648.0))  // also NaN
+      return RUNTIME_INVALID_ARGUMENTS;
+
+    *result = box_int((int)d);
+    return RUNTIME_OK;
+  }
+
+  case RAM_TYPE_STR: {
+    char* s = unbox_str(x);
+    int i = atoi(s);
+
+    if (i == 0 && !starts_with_zero(s))
+      return RUNTIME_INVALID_STRING;
+
+    *result = box_int(i);
+    return RUNTIME_OK;
+  }
+
+  default:  // pointers, None
+    return RUNTIME_INVALID_ARGUMENTS;
+  }
+}
+
+//
+// float(x)
+//
+// x as a real: an int or boolean is converted, and a string is
+// converted as atof() does, provided it's a valid number.
+//
+static int builtin_float(struct ARENA* scratch, struct BOXED_VALUE* args, int num_args, struct BOXED_VALUE* result)
+{
+  struct BOXED_VALUE x = args[0];
+
+  switch (unbox_type(x)) {
+  case RAM_TYPE_REAL:
+    *result = x;
+    return RUNTIME_OK;
+
+  case RAM_TYPE_INT:
+  case RAM_TYPE_BOOLEAN:
+    *result = box_real((double)unbox_int(x));
+    return RUNTIME_OK;
+
+  case RAM_TYPE_STR: {
+    char* s = unbox_str(x);
+    double d = atof(s);
+
+    if (d == 0.0 && !starts_with_zero(s))
+      return RUNTIME_INVALID_STRING;
+
+    *result = box_real(d);
+    return RUNTIME_OK;
+  }
+
+  default:  // pointers, None
+    return RUNTIME_INVALID_ARGUMENTS;
+  }
+}
+
+//
+// str(x)
+//
+// x as a string, as print() would output it.
+//
+static int builtin_str(struct ARENA* scratch, struct BOXED_VALUE* args, int num_args, struct BOXED_VALUE* result)
+{
+  struct BOXED_VALUE x = args[0];
+  char buffer[FORMAT_REAL_SIZE];
+  int length;
+
+  switch (unbox_type(x)) {
+  case RAM_TYPE_STR:
+    *result = x;
+    return RUNTIME_OK;
+
+  case RAM_TYPE_INT:
+  case RAM_TYPE_PTR:
+    length = format_int(buffer, unbox_int(x));
+    break;
+
+  case RAM_TYPE_REAL:
+    length = format_real(buffer, unbox_real(x));
+    break;
+
+  case RAM_TYPE_BOOLEAN:
+    *result = box_str(unbox_int(x) ? "True" : "False");
+    return RUNTIME_OK;
+
+  default:
+    *result = box_str("None");
+    return RUNTIME_OK;
+  }
+
+  return copy_string(scratch, buffer, length, result);
+}
+
+//
+// len(s)
+//
+// The # of characters in the string s.
+//
+static int builtin_len(struct ARENA* scratch, struct BOXED_VALUE* args, int num_args, struct BOXED_VALUE* result)
+{
+  if (unbox_type(args[0]) != RAM_TYPE_STR)
+    return RUNTIME_INVALID_ARGUMENTS;
+
+  *result = box_int((int)strlen(unbox_str(args[0])));
+
+  return RUNTIME_OK;
+}
+
+//
+// abs(x)
+//
+// The absolute value of the int or real x (ints wrap around,
+// as the operators do, so abs of the smallest int is itself).
+//
+static int builtin_abs(struct ARENA* scratch, struct BOXED_VALUE* args, int num_args, struct BOXED_VALUE* result)
+{
+  struct BOXED_VALUE x = args[0];
+
+  switch (unbox_type(x)) {
+  case RAM_TYPE_INT:
+  case RAM_TYPE_BOOLEAN: {
+    int i = unbox_int(x);
+
+    *result = box_int(i < 0 ? RUNTIME_WRAP(0, -, i) : i);
+    return RUNTIME_OK;
+  }
+
+  case RAM_TYPE_REAL:
+    *result = box_real(fabs(unbox_real(x)));
+    return RUNTIME_OK;
+
+  default:  // strings, pointers, None
+    return RUNTIME_INVALID_ARGUMENTS;
+  }
+}
+
+
+//
+// The registry: name, # of arguments (min and max), and
+// function:
+//
+static struct BUILTIN builtins[] = {
+  { "print", 0, 1, builtin_print },
+  { "input", 0, 1, builtin_input },
+  { "int",   1, 1, builtin_int },
+  { "float", 1, 1, builtin_float },
+  { "str",   1, 1, builtin_str },
+  { "len",   1, 1, builtin_len },
+  { "abs",   1, 1, builtin_abs },
+};
+
+#define BUILTIN_COUNT ((int)(sizeof(builtins) / sizeof(builtins[0])))
+
+
+//
+// Public functions:
+//
+
+//
+// builtin_lookup
+//
+int builtin_lookup(char* name)
+{
+  for (int i = 0; i < BUILTIN_COUNT; i++)
+    if (strcmp(builtins[i].name, name) == 0)
+      return i;
+
+  return -1;
+}
+
+//
+// builtin_get
+//
+struct BUILTIN* builtin_get(int index)
+{
+  assert(index >= 0 && index < BUILTIN_COUNT);
+
+  return &builtins[index];
+}
@@ -0,0 +1,101 @@
+/*builtins.h*/
+
+//
+// The builtin functions of nuPython: print, input, int, float,
+// str, len and abs. A call names its function, e.g.
+//
+//   x = int(s)
+//   n = len("abc")
+//   print(x)
+//
+// and passes at most one argument (an identifier or literal).
+//
+// The functions are kept in a registry, a table of function
+// pointers. An engine that compiles the program looks each
+// name up once, when it compiles the call, and calls through
+// the pointer from then on; a name not in the registry is an
+// error when the call executes ("name 'f' is not defined"),
+// as it would be in Python. The argument is passed in an
+// array on the caller's stack, and a string result comes from
+// the scratch arena, so a call allocates nothing on the heap.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+#pragma once
+
+#include <stdbool.h>  // true, false
+
+#include "box.h"
+#include "arena.h"
+#include "runtime.h"
+
+
+//
+// the most arguments a builtin takes:
+//
+#define BUILTIN_MAX_ARGS 1
+
+//
+// A builtin: given its arguments, computes the result (None if
+// the function has nothing to return). Returns RUNTIME_OK, or
+// the status of the error, e.g. RUNTIME_INVALID_ARGUMENTS; the
+// caller reports it, with the function's name.
+//
+struct BUILTIN
+{
+  char* name;
+  int   min_args;
+  int   max_args;
+
+  int (*function)(
+    struct ARENA* scratch,
+    struct BOXED_VALUE* args,
+    int num_args,
+    struct BOXED_VALUE* result);
+};
+
+
+//
+// Public functions:
+//
+
+//
+// builtin_lookup
+//
+// Returns the index of the builtin with the given name in the
+// registry, -1 if there is none.
+//
+int builtin_lookup(char* name);
+
+//
+// builtin_get
+//
+// Returns the builtin with the given index (see
+// builtin_lookup).
+//
+struct BUILTIN* builtin_get(int index);
+
+//
+// builtin_call
+//
+// Calls the given builtin with the given arguments, storing
+// what it returns in *result. Any string result comes from
+// the scratch arena. Returns RUNTIME_OK, or the status of the
+// error (RUNTIME_INVALID_ARGUMENTS if the builtin doesn't take
+// that many arguments).
+//
+static inline int builtin_call(
+  struct BUILTIN* builtin,
+  struct ARENA* scratch,
+  struct BOXED_VALUE* args,
+  int num_args,
+  struct BOXED_VALUE* result)
+{
+  if (num_args < builtin->min_args || num_args > builtin->max_args)
+    return RUNTIME_INVALID_ARGUMENTS;
+
+  return builtin->function(scratch, args, num_args, result);
+}
@@ -0,0 +1,1021 @@
+/*closure.c*/
+
+//
+// Closure-compiling engine for nuPython, see closure.h.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+// to eliminate warnings about stdlib in Visual Studio
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>  // true, false
+#include <string.h>
+#include <assert.h>
+
+#include "programgraph.h"
+#include "ram.h"
+#include "box.h"
+#include "arena.h"
+#include "output.h"
+#include "runtime.h"
+#include "closure.h"
+#include "util.h"
+
+
+//
+// The operators that get specialized closures: for each, a
+// name, the operator, and what it computes when both operands
+// are ints (as runtime.h says ints are computed). Other operand
+// types fall back to runtime_binary_op, as do the other
+// operators:
+//
+#define CLOSURE_INT_OPS(X)                                        \
+  X(add, OPERATOR_PLUS,      box_int,  +,  RUNTIME_WRAP)          \
+  X(sub, OPERATOR_MINUS,     box_int,  -,  RUNTIME_WRAP)          \
+  X(mul, OPERATOR_ASTERISK,  box_int,  *,  RUNTIME_WRAP)          \
+  X(eq,  OPERATOR_EQUAL,     box_bool, ==, RUNTIME_COMPARE)       \
+  X(ne,  OPERATOR_NOT_EQUAL, box_bool, !=, RUNTIME_COMPARE)       \
+  X(lt,  OPERATOR_LT,        box_bool, <,  RUNTIME_COMPARE)       \
+  X(le,  OPERATOR_LTE,       box_bool, <=, RUNTIME_COMPARE)       \
+  X(gt,  OPERATOR_GT,        box_bool, >,  RUNTIME_COMPARE)       \
+  X(ge,  OPERATOR_GTE,       box_bool, >=, RUNTIME_COMPARE)
+
+//
+// Likewise the comparisons, when they are the condition of an
+// if or while:
+//
+#define CLOSURE_INT_COMPARES(X)                   \
+  X(eq,  OPERATOR_EQUAL,     ==)                  \
+  X(ne,  OPERATOR_NOT_EQUAL, !=)                  \
+  X(lt,  OPERATOR_LT,        <)                   \
+  X(le,  OPERATOR_LTE,       <=)                  \
+  X(gt,  OPERATOR_GT,        >)                   \
+  X(ge,  OPERATOR_GTE,       >=)
+
+
+//
+// While building, remembers the closure built for each
+// statement, so a statement reached a second time (the top
+// of a loop, or the statement after an if) is shared. The
+// closures still to be filled in are pending:
+//
+struct CLOSURE_BUILT
+{
+  struct STMT* stmt;
+  struct CLOSURE_STMT* closure;
+};
+
+struct CLOSURE_BUILDER
+{
+  struct CLOSURE_PROGRAM* program;
+
+  struct CLOSURE_BUILT* built;
+  int num_built;
+  int built_capacity;
+
+  struct CLOSURE_BUILT* pending;
+  int num_pending;
+  int pending_capacity;
+};
+
+
+//
+// Private functions:
+//
+
+//
+// panic
+//
+// Outputs the given error message and exits.
+//
+static void panic(char* msg)
+{
+  output_flush();
+
+  printf("**CLOSURE ERROR\n");
+  printf("**CLOSURE ERROR: %s\n", msg);
+  printf("**CLOSURE ERROR\n");
+  exit(-1);
+}
+
+//
+// read_var
+//
+// Reads the given variable into *value. Returns false (after
+// outputting an error message) if the variable has not been
+// written to memory.
+//
+static inline bool read_var(struct CLOSURE_CONTEXT* context, int var, int line, struct BOXED_VALUE* value)
+{
+  int address = runtime_lookup(context->memory, &context->vars[var]);
+
+  if (address < 0) {
+    runtime_report(RUNTIME_UNDEFINED, context->vars[var].name, line);
+    return false;
+  }
+
+  *value = runtime_read_cell(context->memory, address);
+  return true;
+}
+
+//
+// store_var
+//
+// Writes the given value to the given variable, and resets
+// the scratch arena since the statement is done. Returns
+// false (after outputting an error message) if that failed.
+//
+static inline bool store_var(struct CLOSURE_CONTEXT* context, int var, int line, struct BOXED_VALUE value)
+{
+  int status = runtime_store(context->memory, &context->vars[var], value);
+
+  if (context->scratch->used > 0)
+    arena_reset(context->scratch);
+
+  if (status != RUNTIME_OK) {
+    runtime_report(status, context->vars[var].name, line);
+    return false;
+  }
+
+  return true;
+}
+
+//
+// truth
+//
+// Returns the truth value of the given condition value.
+//
+static inline bool truth(struct BOXED_VALUE value)
+{
+  if (unbox_type(value) == RAM_TYPE_BOOLEAN)
+    return unbox_int(value) != 0;
+
+  return runtime_is_true(value);
+}
+
+
+//
+// Expression closures:
+//
+
+static bool eval_const(struct CLOSURE_EXPR* self, struct CLOSURE_CONTEXT* context, struct BOXED_VALUE* value)
+{
+  *value = self->constant;
+  return true;
+}
+
+static bool eval_var(struct CLOSURE_EXPR* self, struct CLOSURE_CONTEXT* context, struct BOXED_VALUE* value)
+{
+  return read_var(context, self->var, self->line, value);
+}
+
+static bool eval_addr(struct CLOSURE_EXPR* self, struct CLOSURE_CONTEXT* context, struct BOXED_VALUE* value)
+{
+  int address = runtime_lookup(context->memory, &context->vars[self->var]);
+
+  if (address < 0) {
+    runtime_report(RUNTIME_UNDEFINED, context->vars[self->var].name, self->line);
+    return false;
+  }
+
+  *value = box_ptr(address);
+  return true;
+}
+
+static bool eval_deref(struct CLOSURE_EXPR* self, struct CLOSURE_CONTEXT* context, struct BOXED_VALUE* value)
+{
+  struct BOXED_VALUE ptr;
+
+  if (!read_var(context, self->var, self->line, &ptr))
+    return false;
+
+  int status = runtime_check_ptr(context->memory, ptr);
+
+  if (status != RUNTIME_OK) {
+    runtime_report(status, context->vars[self->var].name, self->line);
+    return false;
+  }
+
+  *value = runtime_read_cell(context->memory, unbox_int(ptr));
+  return true;
+}
+
+static bool eval_fail_unary(struct CLOSURE_EXPR* self, struct CLOSURE_CONTEXT* context, struct BOXED_VALUE* value)
+{
+  runtime_report(RUNTIME_UNSUPPORTED_UNARY, NULL, self->line);
+  return false;
+}
+
+static bool eval_fail_element(struct CLOSURE_EXPR* self, struct CLOSURE_CONTEXT* context, struct BOXED_VALUE* value)
+{
+  runtime_report(RUNTIME_UNEXPECTED_ELEMENT, NULL, self->line);
+  return false;
+}
+
+static bool eval_fail_call(struct CLOSURE_EXPR* self, struct CLOSURE_CONTEXT* context, struct BOXED_VALUE* value)
+{
+  runtime_report(RUNTIME_UNDEFINED, unbox_str(self->constant), self->line);
+  return false;
+}
+
+//
+// eval_call
+//
+// A call of a builtin function: evaluates the argument, if
+// any, then calls the function.
+//
+static bool eval_call(struct CLOSURE_EXPR* self, struct CLOSURE_CONTEXT* context, struct BOXED_VALUE* value)
+{
+  struct BOXED_VALUE args[BUILTIN_MAX_ARGS];
+  int num_args = 0;
+
+  if (self->arg != NULL) {
+    if (!self->arg->eval(self->arg, context, &args[0]))
+      return false;
+
+    num_args = 1;
+  }
+
+  int status = builtin_call(self->builtin, context->scratch, args, num_args, value);
+
+  if (status != RUNTIME_OK) {
+    runtime_report(status, self->builtin->name, self->line);
+    return false;
+  }
+
+  return true;
+}
+
+//
+// eval_binop
+//
+// The general case of a binary expression: evaluates both
+// sides, then performs the operation.
+//
+static bool eval_binop(struct CLOSURE_EXPR* self, struct CLOSURE_CONTEXT* context, struct BOXED_VALUE* value)
+{
+  struct BOXED_VALUE rhs;
+
+  if (!self->lhs->eval(self->lhs, context, value))
+    return false;
+
+  if (!self->rhs->eval(self->rhs, context, &rhs))
+    return false;
+
+  int status = runtime_binary_op(context->scratch, value, self->operator, &rhs);
+
+  if (status != RUNTIME_OK) {
+    runtime_report(status, NULL, self->line);
+    return false;
+  }
+
+  return true;
+}
+
+//
+// eval_<op>_var_const
+// eval_<op>_var_var
+//
+// Specialized binary expressions: "x op 1" (the constant is
+// known to be an int) and "x op y". If the variables turn out
+// not to hold ints, it's the general case after all.
+//
+#define CLOSURE_EVAL_INT_OP(name, operator, box, c_op, int_op)                          \
+  static bool eval_##name##_var_const(struct CLOSURE_EXPR* self,                        \
+    struct CLOSURE_CONTEXT* context, struct BOXED_VALUE* value)                         \
+  {                                                                                     \
+    struct BOXED_VALUE lhs;                                                             \
+                                                                                        \
+    if (!read_var(context, self->lhs->var, self->line, &lhs))                           \
+      return false;                                                                     \
+                                                                                        \
+    if (unbox_type(lhs) != RAM_TYPE_INT)                                                \
+      return eval_binop(self, context, value);                                          \
+                                                                                        \
+    *value = box(int_op(unbox_int(lhs), c_op, unbox_int(self->rhs->constant)));         \
+    return true;                                                                        \
+  }                                                                                     \
+                                                                                        \
+  static bool eval_##name##_var_var(struct CLOSURE_EXPR* self,                          \
+    struct CLOSURE_CONTEXT* context, struct BOXED_VALUE* value)                         \
+  {                                                                                     \
+    struct BOXED_VALUE lhs;                                                             \
+    struct BOXED_VALUE rhs;                                                             \
+                                                                                        \
+    if (!read_var(context, self->lhs->var, self->line, &lhs))                           \
+      return false;                                                                     \
+                                                                                        \
+    if (!read_var(context, self->rhs->var, self->line, &rhs))                           \
+      return false;                                                                     \
+                                                                                        \
+    if (unbox_type(lhs) != RAM_TYPE_INT || unbox_type(rhs) != RAM_TYPE_INT)             \
+      return eval_binop(self, context, value);                                          \
+                                                                                        \
+    *value = box(int_op(unbox_int(lhs), c_op, unbox_int(rhs)));                         \
+    return true;                                                                        \
+  }
+
+CLOSURE_INT_OPS(CLOSURE_EVAL_INT_OP)
+#undef CLOSURE_EVAL_INT_OP
+
+
+//
+// Statement closures:
+//
+
+//
+// exec_assign
+//
+// x = expr
+//
+static struct CLOSURE_STMT* exec_assign(struct CLOSURE_STMT* self, struct CLOSURE_CONTEXT* context)
+{
+  struct BOXED_VALUE value;
+
+  if (!self->expr->eval(self->expr, context, &value))
+    return NULL;
+
+  if (!store_var(context, self->var, self->line, value))
+    return NULL;
+
+  return self->next;
+}
+
+//
+// exec_assign_<op>_var_const
+//
+// x = y op 1, the constant known to be an int. If y turns out
+// not to hold an int, it's the general case after all.
+//
+#define CLOSURE_EXEC_ASSIGN_INT_OP(name, operator, box, c_op, int_op)                   \
+  static struct CLOSURE_STMT* exec_assign_##name##_var_const(struct CLOSURE_STMT* self, \
+    struct CLOSURE_CONTEXT* context)                                                    \
+  {                                                                                     \
+    struct CLOSURE_EXPR* expr = self->expr;                                             \
+    struct BOXED_VALUE lhs;                                                             \
+                                                                                        \
+    if (!read_var(context, expr->lhs->var, self->line, &lhs))                           \
+      return NULL;                                                                      \
+                                                                                        \
+    if (unbox_type(lhs) != RAM_TYPE_INT)                                                \
+      return exec_assign(self, context);                                                \
+                                                                                        \
+    int result = int_op(unbox_int(lhs), c_op, unbox_int(expr->rhs->constant));          \
+                                                                                        \
+    if (!store_var(context, self->var, self->line, box(result)))                        \
+      return NULL;                                                                      \
+                                                                                        \
+    return self->next;                                                                  \
+  }
+
+CLOSURE_INT_OPS(CLOSURE_EXEC_ASSIGN_INT_OP)
+#undef CLOSURE_EXEC_ASSIGN_INT_OP
+
+//
+// exec_assign_append
+//
+// s = s + expr. If s and expr hold strings, expr is appended
+// to s in place (see runtime_append), else it's the general
+// case after all.
+//
+static struct CLOSURE_STMT* exec_assign_append(struct CLOSURE_STMT* self, struct CLOSURE_CONTEXT* context)
+{
+  struct CLOSURE_EXPR* expr = self->expr;
+  struct BOXED_VALUE lhs;
+  struct BOXED_VALUE rhs;
+
+  if (!read_var(context, self->var, self->line, &lhs))
+    return NULL;
+
+  if (!expr->rhs->eval(expr->rhs, context, &rhs))
+    return NULL;
+
+  if (unbox_type(lhs) != RAM_TYPE_STR ||
+    unbox_type(rhs) != RAM_TYPE_STR ||
+    unbox_str(lhs) == unbox_str(rhs))  // s = s + s
+  {
+    return exec_assign(self, context);
+  }
+
+  int status = runtime_append(context->memory, context->vars[self->var].address, unbox_str(rhs));
+
+  if (context->scratch->used > 0)
+    arena_reset(context->scratch);
+
+  if (status != RUNTIME_OK) {
+    runtime_report(status, NULL, self->line);
+    return NULL;
+  }
+
+  return self->next;
+}
+
+//
+// exec_assign_ptr
+//
+// *p = expr
+//
+static struct CLOSURE_STMT* exec_assign_ptr(struct CLOSURE_STMT* self, struct CLOSURE_CONTEXT* context)
+{
+  struct BOXED_VALUE value;
+  struct BOXED_VALUE ptr;
+
+  if (!self->expr->eval(self->expr, context, &value))
+    return NULL;
+
+  if (!read_var(context, self->var, self->line, &ptr))
+    return NULL;
+
+  int status = runtime_check_ptr(context->memory, ptr);
+
+  if (status == RUNTIME_OK)
+    status = runtime_write_cell_by_addr(context->memory, value, unbox_int(ptr));
+
+  if (context->scratch->used > 0)
+    arena_reset(context->scratch);
+
+  if (status != RUNTIME_OK) {
+    runtime_report(status, context->vars[self->var].name, self->line);
+    return NULL;
+  }
+
+  return self->next;
+}
+
+//
+// exec_print
+// exec_print_nl
+//
+// print(element)
+// print()
+//
+static struct CLOSURE_STMT* exec_print(struct CLOSURE_STMT* self, struct CLOSURE_CONTEXT* context)
+{
+  struct BOXED_VALUE value;
+
+  if (!self->expr->eval(self->expr, context, &value))
+    return NULL;
+
+  int status = runtime_print(value);
+
+  if (status != RUNTIME_OK) {
+    runtime_report(status, NULL, self->line);
+    return NULL;
+  }
+
+  return self->next;
+}
+
+static struct CLOSURE_STMT* exec_print_nl(struct CLOSURE_STMT* self, struct CLOSURE_CONTEXT* context)
+{
+  output_char('\n');
+
+  return self->next;
+}
+
+//
+// exec_call
+//
+// f(element), what the function returns discarded.
+//
+static struct CLOSURE_STMT* exec_call(struct CLOSURE_STMT* self, struct CLOSURE_CONTEXT* context)
+{
+  struct BOXED_VALUE value;
+
+  bool success = self->expr->eval(self->expr, context, &value);
+
+  if (context->scratch->used > 0)
+    arena_reset(context->scratch);
+
+  if (!success)
+    return NULL;
+
+  return self->next;
+}
+
+//
+// exec_branch
+//
+// The condition of an if or while: continues with next (the
+// true path or loop body) if true, other if false.
+//
+static struct CLOSURE_STMT* exec_branch(struct CLOSURE_STMT* self, struct CLOSURE_CONTEXT* context)
+{
+  struct BOXED_VALUE value;
+
+  if (!self->expr->eval(self->expr, context, &value))
+    return NULL;
+
+  bool condition = truth(value);
+
+  if (context->scratch->used > 0)
+    arena_reset(context->scratch);
+
+  return condition ? self->next : self->other;
+}
+
+//
+// exec_branch_<op>_var_const
+//
+// A condition "x op 1", the constant known to be an int. If x
+// turns out not to hold an int, it's the general case after
+// all.
+//
+#define CLOSURE_EXEC_BRANCH_INT_COMPARE(name, operator, c_op)                          \
+  static struct CLOSURE_STMT* exec_branch_##name##_var_const(struct CLOSURE_STMT* self, \
+    struct CLOSURE_CONTEXT* context)                                                    \
+  {                                                                                     \
+    struct CLOSURE_EXPR* expr = self->expr;                                             \
+    struct BOXED_VALUE lhs;                                                             \
+                                                                                        \
+    if (!read_var(context, expr->lhs->var, self->line, &lhs))                           \
+      return NULL;                                                                      \
+                                                                                        \
+    if (unbox_type(lhs) != RAM_TYPE_INT)                                                \
+      return exec_branch(self, context);                                                \
+                                                                                        \
+    if (unbox_int(lhs) c_op unbox_int(expr->rhs->constant))                             \
+      return self->next;                                                                \
+    else                                                                                \
+      return self->other;                                                               \
+  }
+
+CLOSURE_INT_COMPARES(CLOSURE_EXEC_BRANCH_INT_COMPARE)
+#undef CLOSURE_EXEC_BRANCH_INT_COMPARE
+
+
+//
+// Building the closures:
+//
+
+//
+// new_expr
+// new_stmt
+//
+// Allocates a closure with the given function, and links it
+// into the program so it can be freed.
+//
+static struct CLOSURE_EXPR* new_expr(struct CLOSURE_PROGRAM* program, int line,
+  bool (*eval)(struct CLOSURE_EXPR*, struct CLOSURE_CONTEXT*, struct BOXED_VALUE*))
+{
+  struct CLOSURE_EXPR* expr = (struct CLOSURE_EXPR*)calloc(1, sizeof(struct CLOSURE_EXPR));
+  if (expr == NULL)
+    panic("out of memory (closure_compile)");
+
+  expr->eval = eval;
+  expr->line = line;
+  expr->var = -1;
+  expr->operator = OPERATOR_NO_OP;
+  expr->constant = box_none();
+
+  expr->next_closure = program->exprs;
+  program->exprs = expr;
+
+  return expr;
+}
+
+static struct CLOSURE_STMT* new_stmt(struct CLOSURE_PROGRAM* program, int line)
+{
+  struct CLOSURE_STMT* stmt = (struct CLOSURE_STMT*)calloc(1, sizeof(struct CLOSURE_STMT));
+  if (stmt == NULL)
+    panic("out of memory (closure_compile)");
+
+  stmt->exec = NULL;  // filled in later, see build_stmt
+  stmt->line = line;
+  stmt->var = -1;
+
+  stmt->next_closure = program->stmts;
+  program->stmts = stmt;
+
+  return stmt;
+}
+
+//
+// var_index
+//
+// Returns the index of the variable with the given name,
+// adding the variable if this is the first reference.
+//
+static int var_index(struct CLOSURE_PROGRAM* program, char* var_name)
+{
+  for (int i = 0; i < program->num_vars; i++)
+    if (strcmp(program->vars[i].name, var_name) == 0)
+      return i;
+
+  program->vars = (struct RUNTIME_VAR*)grow(program->vars, program->num_vars,
+    &program->var_capacity, sizeof(struct RUNTIME_VAR));
+
+  program->vars[program->num_vars].name = var_name;
+  program->vars[program->num_vars].address = -1;
+
+  return program->num_vars++;
+}
+
+//
+// is_var
+// is_int_const
+//
+// What kind of operand does the given expression closure
+// compute?
+//
+static bool is_var(struct CLOSURE_EXPR* expr)
+{
+  return expr->eval == eval_var;
+}
+
+static bool is_int_const(struct CLOSURE_EXPR* expr)
+{
+  return expr->eval == eval_const && unbox_type(expr->constant) == RAM_TYPE_INT;
+}
+
+//
+// build_element
+// build_unary
+// build_expr
+//
+// Builds the closure for an element, unary expression, or
+// expression, choosing a specialized function if there is one.
+//
+static struct CLOSURE_EXPR* build_element(struct CLOSURE_PROGRAM* program, int line, struct ELEMENT* element)
+{
+  struct CLOSURE_EXPR* expr;
+  char* literal = element->element_value;
+
+  if (element->element_type == ELEMENT_IDENTIFIER) {
+    expr = new_expr(program, line, eval_var);
+    expr->var = var_index(program, literal);
+    return expr;
+  }
+
+  if (element->element_type == ELEMENT_NONE)
+    return new_expr(program, line, eval_fail_element);
+
+  expr = new_expr(program, line, eval_const);
+
+  switch (element->element_type) {
+  case ELEMENT_INT_LITERAL:
+    expr->constant = box_int(atoi(literal));
+    break;
+
+  case ELEMENT_REAL_LITERAL:
+    expr->constant = box_real(atof(literal));
+    break;
+
+  case ELEMENT_STR_LITERAL:
+    expr->constant = box_str(literal);
+    break;
+
+  case ELEMENT_TRUE:
+    expr->constant = box_bool(true);
+    break;
+
+  default:
+    assert(element->element_type == ELEMENT_FALSE);
+    expr->constant = box_bool(false);
+    break;
+  }
+
+  return expr;
+}
+
+static struct CLOSURE_EXPR* build_unary(struct CLOSURE_PROGRAM* program, int line, struct UNARY_EXPR* unary)
+{
+  struct CLOSURE_EXPR* expr;
+
+  switch (unary->expr_type) {
+  case UNARY_ELEMENT:
+    return build_element(program, line, unary->element);
+
+  case UNARY_ADDRESS_OF:
+    expr = new_expr(program, line, eval_addr);
+    expr->var = var_index(program, unary->element->element_value);
+    return expr;
+
+  case UNARY_PTR_DEREF:
+    expr = new_expr(program, line, eval_deref);
+    expr->var = var_index(program, unary->element->element_value);
+    return expr;
+
+  default:
+    return new_expr(program, line, eval_fail_unary);
+  }
+}
+
+static struct CLOSURE_EXPR* build_expr(struct CLOSURE_PROGRAM* program, int line, struct VALUE_EXPR* value_expr)
+{
+  assert(value_expr->lhs != NULL);
+
+  struct CLOSURE_EXPR* lhs = build_unary(program, line, value_expr->lhs);
+
+  if (!value_expr->isBinaryExpr)
+    return lhs;
+
+  assert(value_expr->rhs != NULL);
+  assert(value_expr->operator != OPERATOR_NO_OP);
+
+  struct CLOSURE_EXPR* rhs = build_unary(program, line, value_expr->rhs);
+  struct CLOSURE_EXPR* expr = new_expr(program, line, eval_binop);
+
+  expr->operator = value_expr->operator;
+  expr->lhs = lhs;
+  expr->rhs = rhs;
+
+  if (is_var(lhs) && is_int_const(rhs)) {
+    switch (expr->operator) {
+#define CLOSURE_SELECT(name, operator, box, c_op, int_op) case operator: expr->eval = eval_##name##_var_const; break;
+      CLOSURE_INT_OPS(CLOSURE_SELECT)
+#undef CLOSURE_SELECT
+    }
+  }
+  else if (is_var(lhs) && is_var(rhs)) {
+    switch (expr->operator) {
+#define CLOSURE_SELECT(name, operator, box, c_op, int_op) case operator: expr->eval = eval_##name##_var_var; break;
+      CLOSURE_INT_OPS(CLOSURE_SELECT)
+#undef CLOSURE_SELECT
+    }
+  }
+
+  return expr;
+}
+
+//
+// build_call
+//
+// Builds the closure for a call of a builtin function. The
+// function is looked up now, once; calling one we don't have
+// is an error when the call executes.
+//
+static struct CLOSURE_EXPR* build_call(struct CLOSURE_PROGRAM* program, int line, char* function_name, struct ELEMENT* parameter)
+{
+  int index = builtin_lookup(function_name);
+
+  if (index < 0) {
+    struct CLOSURE_EXPR* expr = new_expr(program, line, eval_fail_call);
+
+    expr->constant = box_str(function_name);
+    return expr;
+  }
+
+  struct CLOSURE_EXPR* expr = new_expr(program, line, eval_call);
+
+  expr->builtin = builtin_get(index);
+
+  if (parameter != NULL)
+    expr->arg = build_element(program, line, parameter);
+
+  return expr;
+}
+
+//
+// is_var_op_int_const
+//
+// Returns true if the given expression closure is "x op 1",
+// the constant an int.
+//
+static bool is_var_op_int_const(struct CLOSURE_EXPR* expr)
+{
+  return expr->lhs != NULL && is_var(expr->lhs) && is_int_const(expr->rhs);
+}
+
+//
+// closure_for
+//
+// Returns the closure for the given statement, creating it
+// (to be filled in later) if there isn't one yet. A pass is
+// skipped, there is nothing to execute.
+//
+static struct CLOSURE_STMT* closure_for(struct CLOSURE_BUILDER* builder, struct STMT* stmt)
+{
+  while (stmt != NULL && stmt->stmt_type == STMT_PASS)
+    stmt = stmt->types.pass->next_stmt;
+
+  if (stmt == NULL)
+    return NULL;
+
+  for (int i = 0; i < builder->num_built; i++)
+    if (builder->built[i].stmt == stmt)
+      return builder->built[i].closure;
+
+  struct CLOSURE_STMT* closure = new_stmt(builder->program, stmt->line);
+
+  builder->built = (struct CLOSURE_BUILT*)grow(builder->built, builder->num_built,
+    &builder->built_capacity, sizeof(struct CLOSURE_BUILT));
+  builder->built[builder->num_built].stmt = stmt;
+  builder->built[builder->num_built].closure = closure;
+  builder->num_built++;
+
+  builder->pending = (struct CLOSURE_BUILT*)grow(builder->pending, builder->num_pending,
+    &builder->pending_capacity, sizeof(struct CLOSURE_BUILT));
+  builder->pending[builder->num_pending].stmt = stmt;
+  builder->pending[builder->num_pending].closure = closure;
+  builder->num_pending++;
+
+  return closure;
+}
+
+//
+// build_stmt
+//
+// Fills in the closure for the given statement.
+//
+static void build_stmt(struct CLOSURE_BUILDER* builder, struct STMT* stmt, struct CLOSURE_STMT* closure)
+{
+  struct CLOSURE_PROGRAM* program = builder->program;
+  int line = stmt->line;
+
+  if (stmt->stmt_type == STMT_ASSIGNMENT) {
+
+    struct STMT_ASSIGNMENT* assign = stmt->types.assignment;
+
+    if (assign->rhs->value_type == VALUE_FUNCTION_CALL) {
+      struct VALUE_FUNCTION_CALL* call = assign->rhs->types.function_call;
+
+      closure->expr = build_call(program, line, call->function_name, call->parameter);
+    }
+    else {
+      closure->expr = build_expr(program, line, assign->rhs->types.expr);
+    }
+
+    closure->var = var_index(program, assign->var_name);
+    closure->next = closure_for(builder, assign->next_stmt);
+
+    if (assign->isPtrDeref)
+      closure->exec = exec_assign_ptr;
+    else
+      closure->exec = exec_assign;
+
+    if (!assign->isPtrDeref && is_var_op_int_const(closure->expr)) {
+      switch (closure->expr->operator) {
+#define CLOSURE_SELECT(name, operator, box, c_op, int_op) case operator: closure->exec = exec_assign_##name##_var_const; break;
+        CLOSURE_INT_OPS(CLOSURE_SELECT)
+#undef CLOSURE_SELECT
+      }
+    }
+    else if (!assign->isPtrDeref && closure->expr->operator == OPERATOR_PLUS &&
+      is_var(closure->expr->lhs) && closure->expr->lhs->var == closure->var)
+    {
+      closure->exec = exec_assign_append;
+    }
+  }
+  else if (stmt->stmt_type == STMT_FUNCTION_CALL) {
+
+    struct STMT_FUNCTION_CALL* call = stmt->types.function_call;
+
+    //
+    // print has closures of its own; any other function is
+    // called, and what it returns is discarded:
+    //
+    if (strcmp(call->function_name, "print") != 0) {
+      closure->exec = exec_call;
+      closure->expr = build_call(program, line, call->function_name, call->parameter);
+    }
+    else if (call->parameter == NULL) {
+      closure->exec = exec_print_nl;
+    }
+    else {
+      closure->exec = exec_print;
+      closure->expr = build_element(program, line, call->parameter);
+    }
+
+    closure->next = closure_for(builder, call->next_stmt);
+  }
+  else {
+    //
+    // if or while, both branch on a condition:
+    //
+    struct VALUE_EXPR* condition;
+
+    if (stmt->stmt_type == STMT_WHILE_LOOP) {
+      struct STMT_WHILE_LOOP* loop = stmt->types.while_loop;
+
+      condition = loop->condition;
+      closure->next = closure_for(builder, loop->loop_body);
+      closure->other = closure_for(builder, loop->next_stmt);
+    }
+    else {
+      assert(stmt->stmt_type == STMT_IF_THEN_ELSE);
+
+      struct STMT_IF_THEN_ELSE* ifthen = stmt->types.if_then_else;
+
+      condition = ifthen->condition;
+      closure->next = closure_for(builder, ifthen->true_path);
+      closure->other = closure_for(builder, ifthen->false_path);
+    }
+
+    closure->expr = build_expr(program, line, condition);
+    closure->exec = exec_branch;
+
+    if (is_var_op_int_const(closure->expr)) {
+      switch (closure->expr->operator) {
+#define CLOSURE_SELECT(name, operator, c_op) case operator: closure->exec = exec_branch_##name##_var_const; break;
+        CLOSURE_INT_COMPARES(CLOSURE_SELECT)
+#undef CLOSURE_SELECT
+      }
+    }
+  }
+}
+
+
+//
+// Public functions:
+//
+
+//
+// closure_compile
+//
+struct CLOSURE_PROGRAM* closure_compile(struct STMT* program)
+{
+  struct CLOSURE_PROGRAM* compiled = (struct CLOSURE_PROGRAM*)calloc(1, sizeof(struct CLOSURE_PROGRAM));
+  if (compiled == NULL)
+    panic("out of memory (closure_compile)");
+
+  struct CLOSURE_BUILDER builder;
+
+  builder.program = compiled;
+  builder.built = NULL;
+  builder.num_built = 0;
+  builder.built_capacity = 0;
+  builder.pending = NULL;
+  builder.num_pending = 0;
+  builder.pending_capacity = 0;
+
+  compiled->entry = closure_for(&builder, program);
+
+  while (builder.num_pending > 0) {
+    builder.num_pending--;
+
+    struct CLOSURE_BUILT* next = &builder.pending[builder.num_pending];
+
+    build_stmt(&builder, next->stmt, next->closure);
+  }
+
+  free(builder.built);
+  free(builder.pending);
+
+  return compiled;
+}
+
+//
+// closure_execute
+//
+void closure_execute(struct CLOSURE_PROGRAM* program, struct RAM* memory)
+{
+  //
+  // addresses depend on the memory, so look them up again:
+  //
+  for (int i = 0; i < program->num_vars; i++)
+    program->vars[i].address = -1;
+
+  //
+  // start accounting from what memory holds now:
+  //
+  runtime_begin(memory);
+
+  struct CLOSURE_CONTEXT context;
+
+  context.memory = memory;
+  context.scratch = arena_create(SCRATCH_ARENA_SIZE);
+  context.vars = program->vars;
+
+  //
+  // each stmt returns the next one, NULL at the end (or
+  // after an error):
+  //
+  struct CLOSURE_STMT* stmt = program->entry;
+
+  while (stmt != NULL)
+    stmt = stmt->exec(stmt, &context);
+
+  arena_destroy(context.scratch);
+
+  runtime_end();
+}
+
+//
+// closure_destroy
+//
+void closure_destroy(struct CLOSURE_PROGRAM* program)
+{
+  if (program == NULL)
+    panic("program ptr is null (closure_destroy)");
+
+  while (program->stmts != NULL) {
+    struct CLOSURE_STMT* next = program->stmts->next_closure;
+    free(program->stmts);
+    program->stmts = next;
+  }
+
+  while (program->exprs != NULL) {
+    struct CLOSURE_EXPR* next = program->exprs->next_closure;
+    free(program->exprs);
+    program->exprs = next;
+  }
+
+  free(program->vars);
+  free(program);
+}
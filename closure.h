@@ -0,0 +1,134 @@
+/*closure.h*/
+
+//
+// Closure-compiling engine for nuPython. Each statement and
+// expression of the program graph is converted, once, into a
+// closure: a struct holding a pointer to the C function that
+// executes it and the data that function needs. The function
+// is chosen when the closure is built, specialized for the
+// shape of the statement or expression --- e.g. "x = y + 1"
+// gets a function that adds an int variable and an int
+// constant and stores to a variable --- so all the decisions
+// the tree-walker makes each time a statement executes are
+// made just once.
+//
+// Executing the program is then a chain of indirect calls:
+// each statement closure executes and returns the closure of
+// the next statement to execute.
+//
+// The semantics --- operators, truth values, printing, and the
+// error messages --- are those of the tree-walking executor,
+// since both go through runtime.h.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+#pragma once
+
+#include <stdbool.h>  // true, false
+
+#include "programgraph.h"
+#include "ram.h"
+#include "box.h"
+#include "arena.h"
+#include "runtime.h"
+#include "builtins.h"
+
+
+//
+// What a closure needs while the program executes:
+//
+struct CLOSURE_CONTEXT
+{
+  struct RAM*         memory;
+  struct ARENA*       scratch;  // temporaries, reset after every stmt
+  struct RUNTIME_VAR* vars;     // the program's variables
+};
+
+//
+// An expression: evaluates into *value, returning false
+// (after outputting an error message) if that failed.
+//
+struct CLOSURE_EXPR
+{
+  bool (*eval)(struct CLOSURE_EXPR* self, struct CLOSURE_CONTEXT* context, struct BOXED_VALUE* value);
+
+  int    line;      // line # of the statement, for error messages
+  int    var;       // variable (index into vars), else -1
+  int    operator;  // enum OPERATORS, binary expressions only
+  struct BOXED_VALUE constant;  // literals only
+
+  struct CLOSURE_EXPR* lhs;  // binary expressions only
+  struct CLOSURE_EXPR* rhs;
+
+  struct BUILTIN*      builtin;  // function calls only
+  struct CLOSURE_EXPR* arg;      // the argument, NULL if none
+
+  struct CLOSURE_EXPR* next_closure;  // all the closures, for destroy
+};
+
+//
+// A statement: executes, and returns the statement to execute
+// next; NULL at the end of the program, or if an error occurred
+// (the error message has been output).
+//
+struct CLOSURE_STMT
+{
+  struct CLOSURE_STMT* (*exec)(struct CLOSURE_STMT* self, struct CLOSURE_CONTEXT* context);
+
+  int    line;  // line # of the statement, for error messages
+  int    var;   // variable assigned to, else -1
+  struct CLOSURE_EXPR* expr;  // rhs, condition, call, or print parameter
+
+  struct CLOSURE_STMT* next;     // next stmt, or the true path / loop body
+  struct CLOSURE_STMT* other;    // the false path / stmt after the loop
+
+  struct CLOSURE_STMT* next_closure;  // all the closures, for destroy
+};
+
+struct CLOSURE_PROGRAM
+{
+  struct CLOSURE_STMT* entry;  // first stmt, NULL if none
+
+  struct RUNTIME_VAR* vars;    // the variables
+  int    num_vars;
+  int    var_capacity;
+
+  struct CLOSURE_STMT* stmts;  // all the closures, for destroy
+  struct CLOSURE_EXPR* exprs;
+};
+
+
+//
+// Public functions:
+//
+
+//
+// closure_compile
+//
+// Given a nuPython program graph, converts it into closures
+// and returns a pointer to the dynamically-allocated program.
+//
+// NOTE: the closures refer to names and strings in the
+// program graph, so the graph must outlive the program.
+//
+struct CLOSURE_PROGRAM* closure_compile(struct STMT* program);
+
+//
+// closure_execute
+//
+// Executes the program against the given memory, exactly as
+// execute() would execute the program graph. If a semantic
+// error occurs, an error message is output and execution
+// stops. The program can be executed again.
+//
+void closure_execute(struct CLOSURE_PROGRAM* program, struct RAM* memory);
+
+//
+// closure_destroy
+//
+// Frees all the memory associated with the program.
+//
+void closure_destroy(struct CLOSURE_PROGRAM* program);
@@ -0,0 +1,446 @@
+/*escape.c*/
+
+//
+// Escape analysis for nuPython, see escape.h.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+// to eliminate warnings about stdlib in Visual Studio
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>  // true, false
+#include <string.h>
+#include <assert.h>
+
+#include "programgraph.h"
+#include "escape.h"
+#include "util.h"
+#include "walk.h"
+
+
+//
+// The statements of the program, and for each the variables
+// that have been assigned on every path to it:
+//
+struct ESCAPE_STMTS
+{
+  struct STMT** stmts;
+  int    num_stmts;
+  int    stmt_capacity;
+
+  bool*  assigned;  // num_stmts x num_vars, row per stmt
+};
+
+
+//
+// Private functions:
+//
+
+//
+// panic
+//
+// Outputs the given error message and exits.
+//
+static void panic(char* msg)
+{
+  printf("**ESCAPE ERROR\n");
+  printf("**ESCAPE ERROR: %s\n", msg);
+  printf("**ESCAPE ERROR\n");
+  exit(-1);
+}
+
+//
+// condition
+//
+// The expression a statement evaluates, NULL if none (or if
+// it's a function call).
+//
+static struct VALUE_EXPR* condition(struct STMT* stmt)
+{
+  if (stmt->stmt_type == STMT_ASSIGNMENT) {
+    struct VALUE* rhs = stmt->types.assignment->rhs;
+
+    if (rhs->value_type != VALUE_EXPR)
+      return NULL;
+
+    return rhs->types.expr;
+  }
+  else if (stmt->stmt_type == STMT_WHILE_LOOP)
+    return stmt->types.while_loop->condition;
+  else if (stmt->stmt_type == STMT_IF_THEN_ELSE)
+    return stmt->types.if_then_else->condition;
+  else
+    return NULL;
+}
+
+//
+// var_index
+//
+// Returns the index of the given variable, adding it if this
+// is the first reference.
+//
+static int var_index(struct ESCAPE_INFO* info, char* name)
+{
+  int v = walk_var_index(info->vars, info->num_vars, sizeof(struct ESCAPE_VAR), name);
+
+  if (v >= 0)
+    return v;
+
+  info->vars = (struct ESCAPE_VAR*)grow(info->vars, info->num_vars,
+    &info->var_capacity, sizeof(struct ESCAPE_VAR));
+
+  info->vars[info->num_vars].name = name;
+  info->vars[info->num_vars].escapes = false;
+
+  return info->num_vars++;
+}
+
+//
+// stmt_index
+//
+// Returns the index of the given statement, adding it if this
+// is the first reference.
+//
+static int stmt_index(struct ESCAPE_STMTS* stmts, struct STMT* stmt)
+{
+  for (int i = 0; i < stmts->num_stmts; i++)
+    if (stmts->stmts[i] == stmt)
+      return i;
+
+  stmts->stmts = (struct STMT**)grow(stmts->stmts, stmts->num_stmts,
+    &stmts->stmt_capacity, sizeof(struct STMT*));
+
+  stmts->stmts[stmts->num_stmts] = stmt;
+
+  return stmts->num_stmts++;
+}
+
+//
+// collect_var
+//
+// Notes a variable the program refers to (see walk_vars),
+// whether its address is taken, and whether it's a use of
+// pointers.
+//
+static void collect_var(void* context, char* name, int use)
+{
+  struct ESCAPE_INFO* info = (struct ESCAPE_INFO*)context;
+  int v = var_index(info, name);
+
+  if (use == WALK_ADDRESS_OF)
+    info->vars[v].escapes = true;
+
+  if (use == WALK_ADDRESS_OF || use == WALK_DEREF || use == WALK_STORED_VIA)
+    info->uses_pointers = true;
+}
+
+//
+// collect
+//
+// Finds all the statements of the program (in the order they
+// are reached), all the variables, which of them escape, and
+// whether the program uses pointers.
+//
+static void collect(struct ESCAPE_INFO* info, struct ESCAPE_STMTS* stmts, struct STMT* program)
+{
+  if (program == NULL)
+    return;
+
+  stmt_index(stmts, program);
+
+  for (int i = 0; i < stmts->num_stmts; i++) {
+    struct STMT* stmt = stmts->stmts[i];
+
+    walk_vars(stmt, collect_var, info);
+
+    struct STMT* next[2];
+    int n = walk_next(stmt, next);
+
+    for (int j = 0; j < n; j++)
+      if (next[j] != NULL)
+        stmt_index(stmts, next[j]);
+  }
+}
+
+//
+// assigned_var
+//
+// The variable the given statement assigns, -1 if none (*p =
+// assigns the variable p points to, not p).
+//
+static int assigned_var(struct ESCAPE_INFO* info, struct STMT* stmt)
+{
+  if (stmt->stmt_type != STMT_ASSIGNMENT || stmt->types.assignment->isPtrDeref)
+    return -1;
+
+  return var_index(info, stmt->types.assignment->var_name);
+}
+
+//
+// compute_assigned
+//
+// For each statement, the variables assigned on every path to
+// it: the intersection over its predecessors, iterated until
+// nothing changes. Every path starts at the first statement,
+// where nothing has been assigned.
+//
+static void compute_assigned(struct ESCAPE_INFO* info, struct ESCAPE_STMTS* stmts)
+{
+  int n = stmts->num_stmts;
+  int m = info->num_vars;
+
+  stmts->assigned = (bool*)malloc(sizeof(bool) * ((size_t)n * m + 1));
+  if (stmts->assigned == NULL)
+    panic("out of memory (escape)");
+
+  for (int i = 0; i < n * m; i++)
+    stmts->assigned[i] = (i >= m);  // everything, except at the start
+
+  bool* out = (bool*)malloc(sizeof(bool) * (m + 1));
+  if (out == NULL)
+    panic("out of memory (escape)");
+
+  bool changed = true;
+
+  while (changed) {
+    changed = false;
+
+    for (int i = 0; i < n; i++) {
+      struct STMT* stmt = stmts->stmts[i];
+
+      memcpy(out, &stmts->assigned[i * m], sizeof(bool) * m);
+
+      int v = assigned_var(info, stmt);
+      if (v >= 0)
+        out[v] = true;
+
+      struct STMT* next[2];
+      int num_next = walk_next(stmt, next);
+
+      for (int j = 0; j < num_next; j++) {
+        if (next[j] == NULL)
+          continue;
+
+        int s = stmt_index(stmts, next[j]);
+        if (s == 0)  // the start stays empty
+          continue;
+
+        for (int k = 0; k < m; k++)
+          if (stmts->assigned[s * m + k] && !out[k]) {
+            stmts->assigned[s * m + k] = false;
+            changed = true;
+          }
+      }
+    }
+  }
+
+  free(out);
+}
+
+//
+// is_assigned
+//
+// Has the given variable been assigned on every path to the
+// statement with the given index?
+//
+static bool is_assigned(struct ESCAPE_INFO* info, struct ESCAPE_STMTS* stmts, int s, int v)
+{
+  return stmts->assigned[s * info->num_vars + v];
+}
+
+//
+// is_pointer
+//
+// Is the value of the given expression, at the statement with
+// the given index, the address of a variable? It is if it's &x,
+// or a variable in pointers[] that has been assigned.
+//
+static bool is_pointer(struct ESCAPE_INFO* info, struct ESCAPE_STMTS* stmts, int s,
+  struct VALUE_EXPR* expr, bool* pointers)
+{
+  if (expr == NULL || expr->isBinaryExpr)
+    return false;
+
+  struct UNARY_EXPR* unary = expr->lhs;
+
+  if (unary->element->element_type != ELEMENT_IDENTIFIER)
+    return false;
+
+  if (unary->expr_type == UNARY_ADDRESS_OF)
+    return true;
+
+  if (unary->expr_type != UNARY_ELEMENT)
+    return false;
+
+  int v = var_index(info, unary->element->element_value);
+
+  return pointers[v] && is_assigned(info, stmts, s, v);
+}
+
+//
+// find_pointers
+//
+// Finds the variables that only ever hold the address of a
+// variable: starting from every variable that doesn't escape,
+// removes those assigned anything else, until nothing changes.
+//
+static void find_pointers(struct ESCAPE_INFO* info, struct ESCAPE_STMTS* stmts, bool* pointers)
+{
+  for (int v = 0; v < info->num_vars; v++)
+    pointers[v] = !info->vars[v].escapes;
+
+  bool changed = true;
+
+  while (changed) {
+    changed = false;
+
+    for (int s = 0; s < stmts->num_stmts; s++) {
+      struct STMT* stmt = stmts->stmts[s];
+      int v = assigned_var(info, stmt);
+
+      if (v < 0 || !pointers[v])
+        continue;
+
+      if (!is_pointer(info, stmts, s, condition(stmt), pointers)) {
+        pointers[v] = false;
+        changed = true;
+      }
+    }
+  }
+}
+
+//
+// is_confined
+//
+// Does the given unary expression, at the statement with the
+// given index, dereference anything but a variable in
+// pointers[] that has been assigned?
+//
+static bool is_confined(struct ESCAPE_INFO* info, struct ESCAPE_STMTS* stmts, int s,
+  struct UNARY_EXPR* unary, bool* pointers)
+{
+  if (unary == NULL || unary->expr_type != UNARY_PTR_DEREF)
+    return true;
+
+  if (unary->element->element_type != ELEMENT_IDENTIFIER)
+    return false;
+
+  int v = var_index(info, unary->element->element_value);
+
+  return pointers[v] && is_assigned(info, stmts, s, v);
+}
+
+//
+// check_confined
+//
+// Are the pointers confined (see escape.h)? Checks every
+// dereference in the program.
+//
+static bool check_confined(struct ESCAPE_INFO* info, struct ESCAPE_STMTS* stmts)
+{
+  bool* pointers = (bool*)malloc(sizeof(bool) * (info->num_vars + 1));
+  if (pointers == NULL)
+    panic("out of memory (escape)");
+
+  find_pointers(info, stmts, pointers);
+
+  bool confined = true;
+
+  for (int s = 0; s < stmts->num_stmts && confined; s++) {
+    struct STMT* stmt = stmts->stmts[s];
+    struct VALUE_EXPR* expr = condition(stmt);
+
+    if (expr != NULL)
+      confined = is_confined(info, stmts, s, expr->lhs, pointers)
+        && is_confined(info, stmts, s, expr->rhs, pointers);
+
+    if (confined && stmt->stmt_type == STMT_ASSIGNMENT && stmt->types.assignment->isPtrDeref) {
+      int v = var_index(info, stmt->types.assignment->var_name);
+
+      confined = pointers[v] && is_assigned(info, stmts, s, v);
+    }
+  }
+
+  free(pointers);
+
+  return confined;
+}
+
+
+//
+// Public functions:
+//
+
+//
+// escape_analyze
+//
+// Analyzes the given program graph, and returns a pointer to
+// the dynamically-allocated results.
+//
+struct ESCAPE_INFO* escape_analyze(struct STMT* program)
+{
+  struct ESCAPE_INFO* info = (struct ESCAPE_INFO*)malloc(sizeof(struct ESCAPE_INFO));
+  if (info == NULL)
+    panic("out of memory (escape)");
+
+  info->vars = NULL;
+  info->num_vars = 0;
+  info->var_capacity = 0;
+  info->uses_pointers = false;
+  info->confined = true;
+
+  struct ESCAPE_STMTS stmts = { NULL, 0, 0, NULL };
+
+  collect(info, &stmts, program);
+
+  if (info->uses_pointers) {
+    compute_assigned(info, &stmts);
+    info->confined = check_confined(info, &stmts);
+  }
+
+  free(stmts.stmts);
+  free(stmts.assigned);
+
+  return info;
+}
+
+//
+// escape_in_memory
+//
+// Returns true if the given variable must live in memory: the
+// program uses pointers, and either the variable escapes or
+// the pointers aren't confined.
+//
+bool escape_in_memory(struct ESCAPE_INFO* info, char* var_name)
+{
+  if (!info->uses_pointers)
+    return false;
+
+  if (!info->confined)
+    return true;
+
+  for (int i = 0; i < info->num_vars; i++)
+    if (strcmp(info->vars[i].name, var_name) == 0)
+      return info->vars[i].escapes;
+
+  return false;
+}
+
+//
+// escape_destroy
+//
+// Frees all the memory associated with the results.
+//
+void escape_destroy(struct ESCAPE_INFO* info)
+{
+  if (info == NULL)
+    return;
+
+  free(info->vars);
+  free(info);
+}
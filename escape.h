@@ -0,0 +1,77 @@
+/*escape.h*/
+
+//
+// Escape analysis for nuPython. A variable whose address is
+// taken (&x) escapes: a pointer can read or write its memory
+// cell, so an engine must keep it in memory. Every other
+// variable can live in a register or local, and only be
+// written to memory when the program stops --- provided the
+// pointers stay confined to the escaping variables.
+//
+// Pointer arithmetic (p + 1) can reach any cell, and so can a
+// pointer found in memory when the program starts (--ram). So
+// the pointers are confined only if every dereference (*p, and
+// *p = ...) goes through a variable p that
+//
+//   - doesn't escape itself,
+//   - is only ever assigned &x, or another such variable, and
+//   - has been assigned on every path to the dereference.
+//
+// If they aren't, every variable has to live in memory.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+#pragma once
+
+#include <stdbool.h>  // true, false
+
+#include "programgraph.h"
+
+
+struct ESCAPE_VAR
+{
+  char* name;           // in the program graph (first, see walk_var_index)
+  bool  escapes;        // is its address taken?
+};
+
+struct ESCAPE_INFO
+{
+  struct ESCAPE_VAR* vars;
+  int    num_vars;
+  int    var_capacity;
+
+  bool   uses_pointers; // does the program use & or *?
+  bool   confined;      // are the pointers confined, see above?
+};
+
+
+//
+// Public functions:
+//
+
+//
+// escape_analyze
+//
+// Analyzes the given program graph, and returns a pointer to
+// the dynamically-allocated results.
+//
+struct ESCAPE_INFO* escape_analyze(struct STMT* program);
+
+//
+// escape_in_memory
+//
+// Returns true if the given variable must live in memory: the
+// program uses pointers, and either the variable escapes or
+// the pointers aren't confined.
+//
+bool escape_in_memory(struct ESCAPE_INFO* info, char* var_name);
+
+//
+// escape_destroy
+//
+// Frees all the memory associated with the results.
+//
+void escape_destroy(struct ESCAPE_INFO* info);
@@ -3,9 +3,10 @@
 //
 // Executes nuPython program, given as a Program Graph. At this 
 // point we are supporting multiple data types (int, string, real,
-// boolean), and assignment statements with binary expressions.
+// boolean), assignment statements with binary expressions, while
+// loops, and if statements.
 // 
-// Solution by Prof. Joe Hummel
+// Solution by Prof. Joe Hummel
 // Modified by Hajo Wolfram
 // Northwestern University
 // CS 211
@@ -17,64 +18,89 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>  // true, false
+#include <stdint.h>
 #include <string.h>
 #include <assert.h>
-#include <math.h>
 
 #include "programgraph.h"
 #include "ram.h"
+#include "box.h"
+#include "arena.h"
+#include "output.h"
+#include "runtime.h"
+#include "builtins.h"
+#include "vm.h"
+#include "closure.h"
+#include "ssa.h"
 #include "execute.h"
 #include "util.h"
 
 
 //
-// Private functions:
+// engine used by execute(), see execute_set_engine:
 //
+static int engine = ENGINE_TREE;
 
 //
-// starts_with_zero
+// output the VM's site counters? see execute_set_vm_stats:
+//
+static bool vm_stats = false;
+
+//
+// output the SSA form? see execute_set_ssa_dump:
+//
+static bool ssa_dump = false;
+
 //
-// Returns true if the given string starts with a 
-// '0', false if not. Starting with a 0 is all you
-// need for atoi() and atof() to work successfully.
+// The builtin each call site calls, see execute_call: a hash
+// table keyed by the call's function name --- the pointer,
+// which belongs to the call site alone --- so the name is
+// looked up (builtin_lookup) once per site, as the compiling
+// engines do, rather than on every call. Open addressing,
+// at most half full:
 //
-static bool starts_with_zero(char* s)
+#define EXECUTE_SITES_CAPACITY 64  // initial, a power of 2
+
+struct EXECUTE_SITE
 {
-  if (strlen(s) > 0 && s[0] == '0')
-    return true;
+  char* function_name;  // NULL if the slot is empty
+  int   index;          // see builtin_lookup
+};
 
-  return false;
-}
+struct EXECUTE_SITES
+{
+  struct EXECUTE_SITE* slots;  // NULL: no table, look up every call
+  int capacity;
+  int count;
+};
 
 
 //
-// dupAndConcat
-// 
-// Given 2 strings, makes a copy by concatenating 
-// them together, and returns the copy.
-// 
-// NOTE: this function allocates memory for the copy,
-// the caller takes ownership of the copy and must
-// eventually free that memory.
+// Private functions:
+//
+
 //
-static char* dupAndConcat(char* s1, char* s2)
+// read_cell
+//
+// Given the name of a variable, returns the value stored in
+// its memory cell (by value, without allocating memory).
+// Returns RUNTIME_UNDEFINED if the variable has not been
+// written to memory.
+//
+// NOTE: if the value is a string, the string still belongs
+// to the memory cell. It remains valid until that cell is
+// written again.
+//
+static int read_cell(struct RAM* memory, char* var_name, struct BOXED_VALUE* value)
 {
-  assert(s1 != NULL);
-  assert(s2 != NULL);
+  int address = ram_get_addr(memory, var_name);
 
-  //
-  // be sure to include extra location for null terminator:
-  //
-  char* copy = (char*)malloc(sizeof(char) * (strlen(s1) + strlen(s2) + 1));
-  if (copy == NULL) {
-    printf("**EXECUTION ERROR: out of memory (dupAndConcat)");
-    return NULL;
-  }
+  if (address < 0)
+    return RUNTIME_UNDEFINED;
 
-  strcpy(copy, s1);
-  strcat(copy, s2);
+  *value = runtime_read_cell(memory, address);
 
-  return copy;
+  return RUNTIME_OK;
 }
 
 
@@ -82,86 +108,71 @@ static char* dupAndConcat(char* s1, char* s2)
 // get_element_value
 //
 // Given a basic element of an expression --- an identifier
-// "x" or some kind of literal like 123 --- the value of 
-// this identifier or literal is returned as a pointer to 
-// a RAM_VALUE that contains the value and it's type; NULL 
-// is returned if this failed.
+// "x" or some kind of literal like 123 --- the value of
+// this identifier or literal is returned in the given
+// RAM value; false is returned if this failed.
 //
-// Why would it fail? If the identifier does not exist in 
-// memory. This is a semantic error, and an error message is 
+// Why would it fail? If the identifier does not exist in
+// memory. This is a semantic error, and an error message is
 // output before returning.
 //
-// NOTE: this function allocates memory for the value that
-// is returned. The caller takes ownership of the copy and 
-// must eventually free this memory via ram_free_value().
+// NOTE: no memory is allocated. A string value refers to
+// the string in memory or in the program graph.
 //
-static struct RAM_VALUE* get_element_value(
-  struct STMT* stmt, 
-  struct RAM* memory, 
-  struct ELEMENT* element)
+static bool get_element_value(
+  struct STMT* stmt,
+  struct RAM* memory,
+  struct ELEMENT* element,
+  struct BOXED_VALUE* value)
 {
-  struct RAM_VALUE* value = NULL;
-
   if (element->element_type == ELEMENT_IDENTIFIER) {
     //
     // identifier => variable
     //
-    assert(element->element_type == ELEMENT_IDENTIFIER);
-
     char* var_name = element->element_value;
 
-    value = ram_read_cell_by_id(memory, var_name);
+    int status = read_cell(memory, var_name, value);
 
-    if (value == NULL) {
-      printf("**SEMANTIC ERROR: name '%s' is not defined (line %d)\n", var_name, stmt->line);
-      return NULL;
+    if (status != RUNTIME_OK) {
+      runtime_report(status, var_name, stmt->line);
+      return false;
     }
+
+    return true;
   }
-  else {
-    //
-    // one of the literal types, we need to allocate memory:
-    //
-    char* literal = element->element_value;
 
-    value = malloc(sizeof(struct RAM_VALUE));
-    if (value == NULL) {
-      printf("**EXECUTION ERROR: out of memory\n");
-      return NULL;
-    }
+  //
+  // one of the literal types:
+  //
+  char* literal = element->element_value;
 
-    switch (element->element_type) {
-    case ELEMENT_INT_LITERAL:
-      value->value_type = RAM_TYPE_INT;
-      value->types.i = atoi(literal);
-      break;
-
-    case ELEMENT_REAL_LITERAL:
-      value->value_type = RAM_TYPE_REAL;
-      value->types.d = atof(literal);
-      break;
-
-    case ELEMENT_STR_LITERAL:
-      value->value_type = RAM_TYPE_STR;
-      value->types.s = dupString(literal);
-      break;
-
-    case ELEMENT_TRUE:
-      value->value_type = RAM_TYPE_BOOLEAN;
-      value->types.i = 1;
-      break;
-
-    case ELEMENT_FALSE:
-      value->value_type = RAM_TYPE_BOOLEAN;
-      value->types.i = 0;
-      break;
-
-    default: 
-      printf("**EXECUTION ERROR: unexpected element type in get_element_value");
-      return NULL;
-    }
-  }//else
+  switch (element->element_type) {
+  case ELEMENT_INT_LITERAL:
+    *value = box_int(atoi(literal));
+    break;
+
+  case ELEMENT_REAL_LITERAL:
+    *value = box_real(atof(literal));
+    break;
+
+  case ELEMENT_STR_LITERAL:
+    *value = box_str(literal);
+    break;
+
+  case ELEMENT_TRUE:
+    *value = box_bool(true);
+    break;
 
-  return value;
+  case ELEMENT_FALSE:
+    *value = box_bool(false);
+    break;
+
+  default:
+    runtime_report(RUNTIME_UNEXPECTED_ELEMENT, NULL, stmt->line);
+    return false;
+  }
+
+  return true;
 }
 
 
@@ -171,491 +182,363 @@ static struct RAM_VALUE* get_element_value(
 // Given a unary expr, returns the value that it represents.
 // This could be the result of a literal 123 or the value
 // from memory for an identifier such as "x". Unary values
-// may have unary operators, such as + or -, applied.
-// This is returned as a pointer to a RAM_VALUE that contains
-// the value and it's type; NULL is returned if this failed.
+// may have unary operators, such as & or *, applied.
+// The value is returned in the given RAM value; false is
+// returned if this failed.
 //
-// Why would it fail? If the identifier does not exist in 
-// memory. This is a semantic error, and an error message is 
+// Why would it fail? If the identifier does not exist in
+// memory. This is a semantic error, and an error message is
 // output before returning.
 //
-// NOTE: this function allocates memory for the value that
-// is returned. The caller takes ownership of the copy and 
-// must eventually free this memory via ram_free_value().
+// NOTE: no memory is allocated, see get_element_value.
 //
-static struct RAM_VALUE* get_unary_value(
-  struct STMT* stmt, 
-  struct RAM* memory, 
-  struct UNARY_EXPR* unary)
+static bool get_unary_value(
+  struct STMT* stmt,
+  struct RAM* memory,
+  struct UNARY_EXPR* unary,
+  struct BOXED_VALUE* value)
 {
-  //
-  // we only have simple elements so far (no unary operators):
-  //
-  struct ELEMENT* element = unary->element;
-  
-  if (unary->expr_type == UNARY_ELEMENT) {
-
-    return get_element_value(stmt, memory, element);
-  }
-
-  else if (unary->expr_type == UNARY_ADDRESS_OF) {
-
-    //assert(element->element_type == ELEMENT_IDENTIFIER);
-
-    char* var_name = element->element_value;
-    int address = ram_get_addr(memory, var_name);
-    struct RAM_VALUE* value = (struct RAM_VALUE*)malloc(sizeof(struct RAM_VALUE));
-    
-    if (address < 0) {
-      printf("**SEMANTIC ERROR: name '%s' is not defined (line %d)\n", var_name, stmt->line);
-     
-      return NULL;
-      
-    }
-    
-    value->value_type = RAM_TYPE_PTR;
-    value->types.i = address;
-    return value;
-
-  }
-
-  else if (unary->expr_type == UNARY_PTR_DEREF) {
-    
-    struct RAM_VALUE* value = ram_read_cell_by_id(memory, unary->element->element_value);
-    char* var_name = unary->element->element_value;
-
-    if (value == NULL) {
-      printf("**SEMANTIC ERROR: name '%s' is not defined (line %d)\n", var_name, stmt->line);
-
-      return NULL;
-    }
-    
-    else if (value->types.i < 0 || value->types.i >= memory->num_values) {
-      printf("**SEMANTIC ERROR: '%s' contains invalid address (line %d)\n", var_name, stmt->line);
-    
-      return NULL;
-    }
-    else if (value->value_type != RAM_TYPE_PTR) {
-      printf("**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
-      
-      return NULL;
-    }
-
-    // returns a pointer to ram value containg address
-    //value = get_element_value(stmt, memory, element); 
-    
-    value = ram_read_cell_by_addr(memory, value->types.i);
-    return value;
-  }
-  
-  else {
-    printf("else block\n");
-    return NULL;
+  struct ELEMENT* element = unary->element;
+
+  if (unary->expr_type == UNARY_ELEMENT) {
+
+    return get_element_value(stmt, memory, element, value);
+  }
+
+  else if (unary->expr_type == UNARY_ADDRESS_OF) {
+
+    char* var_name = element->element_value;
+    int address = ram_get_addr(memory, var_name);
+
+    if (address < 0) {
+      runtime_report(RUNTIME_UNDEFINED, var_name, stmt->line);
+      return false;
+    }
+
+    *value = box_ptr(address);
+    return true;
+  }
+
+  else if (unary->expr_type == UNARY_PTR_DEREF) {
+
+    char* var_name = element->element_value;
+    struct BOXED_VALUE ptr;
+
+    int status = read_cell(memory, var_name, &ptr);
+
+    if (status == RUNTIME_OK)
+      status = runtime_check_ptr(memory, ptr);
+
+    if (status != RUNTIME_OK) {
+      runtime_report(status, var_name, stmt->line);
+      return false;
+    }
+
+    //
+    // ptr contains a valid address, return the value there:
+    //
+    *value = runtime_read_cell(memory, unbox_int(ptr));
+    return true;
+  }
+
+  else {
+    runtime_report(RUNTIME_UNSUPPORTED_UNARY, NULL, stmt->line);
+    return false;
   }
 }
 
 
 //
-// perform_int_operation
-// perform_real_operation
-// perform_str_comparison
+// execute_expr
 //
-// Given "lhs operator rhs", performs the operation 
-// and stores the result in the destination value.
+// Evaluates the given expression, either unary or binary,
+// and returns its value in the given RAM value. Returns true
+// if successful and false if not (an error message will be
+// output before false is returned).
 //
-static void perform_int_operation(
-  struct RAM_VALUE* dest, 
-  int lhs, 
-  int operator, 
-  int rhs)
+// Examples:
+//
+// 123
+// 123 + 456
+// x + 1
+// 2 * y
+// a ** b
+//
+// Temporaries are allocated from the scratch arena.
+//
+static bool execute_expr(
+  struct STMT* stmt,
+  struct RAM* memory,
+  struct ARENA* scratch,
+  struct VALUE_EXPR* expr,
+  struct BOXED_VALUE* value)
 {
   //
-  // make sure we are not overwriting string values
-  // which has memory consequences:
+  // we always have a LHS:
   //
-  assert(dest->value_type != RAM_TYPE_STR);
-
-  assert(operator == OPERATOR_PLUS ||
-    operator == OPERATOR_MINUS ||
-    operator == OPERATOR_ASTERISK ||
-    operator == OPERATOR_POWER ||
-    operator == OPERATOR_MOD ||
-    operator == OPERATOR_DIV ||
-    operator == OPERATOR_EQUAL ||
-    operator == OPERATOR_NOT_EQUAL ||
-    operator == OPERATOR_LT ||
-    operator == OPERATOR_LTE ||
-    operator == OPERATOR_GT ||
-    operator == OPERATOR_GTE
-  );
+  assert(expr->lhs != NULL);
 
-  //
-  // make sure the target cell is the correct type:
-  //
-  if (dest->value_type == RAM_TYPE_PTR) {
-    dest->value_type = RAM_TYPE_PTR;
-  }
-  else {
-    dest->value_type = RAM_TYPE_INT;
-  }
+  if (!get_unary_value(stmt, memory, expr->lhs, value))
+    return false;  // semantic error, return now
 
-  switch (operator)
+  //
+  // do we have a binary expression?
+  //
+  if (expr->isBinaryExpr)
   {
-  case OPERATOR_PLUS:
-    dest->types.i = lhs + rhs;
-    break;
-
-  case OPERATOR_MINUS:
-    dest->types.i = lhs - rhs;
-    break;
-
-  case OPERATOR_ASTERISK:
-    dest->types.i = lhs * rhs;
-    break;
-
-  case OPERATOR_POWER:
-    dest->types.i = (int)pow(lhs, rhs);
-    break;
+    assert(expr->rhs != NULL);  // we must have a RHS
+    assert(expr->operator != OPERATOR_NO_OP);  // we must have an operator
 
-  case OPERATOR_MOD:
-    dest->types.i = lhs % rhs;
-    break;
+    struct BOXED_VALUE rhs_value;
 
-  case OPERATOR_DIV:
-    dest->types.i = lhs / rhs;
-    break;
+    if (!get_unary_value(stmt, memory, expr->rhs, &rhs_value))
+      return false;  // semantic error, return now
 
-  case OPERATOR_EQUAL:
-    dest->value_type = RAM_TYPE_BOOLEAN;
+    //
+    // perform the operation, updating value:
+    //
+    int status = runtime_binary_op(scratch, value, expr->operator, &rhs_value);
 
-    if (lhs == rhs)
-      dest->types.i = 1;  // true
-    else
-      dest->types.i = 0;  // false
-    break;
+    if (status != RUNTIME_OK) {
+      runtime_report(status, NULL, stmt->line);
+      return false;
+    }
+  }
 
-  case OPERATOR_NOT_EQUAL:
-    dest->value_type = RAM_TYPE_BOOLEAN;
+  return true;
+}
 
-    if (lhs != rhs)
-      dest->types.i = 1;  // true
-    else
-      dest->types.i = 0;  // false
-    break;
 
-  case OPERATOR_LT:
-    dest->value_type = RAM_TYPE_BOOLEAN;
+//
+// execute_condition
+//
+// Evaluates the condition of an if or while statement into
+// the given boolean. Like Python, any value can serve as a
+// condition (see runtime_is_true). Returns true if successful
+// and false if not (an error message will be output before
+// false is returned).
+//
+static bool execute_condition(
+  struct STMT* stmt,
+  struct RAM* memory,
+  struct ARENA* scratch,
+  struct VALUE_EXPR* condition,
+  bool* result)
+{
+  struct BOXED_VALUE value;
 
-    if (lhs < rhs)
-      dest->types.i = 1;  // true
-    else
-      dest->types.i = 0;  // false
-    break;
+  if (!execute_expr(stmt, memory, scratch, condition, &value))
+    return false;
 
-  case OPERATOR_LTE:
-    dest->value_type = RAM_TYPE_BOOLEAN;
+  *result = runtime_is_true(value);
 
-    if (lhs <= rhs)
-      dest->types.i = 1;  // true
-    else
-      dest->types.i = 0;  // false
-    break;
+  return true;
+}
 
-  case OPERATOR_GT:
-    dest->value_type = RAM_TYPE_BOOLEAN;
 
-    if (lhs > rhs)
-      dest->types.i = 1;  // true
-    else
-      dest->types.i = 0;  // false
-    break;
+//
+// is_self_update
+//
+// Returns true if the given assignment updates a variable in
+// terms of itself: x = x op e.
+//
+static bool is_self_update(struct STMT_ASSIGNMENT* assign)
+{
+  if (assign->isPtrDeref)
+    return false;
 
-  case OPERATOR_GTE:
-    dest->value_type = RAM_TYPE_BOOLEAN;
+  struct VALUE_EXPR* expr = assign->rhs->types.expr;
 
-    if (lhs >= rhs)
-      dest->types.i = 1;  // true
-    else
-      dest->types.i = 0;  // false
-    break;
-  }
-  
+  return expr->isBinaryExpr &&
+    expr->lhs->expr_type == UNARY_ELEMENT &&
+    expr->lhs->element->element_type == ELEMENT_IDENTIFIER &&
+    strcmp(expr->lhs->element->element_value, assign->var_name) == 0;
 }
 
-static void perform_real_operation(
-  struct RAM_VALUE* dest, 
-  double lhs, 
-  int operator, 
-  double rhs)
-{
-  //
-  // make sure we are not overwriting string values,
-  // which has memory consequences:
-  //
-  assert(dest->value_type != RAM_TYPE_STR);
-
-  assert(operator == OPERATOR_PLUS ||
-    operator == OPERATOR_MINUS ||
-    operator == OPERATOR_ASTERISK ||
-    operator == OPERATOR_POWER ||
-    operator == OPERATOR_MOD ||
-    operator == OPERATOR_DIV ||
-    operator == OPERATOR_EQUAL ||
-    operator == OPERATOR_NOT_EQUAL ||
-    operator == OPERATOR_LT ||
-    operator == OPERATOR_LTE ||
-    operator == OPERATOR_GT ||
-    operator == OPERATOR_GTE 
-  );
 
-  //
-  // make sure the target cell is the correct type:
-  //
-  dest->value_type = RAM_TYPE_REAL;
+//
+// execute_self_update
+//
+// Executes an assignment x = x op e (see is_self_update) in
+// place: the memory cell of x is looked up once, and updated
+// without going through the variable's name again. A string
+// append, s = s + t, grows the string in the cell (see
+// runtime_append). Returns true if successful and false if not
+// (an error message will be output before false is returned).
+//
+// Examples: i = i + 1
+//           s = s + "."
+//
+static bool execute_self_update(struct STMT* stmt, struct RAM* memory, struct ARENA* scratch)
+{
+  struct STMT_ASSIGNMENT* assign = stmt->types.assignment;
+  struct VALUE_EXPR* expr = assign->rhs->types.expr;
 
-  switch (operator)
-  {
-  case OPERATOR_PLUS:
-    dest->types.d = lhs + rhs;
-    break;
+  char* var_name = assign->var_name;
 
-  case OPERATOR_MINUS:
-    dest->types.d = lhs - rhs;
-    break;
+  int address = ram_get_addr(memory, var_name);
 
-  case OPERATOR_ASTERISK:
-    dest->types.d = lhs * rhs;
-    break;
+  if (address < 0) {
+    runtime_report(RUNTIME_UNDEFINED, var_name, stmt->line);
+    return false;
+  }
 
-  case OPERATOR_POWER:
-    dest->types.d = pow(lhs, rhs);
-    break;
+  struct BOXED_VALUE value = runtime_read_cell(memory, address);
+  struct BOXED_VALUE rhs_value;
 
-  case OPERATOR_MOD:
-    dest->types.d = fmod(lhs, rhs);
-    break;
+  if (!get_unary_value(stmt, memory, expr->rhs, &rhs_value))
+    return false;  // semantic error, return now
 
-  case OPERATOR_DIV:
-    dest->types.d = lhs / rhs;
-    break;
+  int status;
 
-  case OPERATOR_EQUAL:
-    dest->value_type = RAM_TYPE_BOOLEAN;
+  if (expr->operator == OPERATOR_PLUS &&
+    unbox_type(value) == RAM_TYPE_STR &&
+    unbox_type(rhs_value) == RAM_TYPE_STR &&
+    unbox_str(rhs_value) != unbox_str(value))  // not s = s + s
+  {
+    status = runtime_append(memory, address, unbox_str(rhs_value));
 
-    if (lhs == rhs)
-      dest->types.i = 1;  // true
-    else
-      dest->types.i = 0;  // false
-    break;
+    if (status != RUNTIME_OK) {
+      runtime_report(status, NULL, stmt->line);
+      return false;
+    }
 
-  case OPERATOR_NOT_EQUAL:
-    dest->value_type = RAM_TYPE_BOOLEAN;
+    return true;
+  }
 
-    if (lhs != rhs)
-      dest->types.i = 1;  // true
-    else
-      dest->types.i = 0;  // false
-    break;
+  status = runtime_binary_op(scratch, &value, expr->operator, &rhs_value);
 
-  case OPERATOR_LT:
-    dest->value_type = RAM_TYPE_BOOLEAN;
+  if (status != RUNTIME_OK) {
+    runtime_report(status, NULL, stmt->line);
+    return false;
+  }
 
-    if (lhs < rhs)
-      dest->types.i = 1;  // true
-    else
-      dest->types.i = 0;  // false
-    break;
+  status = runtime_write_cell_by_addr(memory, value, address);
 
-  case OPERATOR_LTE:
-    dest->value_type = RAM_TYPE_BOOLEAN;
+  if (status != RUNTIME_OK) {
+    runtime_report(status, var_name, stmt->line);
+    return false;
+  }
 
-    if (lhs <= rhs)
-      dest->types.i = 1;  // true
-    else
-      dest->types.i = 0;  // false
-    break;
+  return true;
+}
 
-  case OPERATOR_GT:
-    dest->value_type = RAM_TYPE_BOOLEAN;
 
-    if (lhs > rhs)
-      dest->types.i = 1;  // true
-    else
-      dest->types.i = 0;  // false
-    break;
+//
+// site_slot
+//
+// Returns the slot for the given call site's function name:
+// the slot holding it, or the empty slot where it goes.
+//
+static struct EXECUTE_SITE* site_slot(struct EXECUTE_SITE* slots, int capacity, char* function_name)
+{
+  unsigned int mask = (unsigned int)capacity - 1;
+  unsigned int i = (unsigned int)(((uintptr_t)function_name >> 3) * 2654435761u) & mask;
 
-  case OPERATOR_GTE:
-    dest->value_type = RAM_TYPE_BOOLEAN;
+  while (slots[i].function_name != NULL && slots[i].function_name != function_name)
+    i = (i + 1) & mask;
 
-    if (lhs >= rhs)
-      dest->types.i = 1;  // true
-    else
-      dest->types.i = 0;  // false
-    break;
-  }
+  return &slots[i];
 }
 
-static void perform_str_operation(
-  struct RAM_VALUE* dest, 
-  char* lhs, 
-  int operator, 
-  char* rhs)
+//
+// site_builtin
+//
+// Returns the index of the builtin the given call site calls
+// (see builtin_lookup), looking it up the first time the site
+// is executed. If memory for the table runs out, the name is
+// looked up every time instead.
+//
+static int site_builtin(struct EXECUTE_SITES* sites, char* function_name)
 {
-  //
-  // let's confirm that the lhs and rhs are strings, and
-  // the dest is also a string that will be overwritten:
-  //
-  assert(dest->value_type == RAM_TYPE_STR);
-  assert(dest->types.s == lhs || dest->types.s == rhs);
-
-  assert(operator == OPERATOR_PLUS ||
-    operator == OPERATOR_EQUAL ||
-    operator == OPERATOR_NOT_EQUAL ||
-    operator == OPERATOR_LT ||
-    operator == OPERATOR_LTE ||
-    operator == OPERATOR_GT ||
-    operator == OPERATOR_GTE
-  );
-
-  switch (operator)
-  {
-  case OPERATOR_PLUS:
-    //
-    // string concatenation:
-    //
-    dest->value_type = RAM_TYPE_STR;
-    dest->types.s = dupAndConcat(lhs, rhs);
-    break;
+  if (sites->slots == NULL)
+    return builtin_lookup(function_name);
 
-  case OPERATOR_EQUAL:
-    dest->value_type = RAM_TYPE_BOOLEAN;
+  struct EXECUTE_SITE* slot = site_slot(sites->slots, sites->capacity, function_name);
 
-    if (strcmp(lhs, rhs) == 0)
-      dest->types.i = 1;  // true
-    else
-      dest->types.i = 0;  // false
-    break;
+  if (slot->function_name != NULL)
+    return slot->index;
 
-  case OPERATOR_NOT_EQUAL:
-    dest->value_type = RAM_TYPE_BOOLEAN;
+  int index = builtin_lookup(function_name);
 
-    if (strcmp(lhs, rhs) != 0)
-      dest->types.i = 1;  // true
-    else
-      dest->types.i = 0;  // false
-    break;
+  if (2 * (sites->count + 1) > sites->capacity) {
+    //
+    // the table would be more than half full, double it:
+    //
+    int capacity = 2 * sites->capacity;
+    struct EXECUTE_SITE* slots = (struct EXECUTE_SITE*)calloc(capacity, sizeof(struct EXECUTE_SITE));
 
-  case OPERATOR_LT:
-    dest->value_type = RAM_TYPE_BOOLEAN;
+    if (slots == NULL)
+      return index;
 
-    if (strcmp(lhs, rhs) < 0)
-      dest->types.i = 1;  // true
-    else
-      dest->types.i = 0;  // false
-    break;
+    for (int i = 0; i < sites->capacity; i++)
+      if (sites->slots[i].function_name != NULL)
+        *site_slot(slots, capacity, sites->slots[i].function_name) = sites->slots[i];
 
-  case OPERATOR_LTE:
-    dest->value_type = RAM_TYPE_BOOLEAN;
+    free(sites->slots);
+    sites->slots = slots;
+    sites->capacity = capacity;
 
-    if (strcmp(lhs, rhs) <= 0)
-      dest->types.i = 1;  // true
-    else
-      dest->types.i = 0;  // false
-    break;
+    slot = site_slot(slots, capacity, function_name);
+  }
 
-  case OPERATOR_GT:
-    dest->value_type = RAM_TYPE_BOOLEAN;
+  slot->function_name = function_name;
+  slot->index = index;
+  sites->count++;
 
-    if (strcmp(lhs, rhs) > 0)
-      dest->types.i = 1;  // true
-    else
-      dest->types.i = 0;  // false
-    break;
+  return index;
+}
 
-  case OPERATOR_GTE:
-    dest->value_type = RAM_TYPE_BOOLEAN;
 
-    if (strcmp(lhs, rhs) >= 0)
-      dest->types.i = 1;  // true
-    else
-      dest->types.i = 0;  // false
-    break;
-  }
-}
-
-//
-// Given "lhs operator rhs", performs the operation 
-// and stores the result in the destination value.
-//
-
-struct RAM_VALUE* perform_ptr_operation(
-struct RAM_VALUE* lhs, 
-int operator, 
-struct RAM_VALUE* rhs)
-{
-  if (operator == OPERATOR_PLUS) {
-    lhs->types.i = lhs->types.i + rhs->types.i;
-  }
-  else if (operator == OPERATOR_MINUS) {
-    lhs->types.i = lhs->types.i - rhs->types.i;
-  }
-  return lhs;
-}
 //
-// execute_binary_expr
+// execute_call
+//
+// Calls the builtin function with the given name (see
+// builtins.h, and site_builtin), passing the given parameter
+// if any (else NULL), and returns its result in the given
+// value. Returns true if successful and false if not (an
+// error message will be output before false is returned).
+//
+// Examples: print(x)
+//           int("123")
+//           len(s)
 //
-// Given two values and an operator, performs the operation
-// and updates the value in the lhs. Returns true if successful,
-// false if not.
+// A string result comes from the scratch arena.
 //
-static bool execute_binary_expr(
-  struct STMT* stmt, 
-  struct RAM_VALUE* lhs, 
-  int operator, 
-  struct RAM_VALUE* rhs)
+static bool execute_call(
+  struct STMT* stmt,
+  struct RAM* memory,
+  struct ARENA* scratch,
+  struct EXECUTE_SITES* sites,
+  char* function_name,
+  struct ELEMENT* parameter,
+  struct BOXED_VALUE* value)
 {
-  assert(lhs != NULL);
-  assert(rhs != NULL);
-  assert(operator != OPERATOR_NO_OP);
+  int index = site_builtin(sites, function_name);
+
+  if (index < 0) {
+    runtime_report(RUNTIME_UNDEFINED, function_name, stmt->line);
+    return false;
+  }
 
   //
-  // perform the operation:
+  // the parameter is a simple element, i.e. identifier or
+  // literal (or True, False, None):
   //
-  if (lhs->value_type == RAM_TYPE_INT && rhs->value_type == RAM_TYPE_INT) {
+  struct BOXED_VALUE args[BUILTIN_MAX_ARGS];
+  int num_args = 0;
 
-    perform_int_operation(lhs, lhs->types.i, operator, rhs->types.i);
-  }
-  else if (lhs->value_type == RAM_TYPE_REAL && rhs->value_type == RAM_TYPE_REAL) {
+  if (parameter != NULL) {
+    if (!get_element_value(stmt, memory, parameter, &args[num_args]))
+      return false;  // semantic error
 
-    perform_real_operation(lhs, lhs->types.d, operator, rhs->types.d);
+    num_args++;
   }
-  else if (lhs->value_type == RAM_TYPE_INT && rhs->value_type == RAM_TYPE_REAL) {
 
-    perform_real_operation(lhs, lhs->types.i, operator, rhs->types.d);
-  }
-  else if (lhs->value_type == RAM_TYPE_REAL && rhs->value_type == RAM_TYPE_INT) {
-
-    perform_real_operation(lhs, lhs->types.d, operator, rhs->types.i);
-  }
-  else if (lhs->value_type == RAM_TYPE_PTR || rhs->value_type == RAM_TYPE_PTR) {
-
-    lhs = perform_ptr_operation(lhs, operator, rhs);
-  }
-  
-  else if (lhs->value_type == RAM_TYPE_STR &&
-    rhs->value_type == RAM_TYPE_STR &&
-    (operator == OPERATOR_PLUS ||
-      operator == OPERATOR_EQUAL ||
-      operator == OPERATOR_NOT_EQUAL ||
-      operator == OPERATOR_LT ||
-      operator == OPERATOR_LTE ||
-      operator == OPERATOR_GT ||
-      operator == OPERATOR_GTE)) {
-
-    perform_str_operation(lhs, lhs->types.s, operator, rhs->types.s);
-  }
-  else {
-    printf("**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
+  int status = builtin_call(builtin_get(index), scratch, args, num_args, value);
+
+  if (status != RUNTIME_OK) {
+    runtime_report(status, function_name, stmt->line);
     return false;
   }
 
@@ -666,198 +549,91 @@ static bool execute_binary_expr(
 //
 // execute_assignment
 //
-// Executes an assignment statement, returning true if 
+// Executes an assignment statement, returning true if
 // successful and false if not (an error message will be
 // output before false is returned, so the caller doesn't
 // need to output anything).
-// 
+//
 // Examples: x = 123
 //           y = x ** 2
 //
-static bool execute_assignment(struct STMT* stmt, struct RAM* memory)
+// Temporaries are allocated from the scratch arena.
+//
+static bool execute_assignment(struct STMT* stmt, struct RAM* memory, struct ARENA* scratch,
+  struct EXECUTE_SITES* sites)
 {
   struct STMT_ASSIGNMENT* assign = stmt->types.assignment;
 
   char* var_name = assign->var_name;
 
-  struct RAM_VALUE* value = NULL;
-
-  //
-  // no pointers yet:
-  //
-
-  //
-  // right now we only support expressions, no function calls:
-  //
-  assert(assign->rhs->value_type == VALUE_EXPR);
-
-  struct VALUE_EXPR* expr = assign->rhs->types.expr;
+  struct BOXED_VALUE value;
+  int status;
 
-  //
-  // We have an expression, either unary or binary.
-  //
-  // Examples:
-  // 
-  // 123
-  // 123 + 456
-  // x + 1
-  // 2 * y
-  // a ** b
-  //
-
-  //
-  // we always have a LHS:
-  //
-  assert(expr->lhs != NULL);
-
-  value = get_unary_value(stmt, memory, expr->lhs);
-  
-  if (value == NULL)  // semantic error? If so, return now:
-    return false;
+  if (assign->rhs->value_type == VALUE_FUNCTION_CALL) {
+    struct VALUE_FUNCTION_CALL* call = assign->rhs->types.function_call;
 
-  //
-  // do we have a binary expression?
-  //
-  if (expr->isBinaryExpr)
-  {
-    assert(expr->rhs != NULL);  // we must have a RHS
-    assert(expr->operator != OPERATOR_NO_OP);  // we must have an operator
-
-    struct RAM_VALUE* rhs_value = get_unary_value(stmt, memory, expr->rhs);
+    if (!execute_call(stmt, memory, scratch, sites, call->function_name, call->parameter, &value))
+      return false;  // semantic error, return now
+  }
+  else if (is_self_update(assign)) {
+    return execute_self_update(stmt, memory, scratch);
+  }
+  else if (!execute_expr(stmt, memory, scratch, assign->rhs->types.expr, &value)) {
+    return false;  // semantic error, return now
+  }
 
-    if (rhs_value == NULL)  // semantic error? If so, return now:
-      return false;
-
-    
+  if (assign->isPtrDeref) {
     //
-    // perform the operation, updating value:
+    // *p = value, make sure p holds a valid address:
     //
-    bool success = execute_binary_expr(stmt, value, expr->operator, rhs_value);
+    struct BOXED_VALUE ptr;
 
-    if (!success)
-      return false;
+    status = read_cell(memory, var_name, &ptr);
 
+    if (status == RUNTIME_OK)
+      status = runtime_check_ptr(memory, ptr);
+
+    if (status == RUNTIME_OK)
+      status = runtime_write_cell_by_addr(memory, value, unbox_int(ptr));
+  }
+  else {
     //
-    // success! Fall through and write the updated value:
+    // write the value to memory:
     //
-  }
-
-  
-  if (assign->isPtrDeref) {
-    //
-    // DO SOMETHING 
-    //
-    struct RAM_VALUE* original = ram_read_cell_by_id(memory, var_name);
-
-    if (original == NULL) {
-      printf("**SEMANTIC ERROR: name '%s' is not defined (line %d)\n", var_name, stmt->line);
-
-      return false;
-    }
-
-    else if (original->types.i < 0 || original->types.i >= memory->num_values) {
-      printf("**SEMANTIC ERROR: '%s' contains invalid address (line %d)\n", var_name, stmt->line);
-
-      return false;
-    }
-    else if (original->value_type != RAM_TYPE_PTR) {
-      printf("**SEMANTIC ERROR: invalid operand types (line %d)\n", stmt->line);
-
-      return false;
-    }
-
-    // returns a pointer to ram value containg address
-    //value = get_element_value(stmt, memory, element); 
-
-    bool success = ram_write_cell_by_addr(memory, *value, original->types.i);
-    return success;
-
-  }
-  
-  
-  //
-  // write the value to memory:
-  //
-  bool success = ram_write_cell_by_id(memory, *value, var_name);
+    status = runtime_write_cell_by_id(memory, value, var_name);
+  }
 
-  return success;
+  if (status != RUNTIME_OK) {
+    runtime_report(status, var_name, stmt->line);
+    return false;
+  }
+
+  return true;
 }
 
 
 //
 // execute_function_call
 //
-// Executes a function call statement, returning true if 
+// Executes a function call statement, returning true if
 // successful and false if not (an error message will be
 // output before false is returned, so the caller doesn't
-// need to output anything).
-// 
+// need to output anything). What the function returns is
+// discarded.
+//
 // Examples: print()
 //           print(x)
-//           print(123)
+//           input("press enter to continue")
+//
+// Temporaries are allocated from the scratch arena.
 //
-static bool execute_function_call(struct STMT* stmt, struct RAM* memory)
+static bool execute_function_call(struct STMT* stmt, struct RAM* memory, struct ARENA* scratch,
+  struct EXECUTE_SITES* sites)
 {
   struct STMT_FUNCTION_CALL* call = stmt->types.function_call;
+  struct BOXED_VALUE result;
 
-  char* function_name = call->function_name;
-
-  //
-  // there's only one function we support as a statement: print
-  //
-  assert(strcmp(function_name, "print") == 0);
-
-  //
-  // print the parameter:
-  //
-  if (call->parameter == NULL) {
-    printf("\n");
-  }
-  else {
-    //
-    // we have a parameter, which type of parameter?
-    // Note that a parameter is a simple element, i.e.
-    // identifier or literal (or True, False, None):
-    //
-    struct RAM_VALUE* value = get_element_value(stmt, memory, call->parameter);
-
-    if (value == NULL)  // semantic error?
-      return false;
-
-    //
-    // now just print the value:
-    //
-    switch (value->value_type) {
-    case RAM_TYPE_INT:
-      printf("%d\n", value->types.i);
-      break;
-
-    case RAM_TYPE_REAL:
-      printf("%lf\n", value->types.d);
-      break;
-
-    case RAM_TYPE_STR:
-      printf("%s\n", value->types.s);
-      break;
-
-    case RAM_TYPE_BOOLEAN:
-      if (value->types.i == 0)
-        printf("False\n");
-      else
-        printf("True\n");
-      break;
-
-      case RAM_TYPE_PTR:
-      printf("%d\n", value->types.i);
-      break;
-      
-    default:
-      printf("**EXECUTION ERROR: unexpected element type in execute_function_call");
-      return false;
-    }
-  }
-
-  return true;
+  return execute_call(stmt, memory, scratch, sites, call->function_name, call->parameter, &result);
 }
 
 
@@ -876,12 +652,63 @@ static bool execute_function_call(struct STMT* stmt, struct RAM* memory)
 //
 void execute(struct STMT* program, struct RAM* memory)
 {
+  if (engine == ENGINE_VM) {
+    struct VM_PROGRAM* compiled = vm_compile(program);
+
+    vm_execute(compiled, memory);
+
+    if (vm_stats)
+      vm_print_stats(compiled);
+
+    vm_destroy(compiled);
+    return;
+  }
+
+  if (engine == ENGINE_CLOSURE) {
+    struct CLOSURE_PROGRAM* compiled = closure_compile(program);
+
+    closure_execute(compiled, memory);
+    closure_destroy(compiled);
+    return;
+  }
+
+  if (engine == ENGINE_SSA) {
+    struct SSA_PROGRAM* compiled = ssa_compile(program);
+
+    if (ssa_dump)
+      ssa_print(compiled);
+
+    ssa_execute(compiled, memory);
+    ssa_destroy(compiled);
+    return;
+  }
+
   //
   // execute the program, stmt by stmt, until we 
   // fall off the end of the list (i.e. NULL):
   //
   struct STMT* stmt = program;
 
+  //
+  // start accounting from what memory holds now:
+  //
+  runtime_begin(memory);
+
+  //
+  // temporaries come from a scratch arena that is reset
+  // after every statement:
+  //
+  struct ARENA* scratch = arena_create(SCRATCH_ARENA_SIZE);
+
+  //
+  // the builtins called, by call site (see site_builtin):
+  //
+  struct EXECUTE_SITES sites;
+
+  sites.capacity = EXECUTE_SITES_CAPACITY;
+  sites.count = 0;
+  sites.slots = (struct EXECUTE_SITE*)calloc(sites.capacity, sizeof(struct EXECUTE_SITE));
+
   //
   // Traverse through the body of stmts:
   //
@@ -889,43 +716,63 @@ void execute(struct STMT* program, struct RAM* memory)
 
     if (stmt->stmt_type == STMT_ASSIGNMENT) {
 
-      bool success = execute_assignment(stmt, memory);
+      bool success = execute_assignment(stmt, memory, scratch, &sites);
+
+      arena_reset(scratch);
 
       if (!success)
-        return;
+        break;
 
       stmt = stmt->types.assignment->next_stmt;  // advance
     }
     else if (stmt->stmt_type == STMT_FUNCTION_CALL) {
 
-      bool success = execute_function_call(stmt, memory);
+      bool success = execute_function_call(stmt, memory, scratch, &sites);
+
+      arena_reset(scratch);
 
       if (!success)
-        return;
+        break;
 
       stmt = stmt->types.function_call->next_stmt;
     }
     else if (stmt->stmt_type == STMT_WHILE_LOOP) {
-      
+
       //
-      // while loops are not supported:
+      // evaluate the condition, and either enter the body
+      // or exit the loop. The last stmt in the body leads
+      // back here:
       //
-      printf("**EXECUTION ERROR\n");
-      printf("**EXECUTION ERROR: while loops are not supported.\n");
-      printf("**EXECUTION ERROR\n");
-      
-      break;
+      struct STMT_WHILE_LOOP* loop = stmt->types.while_loop;
+      bool condition;
+
+      bool success = execute_condition(stmt, memory, scratch, loop->condition, &condition);
+
+      arena_reset(scratch);
+
+      if (!success)
+        break;
+
+      stmt = condition ? loop->loop_body : loop->next_stmt;
     }
     else if (stmt->stmt_type == STMT_IF_THEN_ELSE) {
-      
+
       //
-      // if statements are not supported:
+      // evaluate the condition, and take one path or the
+      // other (an elif is an if on the false path). Both
+      // paths lead to the stmt after the if:
       //
-      printf("**EXECUTION ERROR\n");
-      printf("**EXECUTION ERROR: if statements are not supported.\n");
-      printf("**EXECUTION ERROR\n");
-      
-      break;
+      struct STMT_IF_THEN_ELSE* ifthen = stmt->types.if_then_else;
+      bool condition;
+
+      bool success = execute_condition(stmt, memory, scratch, ifthen->condition, &condition);
+
+      arena_reset(scratch);
+
+      if (!success)
+        break;
+
+      stmt = condition ? ifthen->true_path : ifthen->false_path;
     }
     else {
       assert(stmt->stmt_type == STMT_PASS);
@@ -938,9 +785,34 @@ void execute(struct STMT* program, struct RAM* memory)
     }
   }//while
 
-  //
-  // if we get here, we successfully executed the
-  // body of stmts:
-  //
+  free(sites.slots);
+  arena_destroy(scratch);
+
+  runtime_end();
+
   return;
 }
+
+//
+// execute_set_engine
+//
+void execute_set_engine(int new_engine)
+{
+  engine = new_engine;
+}
+
+//
+// execute_set_vm_stats
+//
+void execute_set_vm_stats(bool new_vm_stats)
+{
+  vm_stats = new_vm_stats;
+}
+
+//
+// execute_set_ssa_dump
+//
+void execute_set_ssa_dump(bool new_ssa_dump)
+{
+  ssa_dump = new_ssa_dump;
+}
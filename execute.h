@@ -10,9 +10,27 @@
 
 #pragma once
 
+#include <stdbool.h>  // true, false
+
 #include "programgraph.h"
 #include "ram.h"
 
+
+//
+// The engines that can execute a program: walking the program
+// graph (the default), compiling it to bytecode first (see
+// vm.h), converting it to closures first (see closure.h), or
+// converting it to optimized SSA form first (see ssa.h):
+//
+enum EXECUTE_ENGINES
+{
+  ENGINE_TREE = 0,
+  ENGINE_VM,
+  ENGINE_CLOSURE,
+  ENGINE_SSA
+};
+
+
 //
 // Public functions:
 //
@@ -27,3 +45,29 @@
 // and the function returns.
 //
 void execute(struct STMT* program, struct RAM* memory);
+
+//
+// execute_set_engine
+//
+// Selects the engine used by execute(), see enum
+// EXECUTE_ENGINES. The default is ENGINE_TREE.
+//
+void execute_set_engine(int engine);
+
+//
+// execute_set_vm_stats
+//
+// If true, execute() outputs the counters of the operator
+// sites after executing with ENGINE_VM, see vm_print_stats.
+// The default is false.
+//
+void execute_set_vm_stats(bool vm_stats);
+
+//
+// execute_set_ssa_dump
+//
+// If true, execute() outputs the optimized SSA form of the
+// program before executing it with ENGINE_SSA, see ssa_print.
+// The default is false.
+//
+void execute_set_ssa_dump(bool ssa_dump);
@@ -0,0 +1,208 @@
+/*format.c*/
+
+//
+// Fast formatting of numbers, see format.h.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+// to eliminate warnings about stdlib in Visual Studio
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>  // true, false
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#include "format.h"
+
+
+//
+// "00" "01" ... "99":
+//
+static const char digit_pairs[201] =
+  "00010203040506070809"
+  "10111213141516171819"
+  "20212223242526272829"
+  "30313233343536373839"
+  "40414243444546474849"
+  "50515253545556575859"
+  "60616263646566676869"
+  "70717273747576777879"
+  "80818283848586878889"
+  "90919293949596979899";
+
+//
+// reals from 2^64 up are formatted by snprintf:
+//
+#define FORMAT_UINT64_LIMIT 18446744073709551616.0
+
+
+//
+// Private functions:
+//
+
+//
+// format_uint
+//
+// Formats the given unsigned integer into the given buffer
+// (at least 20 chars), and returns the # of chars. No null
+// terminator.
+//
+static int format_uint(char* buffer, uint64_t n)
+{
+  char digits[20];
+  char* p = digits + sizeof(digits);
+
+  while (n >= 100) {
+    int pair = (int)(n % 100) * 2;
+
+    n /= 100;
+    p -= 2;
+    memcpy(p, &digit_pairs[pair], 2);
+  }
+
+  if (n >= 10) {
+    p -= 2;
+    memcpy(p, &digit_pairs[n * 2], 2);
+  }
+  else {
+    *--p = (char)('0' + n);
+  }
+
+  int length = (int)(digits + sizeof(digits) - p);
+
+  memcpy(buffer, p, length);
+
+  return length;
+}
+
+//
+// scale_fraction
+//
+// Given a fraction 0 <= f < 1, returns f * 10^6 rounded to the
+// nearest integer, ties to even (so 1000000 if f rounds up
+// to 1).
+//
+// f = m / 2^k exactly, with m < 2^53 and k >= 53, so f * 10^6
+// = m * 10^6 / 2^k, where m * 10^6 < 2^73 is computed in two
+// 64-bit halves.
+//
+static uint64_t scale_fraction(double f)
+{
+  if (f == 0.0)
+    return 0;
+
+  int exponent;
+  double mantissa = frexp(f, &exponent);  // f = mantissa * 2^exponent
+
+  uint64_t m = (uint64_t)ldexp(mantissa, 53);
+  int k = 53 - exponent;
+
+  if (k > 74)
+    return 0;  // f * 10^6 < 2^73 / 2^75, rounds down
+
+  //
+  // m * 10^6 = hi * 2^64 + lo:
+  //
+  uint64_t low_product = (m & 0xFFFFFFFFULL) * 1000000ULL;  // < 2^52
+  uint64_t high_product = (m >> 32) * 1000000ULL;           // < 2^41
+
+  uint64_t lo = (high_product << 32) + low_product;
+  uint64_t hi = (high_product >> 32) + (lo < low_product ? 1 : 0);
+
+  //
+  // shift right by k - 1, keeping the half bit (the lowest bit
+  // of q2) and whether anything below it is set (sticky):
+  //
+  int shift = k - 1;  // 52 .. 73
+  uint64_t q2;
+  bool sticky;
+
+  if (shift < 64) {
+    q2 = (hi << (64 - shift)) | (lo >> shift);
+    sticky = (lo & ((1ULL << shift) - 1)) != 0;
+  }
+  else {
+    q2 = hi >> (shift - 64);
+    sticky = lo != 0 || (hi & ((1ULL << (shift - 64)) - 1)) != 0;
+  }
+
+  uint64_t q = q2 >> 1;
+
+  if ((q2 & 1) && (sticky || (q & 1)))
+    q++;
+
+  return q;
+}
+
+
+//
+// Public functions:
+//
+
+//
+// format_int
+//
+int format_int(char* buffer, int value)
+{
+  char* p = buffer;
+  int64_t n = value;  // so INT_MIN can be negated
+
+  if (n < 0) {
+    *p++ = '-';
+    n = -n;
+  }
+
+  p += format_uint(p, (uint64_t)n);
+  *p = '\0';
+
+  return (int)(p - buffer);
+}
+
+//
+// format_real
+//
+int format_real(char* buffer, double value)
+{
+  if (!isfinite(value) || fabs(value) >= FORMAT_UINT64_LIMIT)
+    return snprintf(buffer, FORMAT_REAL_SIZE, "%lf", value);
+
+  char* p = buffer;
+
+  if (signbit(value)) {  // including -0.0, as printf does
+    *p++ = '-';
+    value = -value;
+  }
+
+  double whole = floor(value);
+
+  uint64_t integer = (uint64_t)whole;
+  uint64_t fraction = scale_fraction(value - whole);  // exact difference
+
+  if (fraction == 1000000) {  // can't overflow, a real >= 2^53 has no fraction
+    integer++;
+    fraction = 0;
+  }
+
+  p += format_uint(p, integer);
+
+  //
+  // and the 6 digits after the point, 2 at a time:
+  //
+  int f = (int)fraction;
+
+  p[0] = '.';
+  memcpy(p + 1, &digit_pairs[(f / 10000) * 2], 2);
+  memcpy(p + 3, &digit_pairs[(f / 100 % 100) * 2], 2);
+  memcpy(p + 5, &digit_pairs[(f % 100) * 2], 2);
+  p += 7;
+
+  *p = '\0';
+
+  return (int)(p - buffer);
+}
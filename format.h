@@ -0,0 +1,55 @@
+/*format.h*/
+
+//
+// Fast formatting of numbers, as print() outputs them: ints as
+// printf("%d") does, and reals as printf("%lf") does --- fixed
+// notation with 6 digits after the decimal point, correctly
+// rounded (ties to even). The output is the same as printf's,
+// character for character, without parsing a format string or
+// going through stdio.
+//
+// Integers are converted two digits at a time, from a table of
+// the 100 digit pairs. A real is split into its integer part
+// and its fraction, and the fraction, an exact binary value
+// m / 2^k, is scaled by 10^6 and rounded in 128-bit integer
+// arithmetic. Reals too large for 64 bits, infinity and NaN
+// are left to snprintf.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+#pragma once
+
+
+//
+// # of chars needed to format any int / real, including the
+// null terminator:
+//
+#define FORMAT_INT_SIZE  12
+#define FORMAT_REAL_SIZE 320
+
+
+//
+// Public functions:
+//
+
+//
+// format_int
+//
+// Formats the given int into the given buffer, which must
+// hold at least FORMAT_INT_SIZE chars, as printf("%d") does.
+// Returns the # of chars, not including the null terminator.
+//
+int format_int(char* buffer, int value);
+
+//
+// format_real
+//
+// Formats the given real into the given buffer, which must
+// hold at least FORMAT_REAL_SIZE chars, as printf("%lf")
+// does. Returns the # of chars, not including the null
+// terminator.
+//
+int format_real(char* buffer, double value);
@@ -0,0 +1,1017 @@
+/*jit.c*/
+
+//
+// Baseline JIT compiler for the VM's while loops, see jit.h.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+// to eliminate warnings about stdlib in Visual Studio
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>  // true, false
+#include <stdint.h>
+#include <string.h>
+#include <assert.h>
+
+//
+// machine code is only generated for x86-64, on systems where
+// we know how to get executable memory:
+//
+#if defined(__x86_64__) && (defined(__linux__) || defined(__APPLE__))
+#define JIT_X86_64 1
+#include <sys/mman.h>
+#else
+#define JIT_X86_64 0
+#endif
+
+#include "programgraph.h"
+#include "ram.h"
+#include "box.h"
+#include "runtime.h"
+#include "vm.h"
+#include "output.h"
+#include "jit.h"
+
+
+//
+// is the JIT on? see jit_set_enabled:
+//
+static bool enabled = true;
+
+//
+// The compiled code is called with a pointer to a frame, which
+// holds the values of the loop's variables (in the order of
+// JIT_LOOP.vars) on entry and exit:
+//
+union JIT_SLOT
+{
+  int      i;
+  double   d;
+  uint64_t bits;
+};
+
+typedef void (*JIT_FUNCTION)(union JIT_SLOT* frame);
+
+#if JIT_X86_64
+
+//
+// x86-64 general purpose registers, by encoding:
+//
+enum JIT_GPRS
+{
+  JIT_RAX = 0, JIT_RCX, JIT_RDX, JIT_RBX, JIT_RSP, JIT_RBP, JIT_RSI, JIT_RDI,
+  JIT_R8, JIT_R9, JIT_R10, JIT_R11, JIT_R12, JIT_R13, JIT_R14, JIT_R15
+};
+
+//
+// Registers holding int variables; none of them needs saving.
+// The frame pointer arrives in rdi, and r11 is the scratch
+// register for computing:
+//
+static const int int_regs[] = { JIT_RAX, JIT_RCX, JIT_RDX, JIT_RSI, JIT_R8, JIT_R9, JIT_R10 };
+
+#define NUM_INT_REGS   (int)(sizeof(int_regs) / sizeof(int_regs[0]))
+#define FRAME_REG      JIT_RDI
+#define SCRATCH_REG    JIT_R11
+
+//
+// Real variables are held in xmm0 - xmm13; xmm14 and xmm15 are
+// the scratch registers for computing:
+//
+#define NUM_REAL_REGS  14
+#define XMM_RHS        14
+#define XMM_LHS        15
+
+//
+// x86 condition codes, for jcc:
+//
+enum JIT_CONDITIONS
+{
+  JIT_JB  = 0x2,
+  JIT_JAE = 0x3,
+  JIT_JE  = 0x4,
+  JIT_JNE = 0x5,
+  JIT_JBE = 0x6,
+  JIT_JA  = 0x7,
+  JIT_JP  = 0xA,
+  JIT_JL  = 0xC,
+  JIT_JGE = 0xD,
+  JIT_JLE = 0xE,
+  JIT_JG  = 0xF
+};
+
+//
+// the most jumps out of the loop the test can make:
+//
+#define MAX_EXITS 2
+
+//
+// An operand of an instruction, resolved: a variable of the
+// loop (index into JIT_LOOP.vars), or a constant:
+//
+struct JIT_OPERAND
+{
+  int    type;  // RAM_TYPE_INT or RAM_TYPE_REAL
+  int    var;   // -1 if a constant
+  int    i;
+  double d;
+};
+
+struct JIT_COMPILER
+{
+  struct VM_PROGRAM* program;
+  struct JIT_LOOP* loop;
+
+  unsigned char* code;
+  int size;
+  int capacity;
+
+  int exits[MAX_EXITS];  // jumps to patch with the exit
+  int num_exits;
+};
+
+#endif
+
+
+//
+// Private functions:
+//
+
+//
+// panic
+//
+// Outputs the given error message and exits.
+//
+static void panic(char* msg)
+{
+  output_flush();
+
+  printf("**JIT ERROR\n");
+  printf("**JIT ERROR: %s\n", msg);
+  printf("**JIT ERROR\n");
+  exit(-1);
+}
+
+#if JIT_X86_64
+
+//
+// byte
+// int32
+// int64
+//
+// Append to the machine code.
+//
+static void byte(struct JIT_COMPILER* compiler, int b)
+{
+  if (compiler->size == compiler->capacity) {
+    compiler->capacity = (compiler->capacity == 0) ? 256 : 2 * compiler->capacity;
+
+    compiler->code = (unsigned char*)realloc(compiler->code, compiler->capacity);
+    if (compiler->code == NULL)
+      panic("out of memory (jit_compile)");
+  }
+
+  compiler->code[compiler->size++] = (unsigned char)b;
+}
+
+static void int32(struct JIT_COMPILER* compiler, int32_t value)
+{
+  uint32_t v = (uint32_t)value;
+
+  for (int i = 0; i < 4; i++)
+    byte(compiler, (v >> (8 * i)) & 0xFF);
+}
+
+static void int64(struct JIT_COMPILER* compiler, uint64_t v)
+{
+  for (int i = 0; i < 8; i++)
+    byte(compiler, (v >> (8 * i)) & 0xFF);
+}
+
+//
+// rex
+// modrm
+//
+// The REX prefix (only if needed) and ModRM byte for the given
+// reg and r/m fields.
+//
+static void rex(struct JIT_COMPILER* compiler, bool w, int reg, int rm)
+{
+  int prefix = 0x40 | (w << 3) | ((reg >> 3) << 2) | (rm >> 3);
+
+  if (prefix != 0x40)
+    byte(compiler, prefix);
+}
+
+static void modrm(struct JIT_COMPILER* compiler, int mod, int reg, int rm)
+{
+  byte(compiler, (mod << 6) | ((reg & 7) << 3) | (rm & 7));
+}
+
+//
+// Integer instructions on 32-bit registers, as ints wrap around
+// like they do in C:
+//
+//   mov_rr    dst = src
+//   mov_ri    dst = imm
+//   alu_rr    dst op= src (add 0x01, sub 0x29, cmp 0x39)
+//   alu_ri    dst op= imm (add /0, sub /5, cmp /7)
+//   imul_rr   dst *= src
+//   imul_ri   dst = src * imm
+//   load      dst = frame[index]
+//   store     frame[index] = src
+//
+static void mov_rr(struct JIT_COMPILER* compiler, int dst, int src)
+{
+  rex(compiler, false, src, dst);
+  byte(compiler, 0x89);
+  modrm(compiler, 3, src, dst);
+}
+
+static void mov_ri(struct JIT_COMPILER* compiler, int dst, int imm)
+{
+  rex(compiler, false, 0, dst);
+  byte(compiler, 0xB8 + (dst & 7));
+  int32(compiler, imm);
+}
+
+static void alu_rr(struct JIT_COMPILER* compiler, int opcode, int dst, int src)
+{
+  rex(compiler, false, src, dst);
+  byte(compiler, opcode);
+  modrm(compiler, 3, src, dst);
+}
+
+static void alu_ri(struct JIT_COMPILER* compiler, int ext, int dst, int imm)
+{
+  rex(compiler, false, 0, dst);
+  byte(compiler, 0x81);
+  modrm(compiler, 3, ext, dst);
+  int32(compiler, imm);
+}
+
+static void imul_rr(struct JIT_COMPILER* compiler, int dst, int src)
+{
+  rex(compiler, false, dst, src);
+  byte(compiler, 0x0F);
+  byte(compiler, 0xAF);
+  modrm(compiler, 3, dst, src);
+}
+
+static void imul_ri(struct JIT_COMPILER* compiler, int dst, int src, int imm)
+{
+  rex(compiler, false, dst, src);
+  byte(compiler, 0x69);
+  modrm(compiler, 3, dst, src);
+  int32(compiler, imm);
+}
+
+static void load(struct JIT_COMPILER* compiler, int dst, int index)
+{
+  rex(compiler, false, dst, FRAME_REG);
+  byte(compiler, 0x8B);
+  modrm(compiler, 2, dst, FRAME_REG);
+  int32(compiler, index * (int)sizeof(union JIT_SLOT));
+}
+
+static void store(struct JIT_COMPILER* compiler, int src, int index)
+{
+  rex(compiler, false, src, FRAME_REG);
+  byte(compiler, 0x89);
+  modrm(compiler, 2, src, FRAME_REG);
+  int32(compiler, index * (int)sizeof(union JIT_SLOT));
+}
+
+//
+// SSE2 instructions on doubles:
+//
+//   sse_rr       dst op= src (movsd 0x10, addsd 0x58, mulsd
+//                0x59, subsd 0x5C, with prefix 0xF2; ucomisd
+//                0x2E with prefix 0x66)
+//   cvtsi2sd     dst = (double) the int in src
+//   movq         dst = the bits in src, a 64-bit register
+//   load_sd      dst = frame[index]
+//   store_sd     frame[index] = src
+//
+static void sse_rr(struct JIT_COMPILER* compiler, int prefix, int opcode, int dst, int src)
+{
+  byte(compiler, prefix);
+  rex(compiler, false, dst, src);
+  byte(compiler, 0x0F);
+  byte(compiler, opcode);
+  modrm(compiler, 3, dst, src);
+}
+
+static void cvtsi2sd(struct JIT_COMPILER* compiler, int dst, int src)
+{
+  sse_rr(compiler, 0xF2, 0x2A, dst, src);
+}
+
+static void movq(struct JIT_COMPILER* compiler, int dst, int src)
+{
+  byte(compiler, 0x66);
+  rex(compiler, true, dst, src);
+  byte(compiler, 0x0F);
+  byte(compiler, 0x6E);
+  modrm(compiler, 3, dst, src);
+}
+
+static void load_sd(struct JIT_COMPILER* compiler, int dst, int index)
+{
+  byte(compiler, 0xF2);
+  rex(compiler, false, dst, FRAME_REG);
+  byte(compiler, 0x0F);
+  byte(compiler, 0x10);
+  modrm(compiler, 2, dst, FRAME_REG);
+  int32(compiler, index * (int)sizeof(union JIT_SLOT));
+}
+
+static void store_sd(struct JIT_COMPILER* compiler, int src, int index)
+{
+  byte(compiler, 0xF2);
+  rex(compiler, false, src, FRAME_REG);
+  byte(compiler, 0x0F);
+  byte(compiler, 0x11);
+  modrm(compiler, 2, src, FRAME_REG);
+  int32(compiler, index * (int)sizeof(union JIT_SLOT));
+}
+
+//
+// jump
+// jcc
+//
+// Jumps with a 32-bit displacement to the given target; a
+// target of -1 leaves the displacement to be patched, see
+// jump_to_exit. Returns where the displacement is.
+//
+static int jump(struct JIT_COMPILER* compiler, int target)
+{
+  byte(compiler, 0xE9);
+  int32(compiler, (target < 0) ? 0 : target - (compiler->size + 4));
+
+  return compiler->size - 4;
+}
+
+static int jcc(struct JIT_COMPILER* compiler, int condition, int target)
+{
+  byte(compiler, 0x0F);
+  byte(compiler, 0x80 | condition);
+  int32(compiler, (target < 0) ? 0 : target - (compiler->size + 4));
+
+  return compiler->size - 4;
+}
+
+//
+// jump_to_exit
+//
+// Jumps out of the loop if the given condition holds; the
+// jump is patched once the exit has been emitted.
+//
+static void jump_to_exit(struct JIT_COMPILER* compiler, int condition)
+{
+  assert(compiler->num_exits < MAX_EXITS);
+
+  compiler->exits[compiler->num_exits++] = jcc(compiler, condition, -1);
+}
+
+//
+// add_var
+//
+// Returns the index of the loop variable in the given slot,
+// adding it if this is the first reference; its type is the
+// one it has in memory now. Returns -1 if the variable can't
+// be compiled: it doesn't exist yet, isn't an int or real, or
+// we're out of registers.
+//
+static int add_var(struct JIT_COMPILER* compiler, int slot, struct RAM* memory)
+{
+  struct JIT_LOOP* loop = compiler->loop;
+
+  for (int i = 0; i < loop->num_vars; i++)
+    if (loop->vars[i].slot == slot)
+      return i;
+
+  if (loop->num_vars == JIT_MAX_VARS)
+    return -1;
+
+  int address = runtime_lookup(memory, &compiler->program->vars[slot]);
+  if (address < 0)
+    return -1;
+
+  int type = unbox_type(runtime_read_cell(memory, address));
+  int num_ints = 0;
+  int num_reals = 0;
+
+  for (int i = 0; i < loop->num_vars; i++) {
+    if (loop->vars[i].type == RAM_TYPE_INT)
+      num_ints++;
+    else
+      num_reals++;
+  }
+
+  struct JIT_VAR* var = &loop->vars[loop->num_vars];
+
+  if (type == RAM_TYPE_INT && num_ints < NUM_INT_REGS)
+    var->reg = int_regs[num_ints];
+  else if (type == RAM_TYPE_REAL && num_reals < NUM_REAL_REGS)
+    var->reg = num_reals;
+  else
+    return -1;
+
+  var->slot = slot;
+  var->type = type;
+  var->written = false;
+
+  return loop->num_vars++;
+}
+
+//
+// resolve
+//
+// Resolves a VM operand: a variable, or a constant register.
+// Returns false if it's neither, or not an int or real.
+//
+static bool resolve(struct JIT_COMPILER* compiler, int operand, struct RAM* memory, struct JIT_OPERAND* result)
+{
+  if (operand < 0) {
+    result->var = add_var(compiler, VM_OPERAND_SLOT(operand), memory);
+    if (result->var < 0)
+      return false;
+
+    result->type = compiler->loop->vars[result->var].type;
+    return true;
+  }
+
+  //
+  // the temporaries only hold values between the instructions
+  // of something we don't compile:
+  //
+  if (operand <= VM_REG_RHS)
+    return false;
+
+  struct BOXED_VALUE constant = compiler->program->registers[operand];
+
+  result->var = -1;
+  result->type = unbox_type(constant);
+
+  if (result->type == RAM_TYPE_INT)
+    result->i = unbox_int(constant);
+  else if (result->type == RAM_TYPE_REAL)
+    result->d = unbox_real(constant);
+  else
+    return false;
+
+  return true;
+}
+
+//
+// result_type
+//
+// The type of "lhs op rhs": int if both are ints, else real.
+//
+static int result_type(struct JIT_OPERAND* lhs, struct JIT_OPERAND* rhs)
+{
+  if (lhs->type == RAM_TYPE_INT && rhs->type == RAM_TYPE_INT)
+    return RAM_TYPE_INT;
+
+  return RAM_TYPE_REAL;
+}
+
+//
+// reg
+//
+// The register of the given variable operand.
+//
+static int reg(struct JIT_COMPILER* compiler, struct JIT_OPERAND* operand)
+{
+  assert(operand->var >= 0);
+
+  return compiler->loop->vars[operand->var].reg;
+}
+
+//
+// load_int
+// load_real
+//
+// Loads an operand into the given register, converting an int
+// to a real for load_real.
+//
+static void load_int(struct JIT_COMPILER* compiler, int dst, struct JIT_OPERAND* operand)
+{
+  assert(operand->type == RAM_TYPE_INT);
+
+  if (operand->var >= 0)
+    mov_rr(compiler, dst, reg(compiler, operand));
+  else
+    mov_ri(compiler, dst, operand->i);
+}
+
+static void load_real(struct JIT_COMPILER* compiler, int dst, struct JIT_OPERAND* operand)
+{
+  if (operand->var >= 0) {
+    int src = reg(compiler, operand);
+
+    if (operand->type == RAM_TYPE_INT)
+      cvtsi2sd(compiler, dst, src);
+    else if (src != dst)
+      sse_rr(compiler, 0xF2, 0x10, dst, src);
+
+    return;
+  }
+
+  union JIT_SLOT constant;
+
+  constant.d = (operand->type == RAM_TYPE_INT) ? (double)operand->i : operand->d;
+
+  //
+  // mov r11, imm64; movq dst, r11:
+  //
+  rex(compiler, true, 0, SCRATCH_REG);
+  byte(compiler, 0xB8 + (SCRATCH_REG & 7));
+  int64(compiler, constant.bits);
+  movq(compiler, dst, SCRATCH_REG);
+}
+
+//
+// compile_test
+//
+// Compiles the loop test "lhs operator rhs", jumping out of
+// the loop if it's false. Returns false if it can't be
+// compiled.
+//
+static bool compile_test(struct JIT_COMPILER* compiler, struct VM_INSTR* instr, int operator, struct RAM* memory)
+{
+  struct JIT_OPERAND lhs, rhs;
+
+  if (!resolve(compiler, instr->b, memory, &lhs) || !resolve(compiler, instr->d, memory, &rhs))
+    return false;
+
+  if (result_type(&lhs, &rhs) == RAM_TYPE_INT) {
+    int left = SCRATCH_REG;
+
+    if (lhs.var >= 0)
+      left = reg(compiler, &lhs);
+    else
+      mov_ri(compiler, left, lhs.i);
+
+    if (rhs.var >= 0)
+      alu_rr(compiler, 0x39, left, reg(compiler, &rhs));
+    else
+      alu_ri(compiler, 7, left, rhs.i);
+
+    switch (operator) {
+    case OPERATOR_EQUAL:     jump_to_exit(compiler, JIT_JNE); break;
+    case OPERATOR_NOT_EQUAL: jump_to_exit(compiler, JIT_JE);  break;
+    case OPERATOR_LT:        jump_to_exit(compiler, JIT_JGE); break;
+    case OPERATOR_LTE:       jump_to_exit(compiler, JIT_JG);  break;
+    case OPERATOR_GT:        jump_to_exit(compiler, JIT_JLE); break;
+    default:                 jump_to_exit(compiler, JIT_JL);  break;
+    }
+
+    return true;
+  }
+
+  //
+  // reals: ucomisd sets CF for <, ZF for ==, and all of CF, ZF
+  // and PF if either is a NaN, which makes every test but !=
+  // false:
+  //
+  load_real(compiler, XMM_LHS, &lhs);
+  load_real(compiler, XMM_RHS, &rhs);
+
+  switch (operator) {
+  case OPERATOR_EQUAL:
+    sse_rr(compiler, 0x66, 0x2E, XMM_LHS, XMM_RHS);
+    jump_to_exit(compiler, JIT_JP);
+    jump_to_exit(compiler, JIT_JNE);
+    break;
+
+  case OPERATOR_NOT_EQUAL:
+    sse_rr(compiler, 0x66, 0x2E, XMM_LHS, XMM_RHS);
+    jcc(compiler, JIT_JP, compiler->size + 6 + 6);  // over the je
+    jump_to_exit(compiler, JIT_JE);
+    break;
+
+  case OPERATOR_LT:
+    sse_rr(compiler, 0x66, 0x2E, XMM_RHS, XMM_LHS);
+    jump_to_exit(compiler, JIT_JBE);
+    break;
+
+  case OPERATOR_LTE:
+    sse_rr(compiler, 0x66, 0x2E, XMM_RHS, XMM_LHS);
+    jump_to_exit(compiler, JIT_JB);
+    break;
+
+  case OPERATOR_GT:
+    sse_rr(compiler, 0x66, 0x2E, XMM_LHS, XMM_RHS);
+    jump_to_exit(compiler, JIT_JBE);
+    break;
+
+  default:
+    sse_rr(compiler, 0x66, 0x2E, XMM_LHS, XMM_RHS);
+    jump_to_exit(compiler, JIT_JB);
+    break;
+  }
+
+  return true;
+}
+
+//
+// compile_assign
+//
+// Compiles "dest = lhs operator rhs", or "dest = lhs" if the
+// operator is OPERATOR_NO_OP. Returns false if it can't be
+// compiled, which includes changing the type of dest.
+//
+static bool compile_assign(struct JIT_COMPILER* compiler, struct VM_INSTR* instr, int operator, struct RAM* memory)
+{
+  struct JIT_OPERAND dest, lhs, rhs;
+
+  if (instr->a >= 0 || !resolve(compiler, instr->a, memory, &dest))
+    return false;
+
+  if (!resolve(compiler, instr->b, memory, &lhs))
+    return false;
+
+  if (operator == OPERATOR_NO_OP)
+    rhs = lhs;
+  else if (!resolve(compiler, instr->d, memory, &rhs))
+    return false;
+
+  if (result_type(&lhs, &rhs) != dest.type)
+    return false;
+
+  compiler->loop->vars[dest.var].written = true;
+
+  int dst = reg(compiler, &dest);
+
+  if (operator == OPERATOR_NO_OP) {
+    if (dest.type == RAM_TYPE_INT)
+      load_int(compiler, dst, &lhs);
+    else
+      load_real(compiler, dst, &lhs);
+
+    return true;
+  }
+
+  if (dest.type == RAM_TYPE_INT) {
+    load_int(compiler, SCRATCH_REG, &lhs);
+
+    if (rhs.var >= 0) {
+      int src = reg(compiler, &rhs);
+
+      switch (operator) {
+      case OPERATOR_PLUS:  alu_rr(compiler, 0x01, SCRATCH_REG, src); break;
+      case OPERATOR_MINUS: alu_rr(compiler, 0x29, SCRATCH_REG, src); break;
+      default:             imul_rr(compiler, SCRATCH_REG, src);      break;
+      }
+    }
+    else {
+      switch (operator) {
+      case OPERATOR_PLUS:  alu_ri(compiler, 0, SCRATCH_REG, rhs.i); break;
+      case OPERATOR_MINUS: alu_ri(compiler, 5, SCRATCH_REG, rhs.i); break;
+      default:             imul_ri(compiler, SCRATCH_REG, SCRATCH_REG, rhs.i); break;
+      }
+    }
+
+    mov_rr(compiler, dst, SCRATCH_REG);
+    return true;
+  }
+
+  load_real(compiler, XMM_LHS, &lhs);
+
+  int src = XMM_RHS;
+
+  if (rhs.var >= 0 && rhs.type == RAM_TYPE_REAL)
+    src = reg(compiler, &rhs);
+  else
+    load_real(compiler, XMM_RHS, &rhs);
+
+  switch (operator) {
+  case OPERATOR_PLUS:  sse_rr(compiler, 0xF2, 0x58, XMM_LHS, src); break;
+  case OPERATOR_MINUS: sse_rr(compiler, 0xF2, 0x5C, XMM_LHS, src); break;
+  default:             sse_rr(compiler, 0xF2, 0x59, XMM_LHS, src); break;
+  }
+
+  sse_rr(compiler, 0xF2, 0x10, dst, XMM_LHS);
+  return true;
+}
+
+//
+// arith_operator
+// compare_operator
+//
+// The operator computed by the given instruction, in any of
+// its quickened forms; -1 if it's not an arithmetic (+ - *)
+// or compare-and-branch instruction.
+//
+static int arith_operator(int op)
+{
+  switch (op) {
+  case VM_ADD: case VM_ADD_II: case VM_ADD_RR: case VM_ADD_SS:
+    return OPERATOR_PLUS;
+  case VM_SUB: case VM_SUB_II: case VM_SUB_RR:
+    return OPERATOR_MINUS;
+  case VM_MUL: case VM_MUL_II: case VM_MUL_RR:
+    return OPERATOR_ASTERISK;
+  default:
+    return -1;
+  }
+}
+
+static int compare_operator(int op)
+{
+  switch (op) {
+  case VM_JEQ: case VM_JEQ_II: case VM_JEQ_RR: case VM_JEQ_SS:
+    return OPERATOR_EQUAL;
+  case VM_JNE: case VM_JNE_II: case VM_JNE_RR: case VM_JNE_SS:
+    return OPERATOR_NOT_EQUAL;
+  case VM_JLT: case VM_JLT_II: case VM_JLT_RR: case VM_JLT_SS:
+    return OPERATOR_LT;
+  case VM_JLE: case VM_JLE_II: case VM_JLE_RR: case VM_JLE_SS:
+    return OPERATOR_LTE;
+  case VM_JGT: case VM_JGT_II: case VM_JGT_RR: case VM_JGT_SS:
+    return OPERATOR_GT;
+  case VM_JGE: case VM_JGE_II: case VM_JGE_RR: case VM_JGE_SS:
+    return OPERATOR_GTE;
+  default:
+    return -1;
+  }
+}
+
+//
+// compile_loop
+//
+// Compiles the loop into the compiler's buffer:
+//
+//   load the variables from the frame into registers
+//   top:  the test, jumping to exit if false
+//         the body
+//         jump top
+//   exit: store the variables written back to the frame
+//         ret
+//
+// Returns false if the loop can't be compiled.
+//
+static bool compile_loop(struct JIT_COMPILER* compiler, struct VM_LOOP* loop, struct RAM* memory)
+{
+  struct VM_INSTR* code = compiler->program->code;
+
+  //
+  // the shape the VM compiles a loop to: LOOP, the test, the
+  // body, the test again, and the jump back to LOOP:
+  //
+  struct VM_INSTR* test = &code[loop->top + 1];
+  struct VM_INSTR* again = &code[loop->exit - 2];
+  struct VM_INSTR* back = &code[loop->exit - 1];
+
+  int operator = compare_operator(test->op);
+
+  if (operator < 0 || loop->body != loop->top + 2 || test->c != false)
+    return false;
+
+  if (compare_operator(again->op) != operator || again->a != loop->body || again->c != true)
+    return false;
+
+  if (back->op != VM_JUMP || back->a != loop->top)
+    return false;
+
+  //
+  // the loads are emitted last, once we know the variables;
+  // leave room by compiling the loop itself separately:
+  //
+  int top = compiler->size;
+
+  if (!compile_test(compiler, test, operator, memory))
+    return false;
+
+  for (int pc = loop->body; pc < loop->exit - 2; pc++) {
+    struct VM_INSTR* instr = &code[pc];
+
+    if (instr->op == VM_MOVE) {
+      if (!compile_assign(compiler, instr, OPERATOR_NO_OP, memory))
+        return false;
+    }
+    else {
+      int op = arith_operator(instr->op);
+
+      if (op < 0 || !compile_assign(compiler, instr, op, memory))
+        return false;
+    }
+  }
+
+  jump(compiler, top);
+
+  //
+  // the exit:
+  //
+  int exit = compiler->size;
+
+  for (int i = 0; i < compiler->num_exits; i++) {
+    int at = compiler->exits[i];
+    int32_t displacement = exit - (at + 4);
+
+    memcpy(&compiler->code[at], &displacement, 4);
+  }
+
+  struct JIT_LOOP* compiled = compiler->loop;
+
+  for (int i = 0; i < compiled->num_vars; i++) {
+    struct JIT_VAR* var = &compiled->vars[i];
+
+    if (!var->written)
+      continue;
+
+    if (var->type == RAM_TYPE_INT)
+      store(compiler, var->reg, i);
+    else
+      store_sd(compiler, var->reg, i);
+  }
+
+  byte(compiler, 0xC3);  // ret
+
+  return true;
+}
+
+//
+// prologue
+//
+// Returns the machine code that loads the loop's variables
+// from the frame, in a buffer of its own.
+//
+static struct JIT_COMPILER prologue(struct JIT_LOOP* loop)
+{
+  struct JIT_COMPILER compiler;
+
+  memset(&compiler, 0, sizeof(compiler));
+  compiler.loop = loop;
+
+  for (int i = 0; i < loop->num_vars; i++) {
+    struct JIT_VAR* var = &loop->vars[i];
+
+    if (var->type == RAM_TYPE_INT)
+      load(&compiler, var->reg, i);
+    else
+      load_sd(&compiler, var->reg, i);
+  }
+
+  return compiler;
+}
+
+#endif
+
+
+//
+// Public functions:
+//
+
+//
+// jit_set_enabled
+// jit_enabled
+//
+void jit_set_enabled(bool new_enabled)
+{
+  enabled = new_enabled;
+}
+
+bool jit_enabled(void)
+{
+  return enabled;
+}
+
+//
+// jit_compile
+//
+struct JIT_LOOP* jit_compile(struct VM_PROGRAM* program, struct VM_LOOP* loop, struct RAM* memory)
+{
+#if JIT_X86_64
+  struct JIT_LOOP* compiled = (struct JIT_LOOP*)calloc(1, sizeof(struct JIT_LOOP));
+  if (compiled == NULL)
+    panic("out of memory (jit_compile)");
+
+  struct JIT_COMPILER compiler;
+
+  memset(&compiler, 0, sizeof(compiler));
+  compiler.program = program;
+  compiler.loop = compiled;
+
+  if (!compile_loop(&compiler, loop, memory)) {
+    free(compiler.code);
+    free(compiled);
+    return NULL;
+  }
+
+  //
+  // the loop's code is relative to itself, so it can follow
+  // the prologue as is:
+  //
+  struct JIT_COMPILER start = prologue(compiled);
+
+  size_t size = (size_t)(start.size + compiler.size);
+  size_t page_size = 4096;
+
+  compiled->code_size = (size + page_size - 1) / page_size * page_size;
+
+  void* pages = mmap(NULL, compiled->code_size, PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+  if (pages != MAP_FAILED) {
+    memcpy(pages, start.code, start.size);
+    memcpy((char*)pages + start.size, compiler.code, compiler.size);
+
+    if (mprotect(pages, compiled->code_size, PROT_READ | PROT_EXEC) != 0) {
+      munmap(pages, compiled->code_size);
+      pages = MAP_FAILED;
+    }
+  }
+
+  free(start.code);
+  free(compiler.code);
+
+  //
+  // no executable memory, no JIT:
+  //
+  if (pages == MAP_FAILED) {
+    free(compiled);
+    return NULL;
+  }
+
+  compiled->code = pages;
+
+  return compiled;
+#else
+  return NULL;
+#endif
+}
+
+//
+// jit_execute
+//
+bool jit_execute(struct JIT_LOOP* loop, struct VM_PROGRAM* program, struct RAM* memory)
+{
+  union JIT_SLOT frame[JIT_MAX_VARS];
+
+  //
+  // the guard: the variables must still have their types:
+  //
+  for (int i = 0; i < loop->num_vars; i++) {
+    struct JIT_VAR* var = &loop->vars[i];
+
+    int address = runtime_lookup(memory, &program->vars[var->slot]);
+    if (address < 0)
+      return false;
+
+    struct BOXED_VALUE value = runtime_read_cell(memory, address);
+
+    if (unbox_type(value) != var->type)
+      return false;
+
+    if (var->type == RAM_TYPE_INT)
+      frame[i].i = unbox_int(value);
+    else
+      frame[i].d = unbox_real(value);
+  }
+
+  JIT_FUNCTION function = (JIT_FUNCTION)loop->code;
+
+  function(frame);
+
+  //
+  // ints and reals replace ints and reals, nothing can fail:
+  //
+  for (int i = 0; i < loop->num_vars; i++) {
+    struct JIT_VAR* var = &loop->vars[i];
+
+    if (!var->written)
+      continue;
+
+    struct BOXED_VALUE value = (var->type == RAM_TYPE_INT) ? box_int(frame[i].i) : box_real(frame[i].d);
+
+    int status = runtime_store(memory, &program->vars[var->slot], value);
+
+    assert(status == RUNTIME_OK);
+    (void)status;
+  }
+
+  return true;
+}
+
+//
+// jit_free
+//
+void jit_free(struct JIT_LOOP* loop)
+{
+  if (loop == NULL)
+    panic("loop ptr is null (jit_free)");
+
+#if JIT_X86_64
+  munmap(loop->code, loop->code_size);
+#endif
+
+  free(loop);
+}
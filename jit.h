@@ -0,0 +1,99 @@
+/*jit.h*/
+
+//
+// Baseline JIT compiler for the VM's while loops. A loop whose
+// test and body only compute with ints and reals --- + - * and
+// assignments of variables and constants, compared with
+// == != < <= > >= --- is translated, instruction by instruction,
+// into x86-64 machine code in executable pages. The variables
+// of the loop live in machine registers while it runs, and are
+// written back to memory when it's done.
+//
+// The code is specialized for the types the variables have the
+// first time the loop is reached. If they have other types when
+// the loop is reached again, the guard fails and the VM runs the
+// loop itself. Anything else (strings, pointers, print, nested
+// loops, ...) isn't compiled, the VM runs those loops as before.
+//
+// On other platforms jit_compile never compiles anything.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+#pragma once
+
+#include <stdbool.h>  // true, false
+#include <stddef.h>   // size_t
+
+#include "ram.h"
+#include "vm.h"
+
+
+//
+// at most this many variables in a compiled loop:
+//
+#define JIT_MAX_VARS 16
+
+//
+// A variable of a compiled loop, kept in a machine register:
+//
+struct JIT_VAR
+{
+  int  slot;     // the VM's variable slot
+  int  type;     // RAM_TYPE_INT or RAM_TYPE_REAL
+  int  reg;      // general purpose register (int) or xmm (real)
+  bool written;  // assigned by the loop?
+};
+
+struct JIT_LOOP
+{
+  void*  code;       // the machine code, in executable pages
+  size_t code_size;  // size of the pages
+
+  struct JIT_VAR vars[JIT_MAX_VARS];
+  int    num_vars;
+};
+
+
+//
+// Public functions:
+//
+
+//
+// jit_set_enabled
+// jit_enabled
+//
+// Turns the JIT on or off; when off, the VM runs every loop
+// itself. The default is on.
+//
+void jit_set_enabled(bool enabled);
+bool jit_enabled(void);
+
+//
+// jit_compile
+//
+// Compiles the given loop of the given program for the types
+// its variables have in memory now. Returns a pointer to the
+// dynamically-allocated compiled loop, NULL if the loop can't
+// be compiled.
+//
+struct JIT_LOOP* jit_compile(struct VM_PROGRAM* program, struct VM_LOOP* loop, struct RAM* memory);
+
+//
+// jit_execute
+//
+// Runs the compiled loop against the given memory, until the
+// loop is done, and writes its variables back to memory.
+// Returns false, without running anything, if the variables
+// don't have the types the loop was compiled for.
+//
+bool jit_execute(struct JIT_LOOP* loop, struct VM_PROGRAM* program, struct RAM* memory);
+
+//
+// jit_free
+//
+// Frees the compiled loop and its machine code.
+//
+void jit_free(struct JIT_LOOP* loop);
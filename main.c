@@ -23,35 +23,158 @@
 #include "parser.h"
 #include "programgraph.h"
 #include "ram.h"
+#include "ramfile.h"
+#include "quota.h"
 #include "execute.h"
+#include "jit.h"
+#include "output.h"
+#include "transpile.h"
+
+
+//
+// parse_size
+//
+// Parses a # of bytes such as "4096", "64K", "16M" or "1G".
+// Returns true if successful, false if not.
+//
+static bool parse_size(char* s, size_t* size)
+{
+  char* end = NULL;
+  unsigned long long n = strtoull(s, &end, 10);
+
+  if (end == s)
+    return false;
+
+  switch (*end) {
+  case 'K': case 'k': n *= 1024ULL; end++; break;
+  case 'M': case 'm': n *= 1024ULL * 1024; end++; break;
+  case 'G': case 'g': n *= 1024ULL * 1024 * 1024; end++; break;
+  }
+
+  if (*end != '\0')
+    return false;
+
+  *size = (size_t)n;
+  return true;
+}
 
 
 //
 // main
 //
-// usage: program.exe [filename.py]
+// usage: program.exe [options] [filename.py]
 // 
 // If a filename is given, the file is opened and serves as
 // input to the scanner. If a filename is not given, then 
 // input is taken from the keyboard until $ is input.
 //
+// Options:
+//
+//   --ram=file   memory is loaded from the given file before
+//                execution (if the file exists), and saved to
+//                the file after execution
+//   --quota=N    execution stops with an error if the program
+//                needs more than N bytes of memory (K, M or G
+//                suffixes are allowed)
+//   --memstats   outputs the memory high-water mark at the end
+//                (also output when a quota is given)
+//   --engine=E   executes the program with the given engine:
+//                "tree" walks the program graph (the default),
+//                "vm" compiles it to bytecode first, "closure"
+//                converts it to closures first, "ssa" converts
+//                it to optimized SSA form first (see ssa.h)
+//   --dump-ssa   outputs the optimized SSA form of the program
+//                before executing it (with --engine=ssa)
+//   --vmstats    outputs the hits and misses of the quickened
+//                operator instructions (with --engine=vm)
+//   --no-jit     the VM runs every loop itself, instead of
+//                compiling loops over ints and reals to machine
+//                code (see jit.h)
+//   --output-thread
+//                a background thread writes the program's
+//                output, while the program continues (see
+//                output.h)
+//   --transpile=file.c
+//                instead of executing the program, writes it
+//                to the given file as a C program (see
+//                transpile.h)
+//
 int main(int argc, char* argv[])
 {
   FILE* input = NULL;
   bool  keyboardInput = false;
+  char* filename = NULL;
+  char* ramFilename = NULL;
+  bool  memStats = false;
+  char* transpileFilename = NULL;
+
+  for (int i = 1; i < argc; i++) {
+    char* arg = argv[i];
+
+    if (strncmp(arg, "--ram=", 6) == 0) {
+      ramFilename = arg + 6;
+    }
+    else if (strncmp(arg, "--quota=", 8) == 0) {
+      size_t quota;
+
+      if (!parse_size(arg + 8, &quota)) {
+        printf("**ERROR: invalid quota '%s'.\n", arg + 8);
+        return 0;
+      }
+
+      quota_set_limit(quota);
+      memStats = true;
+    }
+    else if (strcmp(arg, "--memstats") == 0) {
+      memStats = true;
+    }
+    else if (strcmp(arg, "--engine=tree") == 0) {
+      execute_set_engine(ENGINE_TREE);
+    }
+    else if (strcmp(arg, "--engine=vm") == 0) {
+      execute_set_engine(ENGINE_VM);
+    }
+    else if (strcmp(arg, "--engine=closure") == 0) {
+      execute_set_engine(ENGINE_CLOSURE);
+    }
+    else if (strcmp(arg, "--engine=ssa") == 0) {
+      execute_set_engine(ENGINE_SSA);
+    }
+    else if (strcmp(arg, "--dump-ssa") == 0) {
+      execute_set_ssa_dump(true);
+    }
+    else if (strcmp(arg, "--vmstats") == 0) {
+      execute_set_vm_stats(true);
+    }
+    else if (strcmp(arg, "--no-jit") == 0) {
+      jit_set_enabled(false);
+    }
+    else if (strcmp(arg, "--output-thread") == 0) {
+      output_set_threaded(true);
+    }
+    else if (strncmp(arg, "--transpile=", 12) == 0) {
+      transpileFilename = arg + 12;
+    }
+    else if (strncmp(arg, "--", 2) == 0) {
+      printf("**ERROR: unknown option '%s'.\n", arg);
+      return 0;
+    }
+    else {
+      filename = arg;
+    }
+  }
 
-  if (argc < 2) {
+  if (filename == NULL) {
     //
-    // no args, just the program name:
+    // no filename, read from the keyboard:
     //
     input = stdin;
     keyboardInput = true;
   }
   else {
     //
-    // assume 2nd arg is a nuPython file:
+    // we have a nuPython file:
     //
-    char* filename = argv[1];
 
     input = fopen(filename, "r");
 
@@ -94,18 +217,61 @@ int main(int argc, char* argv[])
 
     programgraph_print(program);
 
-    //
-    // now execute the program:
-    //
-    printf("**executing...\n");
+    if (transpileFilename != NULL) {
+      //
+      // translate the program to C instead of executing it:
+      //
+      FILE* output = fopen(transpileFilename, "w");
+
+      if (output == NULL)
+        printf("**ERROR: unable to open output file '%s'.\n", transpileFilename);
+      else {
+        transpile(program, output);
+        fclose(output);
+
+        printf("**transpiled to '%s'\n", transpileFilename);
+      }
+    }
+    else {
+      //
+      // now execute the program:
+      //
+      printf("**executing...\n");
 
-    struct RAM* memory = ram_init();
+      struct RAM* memory = ram_init();
 
-    execute(program, memory);
+      if (ramFilename != NULL && !ram_load_file(memory, ramFilename))
+      {
+        //
+        // the memory file exists but can't be loaded, error msg
+        // already output. Don't run: saving at the end would
+        // overwrite the file
+        //
+      }
+      else
+      {
+        execute(program, memory);
 
-    printf("**done\n");
+        printf("**done\n");
+
+        ram_print(memory);
+
+        if (ramFilename != NULL && !ram_save_file(memory, ramFilename))
+          printf("**ERROR: unable to save memory to '%s'.\n", ramFilename);
+
+        if (memStats) {
+          printf("**MEMORY HIGH-WATER MARK: %zu bytes", quota_high_water());
+          if (quota_limit() > 0)
+            printf(" (quota %zu bytes)", quota_limit());
+          printf("\n");
+        }
+      }
+
+      ram_destroy(memory);
+    }
 
-    ram_print(memory);
+    programgraph_destroy(program);
+    tokenqueue_destroy(tokens);
   }
 
   //
@@ -0,0 +1,371 @@
+/*output.c*/
+
+//
+// Buffered output for nuPython programs, see output.h.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+// to eliminate warnings about stdlib in Visual Studio
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>  // true, false
+#include <stdarg.h>
+#include <string.h>
+#include <assert.h>
+
+//
+// the writer thread needs POSIX threads:
+//
+#if defined(__unix__) || defined(__APPLE__)
+#define OUTPUT_THREADS 1
+#include <pthread.h>
+#else
+#define OUTPUT_THREADS 0
+#endif
+
+//
+// isatty, to tell if stdout is a terminal:
+//
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#else
+#include <io.h>
+#define isatty _isatty
+#define STDOUT_FILENO 1
+#endif
+
+#include "output.h"
+
+
+//
+// size of each output buffer:
+//
+#define OUTPUT_BUFFER_SIZE (64 * 1024)
+
+struct OUTPUT_BUFFER
+{
+  char   data[OUTPUT_BUFFER_SIZE];
+  size_t used;
+};
+
+//
+// The program fills the current buffer. With the writer
+// thread, a full buffer is handed to the thread (pending) and
+// the program continues with the other one:
+//
+static struct OUTPUT_BUFFER buffers[2];
+static struct OUTPUT_BUFFER* current = &buffers[0];
+
+//
+// On a terminal, the output is flushed line by line, so what
+// the program printed shows up as it runs (-1 => don't know
+// yet, see line_buffered):
+//
+static int terminal = -1;
+
+#if OUTPUT_THREADS
+static bool threaded = false;
+static bool writer_started = false;
+static pthread_t writer;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t changed = PTHREAD_COND_INITIALIZER;
+static struct OUTPUT_BUFFER* pending = NULL;  // NULL => writer is idle
+#endif
+
+
+//
+// Private functions:
+//
+
+//
+// write_buffer
+//
+// Writes the contents of the given buffer to stdout, and
+// empties it.
+//
+static void write_buffer(struct OUTPUT_BUFFER* buffer)
+{
+  if (buffer->used > 0)
+    fwrite(buffer->data, 1, buffer->used, stdout);
+
+  buffer->used = 0;
+}
+
+//
+// line_buffered
+//
+// Returns true if the output goes to a terminal, and is
+// flushed at the end of each line.
+//
+static bool line_buffered(void)
+{
+  if (terminal < 0)
+    terminal = isatty(STDOUT_FILENO) ? 1 : 0;
+
+  return terminal == 1;
+}
+
+//
+// flush_lines
+//
+// Called with the chars just appended to the output: flushes
+// it if they end a line and the output is line buffered.
+//
+static void flush_lines(char* s, size_t n)
+{
+  if (line_buffered() && memchr(s, '\n', n) != NULL)
+    output_flush();
+}
+
+#if OUTPUT_THREADS
+//
+// write_pending
+//
+// The writer thread: waits for a buffer to be handed over,
+// writes it, and waits for the next one.
+//
+static void* write_pending(void* arg)
+{
+  pthread_mutex_lock(&lock);
+
+  for (;;) {
+    while (pending == NULL)
+      pthread_cond_wait(&changed, &lock);
+
+    struct OUTPUT_BUFFER* buffer = pending;
+
+    pthread_mutex_unlock(&lock);
+
+    write_buffer(buffer);
+    fflush(stdout);
+
+    pthread_mutex_lock(&lock);
+
+    pending = NULL;
+    pthread_cond_broadcast(&changed);
+  }
+
+  return NULL;
+}
+
+//
+// wait_for_writer
+//
+// Waits until the writer thread is done with the buffer it
+// was handed, if any.
+//
+static void wait_for_writer(void)
+{
+  pthread_mutex_lock(&lock);
+
+  while (pending != NULL)
+    pthread_cond_wait(&changed, &lock);
+
+  pthread_mutex_unlock(&lock);
+}
+#endif
+
+//
+// hand_off
+//
+// The current buffer is full (or must be flushed): writes it,
+// or with the writer thread, hands it to the thread and
+// switches to the other buffer.
+//
+static void hand_off(void)
+{
+#if OUTPUT_THREADS
+  if (threaded) {
+    wait_for_writer();
+
+    pthread_mutex_lock(&lock);
+    pending = current;
+    pthread_cond_broadcast(&changed);
+    pthread_mutex_unlock(&lock);
+
+    current = (current == &buffers[0]) ? &buffers[1] : &buffers[0];
+    current->used = 0;
+    return;
+  }
+#endif
+
+  write_buffer(current);
+}
+
+
+//
+// Public functions:
+//
+
+//
+// output_set_threaded
+//
+void output_set_threaded(bool enabled)
+{
+#if OUTPUT_THREADS
+  if (enabled && !writer_started) {
+    if (pthread_create(&writer, NULL, write_pending, NULL) != 0)
+      return;  // write the output ourselves
+
+    pthread_detach(writer);
+    writer_started = true;
+  }
+
+  if (!enabled)
+    output_flush();
+
+  threaded = enabled && writer_started;
+#endif
+}
+
+//
+// output_write
+//
+void output_write(char* s, size_t n)
+{
+  char* start = s;
+  size_t length = n;
+
+  while (n > 0) {
+    size_t room = OUTPUT_BUFFER_SIZE - current->used;
+
+    if (room == 0) {
+      hand_off();
+      continue;
+    }
+
+    size_t count = (n < room) ? n : room;
+
+    memcpy(current->data + current->used, s, count);
+    current->used += count;
+
+    s += count;
+    n -= count;
+  }
+
+  flush_lines(start, length);
+}
+
+//
+// output_char
+//
+void output_char(char c)
+{
+  if (current->used == OUTPUT_BUFFER_SIZE)
+    hand_off();
+
+  current->data[current->used++] = c;
+
+  if (c == '\n')
+    flush_lines(&c, 1);
+}
+
+//
+// output_reserve
+//
+char* output_reserve(size_t n)
+{
+  assert(n <= OUTPUT_BUFFER_SIZE);
+
+  if (OUTPUT_BUFFER_SIZE - current->used < n)
+    hand_off();
+
+  return current->data + current->used;
+}
+
+//
+// output_commit
+//
+void output_commit(size_t n)
+{
+  assert(current->used + n <= OUTPUT_BUFFER_SIZE);
+
+  char* s = current->data + current->used;
+
+  current->used += n;
+
+  flush_lines(s, n);
+}
+
+//
+// output_printf
+//
+void output_printf(char* format, ...)
+{
+  va_list args;
+
+  //
+  // format straight into the buffer if it fits, else make
+  // room and try again:
+  //
+  size_t room = OUTPUT_BUFFER_SIZE - current->used;
+
+  va_start(args, format);
+  int length = vsnprintf(current->data + current->used, room, format, args);
+  va_end(args);
+
+  if (length < 0)
+    return;  // nothing we can do
+
+  if ((size_t)length < room) {
+    char* s = current->data + current->used;
+
+    current->used += length;
+
+    flush_lines(s, length);
+    return;
+  }
+
+  hand_off();
+
+  if ((size_t)length < OUTPUT_BUFFER_SIZE) {
+    va_start(args, format);
+    vsnprintf(current->data, OUTPUT_BUFFER_SIZE, format, args);
+    va_end(args);
+
+    current->used = length;
+
+    flush_lines(current->data, length);
+    return;
+  }
+
+  //
+  // bigger than a buffer:
+  //
+  char* s = (char*)malloc(length + 1);
+
+  if (s == NULL)
+    return;
+
+  va_start(args, format);
+  vsnprintf(s, length + 1, format, args);
+  va_end(args);
+
+  output_write(s, length);
+
+  free(s);
+}
+
+//
+// output_flush
+//
+void output_flush(void)
+{
+#if OUTPUT_THREADS
+  if (threaded) {
+    if (current->used > 0)
+      hand_off();
+
+    wait_for_writer();
+    return;
+  }
+#endif
+
+  write_buffer(current);
+  fflush(stdout);
+}
@@ -0,0 +1,85 @@
+/*output.h*/
+
+//
+// Buffered output for nuPython programs. What a program
+// prints, and the error messages that stop it, are collected
+// in a large buffer and written to stdout a buffer at a time,
+// rather than with a printf call (and its locking) for every
+// line. The buffer is written when it fills up, when a program
+// finishes executing (see runtime_end), and on output_flush;
+// when stdout is a terminal, also at the end of each line, so
+// the output shows up as the program runs.
+//
+// Optionally, a background thread does the writing: while it
+// writes one buffer, the program fills the other, so output
+// overlaps execution. Either way, the output comes out in the
+// order it was produced, error messages included.
+//
+// NOTE: anything that prints with printf while a program
+// executes must call output_flush first, so the two don't get
+// out of order (see the panic functions).
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+#pragma once
+
+#include <stdbool.h>  // true, false
+#include <stddef.h>   // size_t
+
+
+//
+// Public functions:
+//
+
+//
+// output_set_threaded
+//
+// Enables or disables the background writer thread (disabled
+// by default). Where threads aren't available, the output is
+// always written by the caller.
+//
+void output_set_threaded(bool enabled);
+
+//
+// output_write
+//
+// Appends the given n characters to the output.
+//
+void output_write(char* s, size_t n);
+
+//
+// output_char
+//
+// Appends the given character to the output.
+//
+void output_char(char c);
+
+//
+// output_reserve
+// output_commit
+//
+// To format straight into the output: output_reserve returns
+// a pointer to room for (at least) the given # of chars, at
+// most 64K. Once the chars are written there, output_commit
+// appends the given # of them to the output.
+//
+char* output_reserve(size_t n);
+void  output_commit(size_t n);
+
+//
+// output_printf
+//
+// Appends the formatted string to the output, as printf does.
+//
+void output_printf(char* format, ...);
+
+//
+// output_flush
+//
+// Writes everything output so far to stdout, and flushes
+// stdout. With the writer thread, waits until it's done.
+//
+void output_flush(void);
@@ -0,0 +1,122 @@
+/*quota.c*/
+
+//
+// Memory accounting for nuPython, see quota.h.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+// to eliminate warnings about stdlib in Visual Studio
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>  // true, false
+#include <string.h>
+
+#include "ram.h"
+#include "quota.h"
+
+
+//
+// accounting state:
+//
+static size_t bytes_limit = 0;  // 0 => no limit
+static size_t bytes_in_use = 0;
+static size_t bytes_high_water = 0;
+
+
+//
+// Public functions:
+//
+
+//
+// quota_set_limit
+//
+void quota_set_limit(size_t limit)
+{
+  bytes_limit = limit;
+}
+
+//
+// quota_limit
+//
+size_t quota_limit(void)
+{
+  return bytes_limit;
+}
+
+//
+// quota_reset
+//
+void quota_reset(size_t in_use)
+{
+  bytes_in_use = in_use;
+  bytes_high_water = in_use;
+}
+
+//
+// quota_charge
+//
+bool quota_charge(size_t bytes)
+{
+  size_t total = bytes_in_use + bytes;
+
+  if (bytes_limit > 0 && total > bytes_limit)
+    return false;
+
+  bytes_in_use = total;
+
+  if (bytes_in_use > bytes_high_water)
+    bytes_high_water = bytes_in_use;
+
+  return true;
+}
+
+//
+// quota_release
+//
+void quota_release(size_t bytes)
+{
+  if (bytes > bytes_in_use)  // shouldn't happen, but never wrap around:
+    bytes_in_use = 0;
+  else
+    bytes_in_use -= bytes;
+}
+
+//
+// quota_in_use
+//
+size_t quota_in_use(void)
+{
+  return bytes_in_use;
+}
+
+//
+// quota_high_water
+//
+size_t quota_high_water(void)
+{
+  return bytes_high_water;
+}
+
+//
+// quota_ram_size
+//
+size_t quota_ram_size(struct RAM* memory)
+{
+  size_t size = sizeof(struct RAM) + sizeof(struct RAM_CELL) * memory->capacity;
+
+  for (int i = 0; i < memory->num_values; i++) {
+    struct RAM_CELL* cell = &memory->cells[i];
+
+    size += strlen(cell->identifier) + 1;
+
+    if (cell->value.value_type == RAM_TYPE_STR)
+      size += strlen(cell->value.types.s) + 1;
+  }
+
+  return size;
+}
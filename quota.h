@@ -0,0 +1,90 @@
+/*quota.h*/
+
+//
+// Memory accounting for nuPython. Every byte the interpreter
+// allocates on behalf of the running program --- memory cells,
+// variable names, string values, and the executor's scratch
+// memory --- is charged against a running total, and an
+// optional quota limits that total. This keeps a runaway
+// program from exhausting the memory of the process.
+//
+// Accounting is a handful of additions and a comparison per
+// allocation, so it is always on. The high-water mark records
+// the largest total seen.
+//
+// NOTE: the counts are the bytes requested, not including any
+// overhead added by malloc itself.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+#pragma once
+
+#include <stdbool.h>  // true, false
+#include <stddef.h>   // size_t
+
+#include "ram.h"
+
+
+//
+// Public functions:
+//
+
+//
+// quota_set_limit
+//
+// Sets the maximum # of bytes that may be in use; 0 means
+// there is no limit (the default).
+//
+void quota_set_limit(size_t limit);
+
+//
+// quota_limit
+//
+// Returns the current limit, 0 if there is no limit.
+//
+size_t quota_limit(void);
+
+//
+// quota_reset
+//
+// Restarts accounting with the given # of bytes in use,
+// which also becomes the high-water mark.
+//
+void quota_reset(size_t in_use);
+
+//
+// quota_charge
+//
+// Records that the given # of bytes are about to be allocated.
+// Returns true if this stays within the limit; returns false
+// (and charges nothing) if the limit would be exceeded.
+//
+bool quota_charge(size_t bytes);
+
+//
+// quota_release
+//
+// Records that the given # of bytes have been freed.
+//
+void quota_release(size_t bytes);
+
+//
+// quota_in_use
+// quota_high_water
+//
+// Returns the # of bytes currently in use, and the maximum
+// # of bytes that have been in use since the last reset.
+//
+size_t quota_in_use(void);
+size_t quota_high_water(void);
+
+//
+// quota_ram_size
+//
+// Returns the # of bytes used by the given memory: the RAM
+// itself, its array of cells, variable names, and strings.
+//
+size_t quota_ram_size(struct RAM* memory);
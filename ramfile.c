@@ -0,0 +1,123 @@
+/*ramfile.c*/
+
+//
+// Persistent nuPython memory, see ramfile.h.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+// to eliminate warnings about stdlib in Visual Studio
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>  // true, false
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>     // open
+#include <unistd.h>    // close
+#include <sys/mman.h>  // mmap, munmap
+#include <sys/stat.h>  // fstat
+
+#include "ram.h"
+#include "ramfile.h"
+#include "snapshot.h"
+
+
+//
+// Public functions:
+//
+
+//
+// ram_load_file
+//
+bool ram_load_file(struct RAM* memory, char* filename)
+{
+  int fd = open(filename, O_RDONLY);
+
+  if (fd < 0 && errno == ENOENT)
+    return true;  // nothing saved yet
+
+  if (fd < 0) {
+    printf("**ERROR: unable to open memory file '%s'.\n", filename);
+    return false;
+  }
+
+  struct stat info;
+
+  if (fstat(fd, &info) < 0 || info.st_size == 0) {
+    close(fd);
+    printf("**ERROR: '%s' is not a valid memory file.\n", filename);
+    return false;
+  }
+
+  size_t size = (size_t)info.st_size;
+
+  void* block = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  close(fd);  // the mapping stays valid
+
+  if (block == MAP_FAILED) {
+    printf("**ERROR: unable to map memory file '%s'.\n", filename);
+    return false;
+  }
+
+  struct RAM_SNAPSHOT* snapshot = ram_snapshot_from_block(block, size);
+
+  if (snapshot == NULL) {
+    munmap(block, size);
+    printf("**ERROR: '%s' is not a valid memory file.\n", filename);
+    return false;
+  }
+
+  ram_restore(memory, snapshot);
+
+  ram_snapshot_destroy(snapshot);
+  munmap(block, size);
+
+  return true;
+}
+
+//
+// ram_save_file
+//
+bool ram_save_file(struct RAM* memory, char* filename)
+{
+  //
+  // write to "filename.tmp", then rename:
+  //
+  size_t len = strlen(filename);
+
+  char* tmpname = (char*)malloc(len + sizeof(".tmp"));
+  if (tmpname == NULL)
+    return false;
+
+  strcpy(tmpname, filename);
+  strcat(tmpname, ".tmp");
+
+  FILE* output = fopen(tmpname, "wb");
+
+  if (output == NULL) {
+    free(tmpname);
+    return false;
+  }
+
+  struct RAM_SNAPSHOT* snapshot = ram_snapshot(memory);
+
+  bool success = fwrite(snapshot->header, 1, snapshot->size, output) == snapshot->size;
+
+  if (fclose(output) != 0)
+    success = false;
+
+  if (success)
+    success = rename(tmpname, filename) == 0;
+  else
+    remove(tmpname);
+
+  ram_snapshot_destroy(snapshot);
+  free(tmpname);
+
+  return success;
+}
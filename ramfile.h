@@ -0,0 +1,54 @@
+/*ramfile.h*/
+
+//
+// Persistent nuPython memory. The contents of memory can be
+// saved to a file at the end of one run, and loaded at the
+// start of the next run, so variables computed by one run
+// (e.g. large lookup tables) are available to the next one
+// without recomputing them.
+//
+// The file is a memory snapshot (see snapshot.h): versioned,
+// and position-independent since identifiers and strings are
+// stored as offsets. Loading maps the file into memory and
+// restores the cells directly from the mapping; there is no
+// parsing.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+#pragma once
+
+#include <stdbool.h>  // true, false
+
+#include "ram.h"
+
+
+//
+// Public functions:
+//
+
+//
+// ram_load_file
+//
+// Restores the given memory from the given file. Returns
+// true if successful, or if the file does not exist yet (the
+// memory is then unchanged). Returns false if the file exists
+// but can't be loaded --- it can't be read, or is not a valid
+// memory file of this version --- after outputting an error
+// message; the memory is unchanged, and the caller should not
+// save over the file, so it isn't lost.
+//
+bool ram_load_file(struct RAM* memory, char* filename);
+
+//
+// ram_save_file
+//
+// Saves the contents of the given memory to the given file,
+// replacing the file if it exists. The new file is written
+// under a temporary name and then renamed, so a crash never
+// leaves a partial file behind. Returns true if successful,
+// false if not.
+//
+bool ram_save_file(struct RAM* memory, char* filename);
@@ -0,0 +1,755 @@
+/*runtime.c*/
+
+//
+// Runtime support shared by the nuPython execution engines,
+// see runtime.h.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+// to eliminate warnings about stdlib in Visual Studio
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>  // true, false
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#include "programgraph.h"
+#include "ram.h"
+#include "box.h"
+#include "arena.h"
+#include "quota.h"
+#include "output.h"
+#include "format.h"
+#include "runtime.h"
+
+
+//
+// String buffers, see runtime_append: the strings in memory
+// that have room to grow, indexed by memory address. Memory
+// doesn't know about the extra room, so we keep track of it
+// here.
+//
+struct RUNTIME_BUFFER
+{
+  char*  s;         // the string in the memory cell, NULL if none
+  size_t length;    // strlen(s)
+  size_t capacity;  // # of bytes allocated for s
+};
+
+static struct RUNTIME_BUFFER* buffers = NULL;
+static int num_buffers = 0;
+
+
+//
+// Private functions:
+//
+
+//
+// panic
+//
+// Outputs the given error message and exits the program.
+//
+static void panic(char* msg)
+{
+  output_flush();
+
+  printf("**RUNTIME ERROR\n");
+  printf("**RUNTIME ERROR: %s\n", msg);
+  printf("**RUNTIME ERROR\n");
+  exit(-1);
+}
+
+//
+// get_buffer
+//
+// Returns the string buffer for the given address, making
+// room in the table for it if need be. A new buffer is empty
+// (s is NULL).
+//
+static struct RUNTIME_BUFFER* get_buffer(int address)
+{
+  if (address >= num_buffers) {
+    int count = num_buffers < 16 ? 16 : num_buffers;
+
+    while (count <= address)
+      count *= 2;
+
+    struct RUNTIME_BUFFER* table = (struct RUNTIME_BUFFER*)realloc(
+      buffers, sizeof(struct RUNTIME_BUFFER) * count);
+
+    if (table == NULL)
+      panic("out of memory (string buffers)");
+
+    memset(table + num_buffers, 0, sizeof(struct RUNTIME_BUFFER) * (count - num_buffers));
+
+    buffers = table;
+    num_buffers = count;
+  }
+
+  return &buffers[address];
+}
+
+//
+// forget_buffer
+//
+// The memory cell at the given address is about to be written
+// by someone other than runtime_append: forgets its string
+// buffer, if any. The quota was charged for the whole buffer,
+// but the write releases only the string's length (+1), so
+// the rest is released here.
+//
+static void forget_buffer(int address)
+{
+  if (address >= num_buffers || buffers[address].s == NULL)
+    return;
+
+  struct RUNTIME_BUFFER* buffer = &buffers[address];
+
+  quota_release(buffer->capacity - (buffer->length + 1));
+
+  buffer->s = NULL;
+}
+
+//
+// dupAndConcat
+// 
+// Given 2 strings, makes a copy by concatenating 
+// them together, and returns the copy.
+// 
+// NOTE: the copy is allocated from the given scratch
+// arena, and is only valid until the arena is reset
+// at the end of the current statement. Returns NULL
+// if the copy would exceed the memory quota.
+//
+static char* dupAndConcat(struct ARENA* scratch, char* s1, char* s2)
+{
+  assert(s1 != NULL);
+  assert(s2 != NULL);
+
+  size_t len1 = strlen(s1);
+  size_t len2 = strlen(s2);
+
+  //
+  // be sure to include extra location for null terminator:
+  //
+  char* copy = (char*)arena_alloc(scratch, sizeof(char) * (len1 + len2 + 1));
+  if (copy == NULL)
+    return NULL;
+
+  memcpy(copy, s1, len1);
+  memcpy(copy + len1, s2, len2 + 1);
+
+  return copy;
+}
+
+
+//
+// print_int
+// print_real
+//
+// Outputs the given number followed by a newline, formatted
+// straight into the output buffer (see format.h).
+//
+static void print_int(int i)
+{
+  char* s = output_reserve(FORMAT_INT_SIZE);  // the newline replaces the null
+
+  int length = format_int(s, i);
+  s[length] = '\n';
+
+  output_commit(length + 1);
+}
+
+static void print_real(double d)
+{
+  char* s = output_reserve(FORMAT_REAL_SIZE);
+
+  int length = format_real(s, d);
+  s[length] = '\n';
+
+  output_commit(length + 1);
+}
+
+
+//
+// str_size
+//
+// Returns the # of bytes allocated for a copy of the string
+// held in the given value, 0 if the value is not a string.
+//
+static size_t str_size(struct RAM_VALUE value)
+{
+  if (value.value_type != RAM_TYPE_STR)
+    return 0;
+
+  return strlen(value.types.s) + 1;
+}
+
+
+//
+// The operators, as X-macros, from which the kernels and the
+// dispatch table below are generated. For each operator on
+// numbers: when it fails on ints l and r (int division by
+// 0), what it computes for them, what it computes for reals
+// (an int operand is converted to real when the other is
+// real), and its pointer kernel --- + and - offset the lhs,
+// which keeps its type, the others leave the lhs unchanged:
+//
+#define RUNTIME_NUMBER_OPS(X)                                                        \
+  X(PLUS,      false,  box_int(RUNTIME_WRAP(l, +, r)), box_real(l + r),      add)    \
+  X(MINUS,     false,  box_int(RUNTIME_WRAP(l, -, r)), box_real(l - r),      sub)    \
+  X(ASTERISK,  false,  box_int(RUNTIME_WRAP(l, *, r)), box_real(l * r),      keep)   \
+  X(POWER,     false,  box_int(int_power(l, r)),       box_real(pow(l, r)),  keep)   \
+  X(MOD,       r == 0, box_int(int_modulo(l, r)),      box_real(fmod(l, r)), keep)   \
+  X(DIV,       r == 0, box_int(int_divide(l, r)),      box_real(l / r),      keep)   \
+  X(EQUAL,     false,  box_bool(l == r),               box_bool(l == r),     keep)   \
+  X(NOT_EQUAL, false,  box_bool(l != r),               box_bool(l != r),     keep)   \
+  X(LT,        false,  box_bool(l < r),                box_bool(l < r),      keep)   \
+  X(LTE,       false,  box_bool(l <= r),               box_bool(l <= r),     keep)   \
+  X(GT,        false,  box_bool(l > r),                box_bool(l > r),      keep)   \
+  X(GTE,       false,  box_bool(l >= r),               box_bool(l >= r),     keep)
+
+//
+// The operators that leave a number or pointer lhs unchanged:
+//
+#define RUNTIME_OTHER_OPS(X)                                                 \
+  X(IS)                                                                      \
+  X(IN)
+
+//
+// The comparisons of strings (+ concatenates, see str_PLUS):
+//
+#define RUNTIME_STR_OPS(X)                                                   \
+  X(EQUAL,     ==)                                                           \
+  X(NOT_EQUAL, !=)                                                           \
+  X(LT,        <)                                                            \
+  X(LTE,       <=)                                                           \
+  X(GT,        >)                                                            \
+  X(GTE,       >=)
+
+//
+// The operand types that take part in pointer arithmetic
+// (those with an int payload), and what the result of + and -
+// is when the lhs has that type:
+//
+#define RUNTIME_PTR_TYPES(X)                                                 \
+  X(PTR,     box_ptr)                                                        \
+  X(INT,     box_int)                                                        \
+  X(BOOLEAN, box_truth)
+
+#define RUNTIME_NUM_TYPES (RAM_TYPE_NONE + 1)
+
+
+//
+// int_power
+//
+// base ** exponent, by repeated squaring (wrapping around as
+// * does). A negative exponent gives a fraction, truncated as
+// (int)pow() truncates it.
+//
+static int int_power(int base, int exponent)
+{
+  if (exponent < 0)
+    return (int)pow(base, exponent);
+
+  unsigned int result = 1;
+  unsigned int square = (unsigned int)base;
+
+  while (exponent > 0) {
+    if (exponent & 1)
+      result *= square;
+
+    square *= square;
+    exponent >>= 1;
+  }
+
+  return (int)result;
+}
+
+//
+// int_divide
+// int_modulo
+//
+// l / r and l % r, r != 0. INT_MIN / -1 wraps around, as *
+// does, rather than trap:
+//
+static int int_divide(int l, int r)
+{
+  return (r == -1) ? RUNTIME_WRAP(0, -, l) : l / r;
+}
+
+static int int_modulo(int l, int r)
+{
+  return (r == -1) ? 0 : l % r;
+}
+
+//
+// box_truth
+//
+// A boolean lhs of pointer arithmetic stays a boolean.
+//
+static inline struct BOXED_VALUE box_truth(int i)
+{
+  return box_bool(i != 0);
+}
+
+//
+// The kernels: given "lhs operator rhs" with the operand types
+// the kernel is for, performs the operation and stores the
+// result in lhs. Returns RUNTIME_OK, RUNTIME_DIVISION_BY_ZERO,
+// or RUNTIME_OUT_OF_QUOTA if a string result would exceed the
+// memory quota.
+//
+// ii_, rr_, ir_ and ri_ are int and real operands, in that
+// order; PTR_add, INT_sub, ... pointer arithmetic with a lhs
+// of that type; str_ strings; keep leaves the lhs unchanged:
+//
+#define RUNTIME_KERNEL(name, type, lhs_unbox, rhs_unbox, fails, result)     \
+  static int name(struct ARENA* scratch, struct BOXED_VALUE* lhs,            \
+    struct BOXED_VALUE* rhs)                                                 \
+  {                                                                          \
+    type l = lhs_unbox(*lhs);                                                \
+    type r = rhs_unbox(*rhs);                                                \
+                                                                             \
+    if (fails)                                                               \
+      return RUNTIME_DIVISION_BY_ZERO;                                       \
+                                                                             \
+    *lhs = result;                                                           \
+    return RUNTIME_OK;                                                       \
+  }
+
+#define RUNTIME_NUMBER_KERNELS(op, int_fails, int_result, real_result, ptr_kernel)  \
+  RUNTIME_KERNEL(ii_##op, int,    unbox_int,  unbox_int,  int_fails, int_result)     \
+  RUNTIME_KERNEL(rr_##op, double, unbox_real, unbox_real, false, real_result)        \
+  RUNTIME_KERNEL(ir_##op, double, unbox_int,  unbox_real, false, real_result)        \
+  RUNTIME_KERNEL(ri_##op, double, unbox_real, unbox_int,  false, real_result)
+
+#define RUNTIME_PTR_KERNELS(type, box)                                       \
+  RUNTIME_KERNEL(type##_add, int, unbox_int, unbox_int, false, box(RUNTIME_WRAP(l, +, r)))  \
+  RUNTIME_KERNEL(type##_sub, int, unbox_int, unbox_int, false, box(RUNTIME_WRAP(l, -, r)))
+
+#define RUNTIME_STR_KERNELS(op, c_op)                                        \
+  RUNTIME_KERNEL(str_##op, char*, unbox_str, unbox_str, false, box_bool(strcmp(l, r) c_op 0))
+
+RUNTIME_NUMBER_OPS(RUNTIME_NUMBER_KERNELS)
+RUNTIME_PTR_TYPES(RUNTIME_PTR_KERNELS)
+RUNTIME_STR_OPS(RUNTIME_STR_KERNELS)
+
+#undef RUNTIME_STR_KERNELS
+#undef RUNTIME_PTR_KERNELS
+#undef RUNTIME_NUMBER_KERNELS
+#undef RUNTIME_KERNEL
+
+static int keep(struct ARENA* scratch, struct BOXED_VALUE* lhs, struct BOXED_VALUE* rhs)
+{
+  return RUNTIME_OK;
+}
+
+static int str_PLUS(struct ARENA* scratch, struct BOXED_VALUE* lhs, struct BOXED_VALUE* rhs)
+{
+  char* copy = dupAndConcat(scratch, unbox_str(*lhs), unbox_str(*rhs));
+  if (copy == NULL)
+    return RUNTIME_OUT_OF_QUOTA;
+
+  *lhs = box_str(copy);
+  return RUNTIME_OK;
+}
+
+//
+// The dispatch table: the kernel for each (lhs type, rhs type,
+// operator), NULL if the operand types are invalid for the
+// operator.
+//
+#define RUNTIME_NUMBER_ENTRIES(op, int_fails, int_result, real_result, ptr_kernel)  \
+  [RAM_TYPE_INT][RAM_TYPE_INT][OPERATOR_##op] = ii_##op,                     \
+  [RAM_TYPE_REAL][RAM_TYPE_REAL][OPERATOR_##op] = rr_##op,                   \
+  [RAM_TYPE_INT][RAM_TYPE_REAL][OPERATOR_##op] = ir_##op,                    \
+  [RAM_TYPE_REAL][RAM_TYPE_INT][OPERATOR_##op] = ri_##op,                    \
+  RUNTIME_PTR_##ptr_kernel(op)
+
+#define RUNTIME_OTHER_ENTRIES(op)                                            \
+  [RAM_TYPE_INT][RAM_TYPE_INT][OPERATOR_##op] = keep,                        \
+  [RAM_TYPE_REAL][RAM_TYPE_REAL][OPERATOR_##op] = keep,                      \
+  [RAM_TYPE_INT][RAM_TYPE_REAL][OPERATOR_##op] = keep,                       \
+  [RAM_TYPE_REAL][RAM_TYPE_INT][OPERATOR_##op] = keep,                       \
+  RUNTIME_PTR_keep(op)
+
+#define RUNTIME_PTR_ENTRIES(op, ptr_kernel, int_kernel, bool_kernel)         \
+  [RAM_TYPE_PTR][RAM_TYPE_PTR][OPERATOR_##op] = ptr_kernel,                  \
+  [RAM_TYPE_PTR][RAM_TYPE_INT][OPERATOR_##op] = ptr_kernel,                  \
+  [RAM_TYPE_PTR][RAM_TYPE_BOOLEAN][OPERATOR_##op] = ptr_kernel,              \
+  [RAM_TYPE_INT][RAM_TYPE_PTR][OPERATOR_##op] = int_kernel,                  \
+  [RAM_TYPE_BOOLEAN][RAM_TYPE_PTR][OPERATOR_##op] = bool_kernel,
+
+#define RUNTIME_PTR_add(op)  RUNTIME_PTR_ENTRIES(op, PTR_add, INT_add, BOOLEAN_add)
+#define RUNTIME_PTR_sub(op)  RUNTIME_PTR_ENTRIES(op, PTR_sub, INT_sub, BOOLEAN_sub)
+#define RUNTIME_PTR_keep(op) RUNTIME_PTR_ENTRIES(op, keep, keep, keep)
+
+#define RUNTIME_STR_ENTRIES(op, c_op)                                        \
+  [RAM_TYPE_STR][RAM_TYPE_STR][OPERATOR_##op] = str_##op,
+
+static int (*const runtime_kernels[RUNTIME_NUM_TYPES][RUNTIME_NUM_TYPES][OPERATOR_NO_OP])(
+  struct ARENA* scratch, struct BOXED_VALUE* lhs, struct BOXED_VALUE* rhs) =
+{
+  RUNTIME_NUMBER_OPS(RUNTIME_NUMBER_ENTRIES)
+  RUNTIME_OTHER_OPS(RUNTIME_OTHER_ENTRIES)
+  RUNTIME_STR_OPS(RUNTIME_STR_ENTRIES)
+  [RAM_TYPE_STR][RAM_TYPE_STR][OPERATOR_PLUS] = str_PLUS,
+};
+
+#undef RUNTIME_STR_ENTRIES
+#undef RUNTIME_PTR_keep
+#undef RUNTIME_PTR_sub
+#undef RUNTIME_PTR_add
+#undef RUNTIME_PTR_ENTRIES
+#undef RUNTIME_OTHER_ENTRIES
+#undef RUNTIME_NUMBER_ENTRIES
+
+
+//
+// Public functions:
+//
+
+//
+// runtime_begin
+//
+void runtime_begin(struct RAM* memory)
+{
+  quota_reset(quota_ram_size(memory));
+
+  num_buffers = 0;
+  free(buffers);
+  buffers = NULL;
+}
+
+//
+// runtime_end
+//
+void runtime_end(void)
+{
+  //
+  // the strings stay in memory, with their extra room:
+  //
+  for (int i = 0; i < num_buffers; i++)
+    forget_buffer(i);
+
+  num_buffers = 0;
+  free(buffers);
+  buffers = NULL;
+
+  output_flush();
+}
+
+//
+// runtime_report
+//
+void runtime_report(int status, char* var_name, int line)
+{
+  switch (status) {
+  case RUNTIME_UNDEFINED:
+    output_printf("**SEMANTIC ERROR: name '%s' is not defined (line %d)\n", var_name, line);
+    break;
+
+  case RUNTIME_INVALID_ADDRESS:
+    output_printf("**SEMANTIC ERROR: '%s' contains invalid address (line %d)\n", var_name, line);
+    break;
+
+  case RUNTIME_INVALID_OPERANDS:
+    output_printf("**SEMANTIC ERROR: invalid operand types (line %d)\n", line);
+    break;
+
+  case RUNTIME_DIVISION_BY_ZERO:
+    output_printf("**EXECUTION ERROR: division by zero (line %d)\n", line);
+    break;
+
+  case RUNTIME_OUT_OF_QUOTA:
+    output_printf("**EXECUTION ERROR: memory quota of %zu bytes exceeded (line %d)\n", quota_limit(), line);
+    break;
+
+  case RUNTIME_UNSUPPORTED_UNARY:
+    output_printf("else block\n");
+    break;
+
+  case RUNTIME_UNEXPECTED_ELEMENT:
+    output_printf("**EXECUTION ERROR: unexpected element type in get_element_value");
+    break;
+
+  case RUNTIME_UNEXPECTED_VALUE:
+    output_printf("**EXECUTION ERROR: unexpected element type in execute_function_call");
+    break;
+
+  case RUNTIME_INVALID_ARGUMENTS:
+    output_printf("**SEMANTIC ERROR: invalid arguments for %s() (line %d)\n", var_name, line);
+    break;
+
+  case RUNTIME_INVALID_STRING:
+    output_printf("**SEMANTIC ERROR: invalid string for %s() (line %d)\n", var_name, line);
+    break;
+
+  default:
+    //
+    // RUNTIME_WRITE_FAILED: memory has nothing to say
+    //
+    break;
+  }
+}
+
+//
+// runtime_has_int_payload
+//
+bool runtime_has_int_payload(struct BOXED_VALUE value)
+{
+  int type = unbox_type(value);
+
+  return type == RAM_TYPE_INT ||
+    type == RAM_TYPE_PTR ||
+    type == RAM_TYPE_BOOLEAN;
+}
+
+//
+// runtime_binary_op
+//
+int runtime_binary_op(
+  struct ARENA* scratch,
+  struct BOXED_VALUE* lhs,
+  int operator,
+  struct BOXED_VALUE* rhs)
+{
+  assert(lhs != NULL);
+  assert(rhs != NULL);
+  assert(operator != OPERATOR_NO_OP);
+
+  assert(operator >= 0 && operator < OPERATOR_NO_OP);
+
+  int (*kernel)(struct ARENA*, struct BOXED_VALUE*, struct BOXED_VALUE*) =
+    runtime_kernels[unbox_type(*lhs)][unbox_type(*rhs)][operator];
+
+  if (kernel == NULL)
+    return RUNTIME_INVALID_OPERANDS;
+
+  return kernel(scratch, lhs, rhs);
+}
+
+//
+// runtime_concat
+//
+int runtime_concat(struct ARENA* scratch, struct BOXED_VALUE* dest, char* lhs, char* rhs)
+{
+  char* copy = dupAndConcat(scratch, lhs, rhs);
+  if (copy == NULL)
+    return RUNTIME_OUT_OF_QUOTA;
+
+  *dest = box_str(copy);
+
+  return RUNTIME_OK;
+}
+
+//
+// runtime_append
+//
+int runtime_append(struct RAM* memory, int address, char* rhs)
+{
+  assert(address >= 0 && address < memory->num_values);
+
+  struct RAM_VALUE* cell = &memory->cells[address].value;
+  struct RUNTIME_BUFFER* buffer = get_buffer(address);
+
+  assert(cell->value_type == RAM_TYPE_STR);
+  assert(cell->types.s != rhs);
+
+  if (buffer->s != cell->types.s) {
+    //
+    // first append since the cell was written, memory allocated
+    // exactly enough for the string:
+    //
+    buffer->s = cell->types.s;
+    buffer->length = strlen(buffer->s);
+    buffer->capacity = buffer->length + 1;
+  }
+
+  size_t rhs_length = strlen(rhs);
+  size_t needed = buffer->length + rhs_length + 1;
+
+  if (needed > buffer->capacity) {
+    size_t capacity = buffer->capacity < 16 ? 16 : buffer->capacity;
+
+    while (capacity < needed)
+      capacity *= 2;
+
+    if (!quota_charge(capacity - buffer->capacity)) {
+      //
+      // no room to double, is there room for the string?
+      //
+      capacity = needed;
+
+      if (!quota_charge(capacity - buffer->capacity))
+        return RUNTIME_OUT_OF_QUOTA;
+    }
+
+    char* s = (char*)realloc(buffer->s, capacity);
+
+    if (s == NULL)
+      panic("out of memory (string buffers)");
+
+    buffer->s = s;
+    buffer->capacity = capacity;
+    cell->types.s = s;
+  }
+
+  memcpy(buffer->s + buffer->length, rhs, rhs_length + 1);
+  buffer->length += rhs_length;
+
+  return RUNTIME_OK;
+}
+
+//
+// runtime_is_true
+//
+bool runtime_is_true(struct BOXED_VALUE value)
+{
+  switch (unbox_type(value)) {
+  case RAM_TYPE_REAL:
+    return unbox_real(value) != 0.0;
+
+  case RAM_TYPE_STR:
+    return unbox_str(value)[0] != '\0';
+
+  case RAM_TYPE_NONE:
+    return false;
+
+  default:  // int, ptr, boolean:
+    return unbox_int(value) != 0;
+  }
+}
+
+//
+// runtime_check_ptr
+//
+int runtime_check_ptr(struct RAM* memory, struct BOXED_VALUE ptr)
+{
+  if (runtime_has_int_payload(ptr) &&
+    (unbox_int(ptr) < 0 || unbox_int(ptr) >= memory->num_values))
+  {
+    return RUNTIME_INVALID_ADDRESS;
+  }
+
+  if (unbox_type(ptr) != RAM_TYPE_PTR)
+    return RUNTIME_INVALID_OPERANDS;
+
+  return RUNTIME_OK;
+}
+
+//
+// runtime_write_cell_by_addr
+//
+int runtime_write_cell_by_addr(struct RAM* memory, struct BOXED_VALUE value, int address)
+{
+  if (address < 0 || address >= memory->num_values)
+    return RUNTIME_WRITE_FAILED;
+
+  struct RAM_VALUE* old_value = &memory->cells[address].value;
+  struct RAM_VALUE new_value = box_to_ram(value);
+
+  if (new_value.value_type != RAM_TYPE_STR && old_value->value_type != RAM_TYPE_STR) {
+    //
+    // no strings involved, so nothing to allocate or free:
+    //
+    *old_value = new_value;
+    return RUNTIME_OK;
+  }
+
+  if (new_value.value_type == RAM_TYPE_STR &&
+    old_value->value_type == RAM_TYPE_STR &&
+    old_value->types.s == new_value.types.s)
+  {
+    return RUNTIME_OK;  // s = s
+  }
+
+  if (!quota_charge(str_size(new_value)))
+    return RUNTIME_OUT_OF_QUOTA;
+
+  forget_buffer(address);
+
+  quota_release(str_size(*old_value));
+
+  if (!ram_write_cell_by_addr(memory, new_value, address))
+    return RUNTIME_WRITE_FAILED;
+
+  return RUNTIME_OK;
+}
+
+//
+// runtime_write_cell_by_id
+//
+int runtime_write_cell_by_id(struct RAM* memory, struct BOXED_VALUE value, char* var_name)
+{
+  int address = ram_get_addr(memory, var_name);
+
+  if (address >= 0)  // existing variable:
+    return runtime_write_cell_by_addr(memory, value, address);
+
+  //
+  // new variable: a cell, its name, and perhaps a string.
+  // Memory doubles its array of cells when it runs out:
+  //
+  struct RAM_VALUE new_value = box_to_ram(value);
+
+  size_t size = strlen(var_name) + 1 + str_size(new_value);
+
+  if (memory->num_values == memory->capacity)
+    size += sizeof(struct RAM_CELL) * memory->capacity;
+
+  if (!quota_charge(size))
+    return RUNTIME_OUT_OF_QUOTA;
+
+  if (!ram_write_cell_by_id(memory, new_value, var_name))
+    return RUNTIME_WRITE_FAILED;
+
+  return RUNTIME_OK;
+}
+
+//
+// runtime_print
+//
+int runtime_print(struct BOXED_VALUE value)
+{
+  switch (unbox_type(value)) {
+  case RAM_TYPE_INT:
+    print_int(unbox_int(value));
+    break;
+
+  case RAM_TYPE_REAL:
+    print_real(unbox_real(value));
+    break;
+
+  case RAM_TYPE_STR: {
+    char* s = unbox_str(value);
+
+    output_write(s, strlen(s));
+    output_char('\n');
+    break;
+  }
+
+  case RAM_TYPE_BOOLEAN:
+    if (unbox_int(value) == 0)
+      output_write("False\n", 6);
+    else
+      output_write("True\n", 5);
+    break;
+
+  case RAM_TYPE_PTR:
+    print_int(unbox_int(value));
+    break;
+
+  default:
+    return RUNTIME_UNEXPECTED_VALUE;
+  }
+
+  return RUNTIME_OK;
+}
@@ -0,0 +1,251 @@
+/*runtime.h*/
+
+//
+// Runtime support shared by the nuPython execution engines:
+// the semantics of the operators, reading and writing memory
+// cells, truth values, printing, and the error messages. Every
+// engine goes through these functions, so they all behave the
+// same way and output the same messages.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+#pragma once
+
+#include <stdbool.h>  // true, false
+
+#include "ram.h"
+#include "box.h"
+#include "arena.h"
+
+
+//
+// Outcome of a runtime operation; anything other than
+// RUNTIME_OK stops execution (see runtime_report):
+//
+enum RUNTIME_STATUS
+{
+  RUNTIME_OK = 0,
+  RUNTIME_UNDEFINED,            // name 'x' is not defined
+  RUNTIME_INVALID_ADDRESS,      // 'x' contains invalid address
+  RUNTIME_INVALID_OPERANDS,     // invalid operand types
+  RUNTIME_DIVISION_BY_ZERO,     // int / 0 or % 0
+  RUNTIME_OUT_OF_QUOTA,         // memory quota exceeded
+  RUNTIME_UNSUPPORTED_UNARY,    // unary operator we don't support
+  RUNTIME_UNEXPECTED_ELEMENT,   // element we can't evaluate (e.g. None)
+  RUNTIME_UNEXPECTED_VALUE,     // value we can't print
+  RUNTIME_INVALID_ARGUMENTS,    // invalid arguments for f()
+  RUNTIME_INVALID_STRING,       // invalid string for int() or float()
+  RUNTIME_WRITE_FAILED          // memory rejected the write
+};
+
+//
+// An int operation, as every engine computes it: + - * wrap
+// around, rather than overflow (which C leaves undefined), and
+// the comparisons apply the C operator as is. An engine that
+// computes ints itself, rather than with runtime_binary_op,
+// uses these macros (with the C operator):
+//
+#define RUNTIME_WRAP(lhs, op, rhs) ((int)((unsigned int)(lhs) op (unsigned int)(rhs)))
+#define RUNTIME_COMPARE(lhs, op, rhs) ((lhs) op (rhs))
+
+
+//
+// Public functions:
+//
+
+//
+// runtime_begin
+//
+// Called by an engine before it executes a program on the
+// given memory: starts the memory accounting from what memory
+// holds now (see quota_reset), and forgets the string buffers
+// of earlier executions (see runtime_append).
+//
+void runtime_begin(struct RAM* memory);
+
+//
+// runtime_end
+//
+// Called by an engine after it executes a program, whether or
+// not execution stopped with an error. Writes out what the
+// program output (see output.h).
+//
+void runtime_end(void);
+
+//
+// runtime_report
+//
+// Outputs the error message for the given status, which
+// occurred on the given line. var_name is the variable
+// involved, if any (else NULL); for an error calling a
+// function, the function's name.
+//
+void runtime_report(int status, char* var_name, int line);
+
+//
+// runtime_binary_op
+//
+// Given "lhs operator rhs", performs the operation and
+// stores the result in lhs, with the kernel for the operand
+// types and operator (one table lookup, no type tests).
+// Memory needed for the result (string concatenation) comes
+// from the scratch arena. Returns RUNTIME_OK,
+// RUNTIME_INVALID_OPERANDS, RUNTIME_DIVISION_BY_ZERO or
+// RUNTIME_OUT_OF_QUOTA.
+//
+int runtime_binary_op(
+  struct ARENA* scratch,
+  struct BOXED_VALUE* lhs,
+  int operator,
+  struct BOXED_VALUE* rhs);
+
+//
+// runtime_concat
+//
+// The string case of "lhs + rhs": concatenates the strings
+// into the scratch arena and stores the result in dest.
+// Returns RUNTIME_OK or RUNTIME_OUT_OF_QUOTA.
+//
+int runtime_concat(struct ARENA* scratch, struct BOXED_VALUE* dest, char* lhs, char* rhs);
+
+//
+// runtime_append
+//
+// s = s + rhs, where s is the string in the memory cell at the
+// given (valid) address: appends rhs to that string in place.
+// The string becomes a buffer with room to grow, doubling in
+// size when it fills up, so a loop that builds a string copies
+// each character a constant # of times on average instead of
+// every time around the loop. The buffer is charged against
+// the memory quota. Returns RUNTIME_OK or RUNTIME_OUT_OF_QUOTA.
+//
+// NOTE: rhs must not be the cell's own string (s = s + s),
+// since growing the buffer may move it. Like any write to the
+// cell, an append invalidates strings read from it earlier.
+//
+int runtime_append(struct RAM* memory, int address, char* rhs);
+
+//
+// runtime_has_int_payload
+//
+// Returns true if the value is stored as an integer: int,
+// ptr, or boolean.
+//
+bool runtime_has_int_payload(struct BOXED_VALUE value);
+
+//
+// runtime_is_true
+//
+// Returns the truth value of the given value, as in Python:
+// False, None, 0, 0.0 and "" are false, everything else is
+// true.
+//
+bool runtime_is_true(struct BOXED_VALUE value);
+
+//
+// runtime_check_ptr
+//
+// Given the value of a variable used as a pointer (*p),
+// returns RUNTIME_OK if it holds a valid memory address,
+// RUNTIME_INVALID_ADDRESS or RUNTIME_INVALID_OPERANDS if not.
+//
+int runtime_check_ptr(struct RAM* memory, struct BOXED_VALUE ptr);
+
+//
+// runtime_read_cell
+//
+// Returns the value stored at the given (valid) address, by
+// value; a string still belongs to the memory cell.
+//
+static inline struct BOXED_VALUE runtime_read_cell(struct RAM* memory, int address)
+{
+  return box_from_ram(memory->cells[address].value);
+}
+
+//
+// runtime_write_cell_by_addr
+// runtime_write_cell_by_id
+//
+// Writes the given value to memory, see ram_write_cell_by_addr
+// and ram_write_cell_by_id. The bytes the write allocates are
+// charged against the memory quota first. Returns RUNTIME_OK,
+// RUNTIME_OUT_OF_QUOTA, or RUNTIME_WRITE_FAILED.
+//
+// NOTE: a string read from a memory cell can be written back
+// to that same cell (e.g. s = s).
+//
+int runtime_write_cell_by_addr(struct RAM* memory, struct BOXED_VALUE value, int address);
+int runtime_write_cell_by_id(struct RAM* memory, struct BOXED_VALUE value, char* var_name);
+
+//
+// runtime_print
+//
+// Outputs the given value followed by a newline, as print()
+// does. Returns RUNTIME_OK, or RUNTIME_UNEXPECTED_VALUE if
+// the value can't be printed.
+//
+int runtime_print(struct BOXED_VALUE value);
+
+
+//
+// Variables: an engine that resolves names ahead of time
+// keeps a RUNTIME_VAR for each variable the program uses.
+// The memory address is looked up by name the first time it
+// is needed, and cached from then on (addresses never change
+// while a program executes).
+//
+struct RUNTIME_VAR
+{
+  char* name;     // variable name (in the program graph)
+  int   address;  // memory address, -1 if not yet known
+};
+
+//
+// runtime_lookup
+//
+// Returns the memory address of the given variable, -1 if
+// the variable has not been written to memory.
+//
+static inline int runtime_lookup(struct RAM* memory, struct RUNTIME_VAR* var)
+{
+  if (var->address < 0)
+    var->address = ram_get_addr(memory, var->name);
+
+  return var->address;
+}
+
+//
+// runtime_store
+//
+// Writes the given value to the given variable, creating the
+// variable if need be; see runtime_write_cell_by_id. Writes
+// that neither store nor replace a string are done inline.
+//
+static inline int runtime_store(struct RAM* memory, struct RUNTIME_VAR* var, struct BOXED_VALUE value)
+{
+  int address = runtime_lookup(memory, var);
+
+  if (address < 0) {
+    //
+    // new variable, it's added to the end of memory:
+    //
+    int status = runtime_write_cell_by_id(memory, value, var->name);
+
+    if (status == RUNTIME_OK)
+      var->address = memory->num_values - 1;
+
+    return status;
+  }
+
+  struct RAM_VALUE* cell = &memory->cells[address].value;
+
+  if (cell->value_type != RAM_TYPE_STR && unbox_type(value) != RAM_TYPE_STR) {
+    *cell = box_to_ram(value);  // nothing to allocate or free
+    return RUNTIME_OK;
+  }
+
+  return runtime_write_cell_by_addr(memory, value, address);
+}
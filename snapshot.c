@@ -0,0 +1,339 @@
+/*snapshot.c*/
+
+//
+// Snapshots of nuPython memory, see snapshot.h.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+// to eliminate warnings about stdlib in Visual Studio
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>  // true, false
+#include <string.h>
+
+#include "ram.h"
+#include "snapshot.h"
+#include "util.h"
+
+
+//
+// Private functions:
+//
+
+//
+// panic
+//
+// Outputs the given error message and exits.
+//
+static void panic(char* msg)
+{
+  printf("**SNAPSHOT ERROR\n");
+  printf("**SNAPSHOT ERROR: %s\n", msg);
+  printf("**SNAPSHOT ERROR\n");
+  exit(-1);
+}
+
+//
+// pool_add
+//
+// Copies the given string (including the null terminator)
+// into the pool at the given offset, and returns the offset
+// just past the copy.
+//
+static uint64_t pool_add(char* pool, uint64_t offset, char* s)
+{
+  size_t len = strlen(s) + 1;
+
+  memcpy(pool + offset, s, len);
+
+  return offset + len;
+}
+
+//
+// max_capacity
+//
+// The largest capacity a snapshot of n cells records: memory
+// starts with room for 4 cells (see ram_init) and doubles as
+// it fills, so anything more is spare room we don't need to
+// keep (and, in a block read from a file, a sign of damage).
+//
+static int max_capacity(int n)
+{
+  int64_t capacity = (n < 4) ? 8 : 2 * (int64_t)n;
+
+  return (capacity > INT32_MAX) ? INT32_MAX : (int)capacity;
+}
+
+//
+// ensure_capacity
+//
+// Makes sure the memory has room for at least the given
+// # of cells. New cells are initialized to None, just as
+// ram_init does.
+//
+static void ensure_capacity(struct RAM* memory, int capacity)
+{
+  if (memory->capacity >= capacity)
+    return;
+
+  struct RAM_CELL* cells = (struct RAM_CELL*)realloc(memory->cells, sizeof(struct RAM_CELL) * capacity);
+  if (cells == NULL)
+    panic("out of memory (ram_restore)");
+
+  for (int i = memory->capacity; i < capacity; i++) {
+    cells[i].identifier = NULL;
+    cells[i].value.value_type = RAM_TYPE_NONE;
+  }
+
+  memory->cells = cells;
+  memory->capacity = capacity;
+}
+
+
+//
+// Public functions:
+//
+
+//
+// ram_snapshot
+//
+struct RAM_SNAPSHOT* ram_snapshot(struct RAM* memory)
+{
+  if (memory == NULL)
+    panic("memory ptr is null (ram_snapshot)");
+
+  int n = memory->num_values;
+
+  //
+  // pass 1: how big is the string pool? Identifiers are
+  // stored first, so their offsets stay small:
+  //
+  uint64_t pool_size = 0;
+
+  for (int i = 0; i < n; i++) {
+    struct RAM_CELL* cell = &memory->cells[i];
+
+    pool_size += strlen(cell->identifier) + 1;
+
+    if (cell->value.value_type == RAM_TYPE_STR)
+      pool_size += strlen(cell->value.types.s) + 1;
+  }
+
+  size_t size = sizeof(struct RAM_SNAPSHOT_HEADER) +
+    sizeof(struct RAM_SNAPSHOT_CELL) * n +
+    pool_size;
+
+  struct RAM_SNAPSHOT* snapshot = (struct RAM_SNAPSHOT*)malloc(sizeof(struct RAM_SNAPSHOT));
+  char* block = (char*)malloc(size);
+
+  if (snapshot == NULL || block == NULL)
+    panic("out of memory (ram_snapshot)");
+
+  snapshot->size = size;
+  snapshot->header = (struct RAM_SNAPSHOT_HEADER*)block;
+  snapshot->cells = (struct RAM_SNAPSHOT_CELL*)(block + sizeof(struct RAM_SNAPSHOT_HEADER));
+  snapshot->pool = (char*)(snapshot->cells + n);
+  snapshot->owns_block = true;
+
+  snapshot->header->magic = RAM_SNAPSHOT_MAGIC;
+  snapshot->header->version = RAM_SNAPSHOT_VERSION;
+  snapshot->header->num_values = n;
+  snapshot->header->capacity =
+    (memory->capacity > max_capacity(n)) ? max_capacity(n) : memory->capacity;
+  snapshot->header->pool_size = pool_size;
+
+  //
+  // pass 2: identifiers, then the values:
+  //
+  uint64_t offset = 0;
+
+  for (int i = 0; i < n; i++) {
+    snapshot->cells[i].identifier = (uint32_t)offset;
+    offset = pool_add(snapshot->pool, offset, memory->cells[i].identifier);
+  }
+
+  for (int i = 0; i < n; i++) {
+    struct RAM_VALUE* value = &memory->cells[i].value;
+    struct RAM_SNAPSHOT_CELL* cell = &snapshot->cells[i];
+
+    cell->value_type = value->value_type;
+
+    switch (value->value_type) {
+    case RAM_TYPE_STR:
+      cell->types.s = offset;
+      offset = pool_add(snapshot->pool, offset, value->types.s);
+      break;
+
+    case RAM_TYPE_REAL:
+      cell->types.d = value->types.d;
+      break;
+
+    default:
+      cell->types.s = 0;  // clear all the bits
+      cell->types.i = value->types.i;
+      break;
+    }
+  }
+
+  return snapshot;
+}
+
+//
+// ram_snapshot_destroy
+//
+void ram_snapshot_destroy(struct RAM_SNAPSHOT* snapshot)
+{
+  if (snapshot == NULL)
+    panic("snapshot ptr is null (ram_snapshot_destroy)");
+
+  if (snapshot->owns_block)
+    free(snapshot->header);
+
+  free(snapshot);
+}
+
+//
+// ram_snapshot_from_block
+//
+struct RAM_SNAPSHOT* ram_snapshot_from_block(void* block, size_t size)
+{
+  struct RAM_SNAPSHOT_HEADER* header = (struct RAM_SNAPSHOT_HEADER*)block;
+
+  if (block == NULL || size < sizeof(struct RAM_SNAPSHOT_HEADER))
+    return NULL;
+
+  if (header->magic != RAM_SNAPSHOT_MAGIC ||
+    header->version != RAM_SNAPSHOT_VERSION ||
+    header->num_values < 0 ||
+    header->capacity < 0 ||
+    header->capacity > max_capacity(header->num_values))
+  {
+    return NULL;
+  }
+
+  //
+  // the cells must fit in the block, and the pool is the rest
+  // of it (computed this way round, nothing can overflow):
+  //
+  int n = header->num_values;
+  size_t room = size - sizeof(struct RAM_SNAPSHOT_HEADER);
+
+  if ((size_t)n > room / sizeof(struct RAM_SNAPSHOT_CELL))
+    return NULL;
+
+  uint64_t pool_size = room - sizeof(struct RAM_SNAPSHOT_CELL) * (size_t)n;
+
+  if (pool_size != header->pool_size)
+    return NULL;
+
+  struct RAM_SNAPSHOT_CELL* cells = (struct RAM_SNAPSHOT_CELL*)(header + 1);
+  char* pool = (char*)(cells + n);
+
+  //
+  // every offset must be inside the pool, and the pool must
+  // end with a null terminator, so every string is terminated
+  // within the pool:
+  //
+  if (n > 0 && (pool_size == 0 || pool[pool_size - 1] != '\0'))
+    return NULL;
+
+  for (int i = 0; i < n; i++) {
+    if (cells[i].identifier >= pool_size)
+      return NULL;
+
+    if (cells[i].value_type < RAM_TYPE_INT || cells[i].value_type > RAM_TYPE_NONE)
+      return NULL;
+
+    if (cells[i].value_type == RAM_TYPE_STR && cells[i].types.s >= pool_size)
+      return NULL;
+  }
+
+  struct RAM_SNAPSHOT* snapshot = (struct RAM_SNAPSHOT*)malloc(sizeof(struct RAM_SNAPSHOT));
+  if (snapshot == NULL)
+    panic("out of memory (ram_snapshot_from_block)");
+
+  snapshot->size = size;
+  snapshot->header = header;
+  snapshot->cells = cells;
+  snapshot->pool = pool;
+  snapshot->owns_block = false;
+
+  return snapshot;
+}
+
+//
+// ram_restore
+//
+void ram_restore(struct RAM* memory, struct RAM_SNAPSHOT* snapshot)
+{
+  if (memory == NULL)
+    panic("memory ptr is null (ram_restore)");
+  if (snapshot == NULL)
+    panic("snapshot ptr is null (ram_restore)");
+
+  int n = snapshot->header->num_values;
+
+  ensure_capacity(memory, snapshot->header->capacity > n ? snapshot->header->capacity : n);
+
+  //
+  // cells written after the snapshot was taken are removed,
+  // leaving them as ram_init does:
+  //
+  for (int i = n; i < memory->num_values; i++) {
+    struct RAM_CELL* cell = &memory->cells[i];
+
+    free(cell->identifier);
+    if (cell->value.value_type == RAM_TYPE_STR)
+      free(cell->value.types.s);
+
+    cell->identifier = NULL;
+    cell->value.value_type = RAM_TYPE_NONE;
+  }
+
+  //
+  // now overwrite cells 0..n-1. Unused cells hold a NULL
+  // identifier and None, so they need no special case:
+  //
+  for (int i = 0; i < n; i++) {
+    struct RAM_CELL* cell = &memory->cells[i];
+    struct RAM_SNAPSHOT_CELL* saved = &snapshot->cells[i];
+
+    char* identifier = snapshot->pool + saved->identifier;
+
+    if (cell->identifier == NULL || strcmp(cell->identifier, identifier) != 0) {
+      free(cell->identifier);
+      cell->identifier = dupString(identifier);
+    }
+
+    if (saved->value_type == RAM_TYPE_STR) {
+      char* s = snapshot->pool + saved->types.s;
+
+      if (cell->value.value_type == RAM_TYPE_STR && strcmp(cell->value.types.s, s) == 0)
+        continue;  // same string is already there
+
+      if (cell->value.value_type == RAM_TYPE_STR)
+        free(cell->value.types.s);
+
+      cell->value.value_type = RAM_TYPE_STR;
+      cell->value.types.s = dupString(s);
+      continue;
+    }
+
+    if (cell->value.value_type == RAM_TYPE_STR)
+      free(cell->value.types.s);
+
+    cell->value.value_type = saved->value_type;
+
+    if (saved->value_type == RAM_TYPE_REAL)
+      cell->value.types.d = saved->types.d;
+    else
+      cell->value.types.i = saved->types.i;
+  }
+
+  memory->num_values = n;
+}
@@ -0,0 +1,118 @@
+/*snapshot.h*/
+
+//
+// Snapshots of nuPython memory. A snapshot captures every
+// memory cell --- identifier, type and value --- in a single
+// contiguous block, so that memory can later be restored to
+// exactly that state without re-executing the statements
+// that produced it.
+//
+// The block contains no pointers: identifiers and strings are
+// stored as offsets into a string pool at the end of the block.
+// A snapshot can therefore be copied, written to a file, or
+// mapped from a file as-is.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+#pragma once
+
+#include <stdbool.h>  // true, false
+#include <stddef.h>   // size_t
+#include <stdint.h>   // uint32_t, uint64_t
+
+#include "ram.h"
+
+
+//
+// Layout of a snapshot:
+//
+//   struct RAM_SNAPSHOT_HEADER
+//   struct RAM_SNAPSHOT_CELL  cells[num_values]
+//   char                      pool[pool_size]   (null-terminated strings)
+//
+#define RAM_SNAPSHOT_MAGIC   0x4D41526EU  // "nRAM"
+#define RAM_SNAPSHOT_VERSION 1
+
+struct RAM_SNAPSHOT_HEADER
+{
+  uint32_t magic;       // RAM_SNAPSHOT_MAGIC
+  uint32_t version;     // RAM_SNAPSHOT_VERSION
+  int32_t  num_values;  // # of cells captured
+  int32_t  capacity;    // capacity of the memory when captured
+  uint64_t pool_size;   // # of bytes in the string pool
+};
+
+struct RAM_SNAPSHOT_CELL
+{
+  uint32_t identifier;  // offset of the variable name in the pool
+  int32_t  value_type;  // enum RAM_VALUE_TYPES
+
+  union
+  {
+    int32_t  i;  // INT, PTR, BOOLEAN
+    double   d;  // REAL
+    uint64_t s;  // STR: offset of the string in the pool
+  } types;
+};
+
+struct RAM_SNAPSHOT
+{
+  size_t size;                          // total # of bytes in the block
+  struct RAM_SNAPSHOT_HEADER* header;   // start of the block
+  struct RAM_SNAPSHOT_CELL* cells;      // cells within the block
+  char* pool;                           // string pool within the block
+  bool   owns_block;                    // free the block on destroy?
+};
+
+
+//
+// Public functions:
+//
+
+//
+// ram_snapshot
+//
+// Captures the current contents of the given memory, and
+// returns a dynamically-allocated snapshot. The memory is
+// not changed.
+//
+struct RAM_SNAPSHOT* ram_snapshot(struct RAM* memory);
+
+//
+// ram_snapshot_destroy
+//
+// Frees the memory associated with the given snapshot.
+//
+void ram_snapshot_destroy(struct RAM_SNAPSHOT* snapshot);
+
+//
+// ram_restore
+//
+// Restores the given memory to the state captured by the
+// snapshot: afterwards it has the same cells, in the same
+// order (so addresses are the same), with the same values.
+// Cells written since the snapshot are removed.
+//
+// Memory cells whose identifier is unchanged keep their
+// identifier string, so restoring a memory to a recent
+// snapshot of itself allocates only for string values.
+//
+void ram_restore(struct RAM* memory, struct RAM_SNAPSHOT* snapshot);
+
+
+//
+// ram_snapshot_from_block
+//
+// Given a block of memory laid out as above (e.g. read or
+// mapped from a file), checks that it is a well-formed
+// snapshot of this version and returns a snapshot that refers
+// to the block. The block is not copied, and must outlive the
+// snapshot. Returns NULL if the block is not a valid snapshot.
+//
+// NOTE: ram_snapshot_destroy frees the returned snapshot, but
+// not the block itself.
+//
+struct RAM_SNAPSHOT* ram_snapshot_from_block(void* block, size_t size);
@@ -0,0 +1,3058 @@
+/*ssa.c*/
+
+//
+// SSA intermediate representation for nuPython, see ssa.h.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+// to eliminate warnings about stdlib in Visual Studio
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>  // true, false
+#include <string.h>
+#include <assert.h>
+
+#include "programgraph.h"
+#include "ram.h"
+#include "box.h"
+#include "arena.h"
+#include "quota.h"
+#include "output.h"
+#include "runtime.h"
+#include "builtins.h"
+#include "escape.h"
+#include "ssa.h"
+#include "util.h"
+#include "walk.h"
+
+
+//
+// dispatch with computed goto ("labels as values") when the
+// compiler supports it, otherwise with a switch:
+//
+#if defined(__GNUC__) && !defined(SSA_NO_COMPUTED_GOTO)
+#define SSA_THREADED 1
+#else
+#define SSA_THREADED 0
+#endif
+
+//
+// The static type of a value: RAM_TYPE_INT, RAM_TYPE_REAL, ...
+// if it always has that type, else one of these:
+//
+#define TYPE_UNKNOWN -1  // not known yet
+#define TYPE_DYNAMIC -2  // could be anything
+
+//
+// While building, what we know about each statement of the
+// program graph (pass stmts are skipped, see skip_pass):
+//
+struct SSA_STMT_INFO
+{
+  struct STMT* stmt;
+  int  num_preds;      // # of edges into the stmt
+  bool branch_target;  // is one of them from an if or while?
+  int  block;          // the block the stmt starts, -1 if none
+  int  preheader;      // while loops: the loop's preheader
+};
+
+struct SSA_BUILDER
+{
+  struct SSA_PROGRAM* program;
+
+  struct SSA_STMT_INFO* stmts;
+  int  num_stmts;
+  int  stmt_capacity;
+
+  int  exit;     // the block that ends the program
+  int  block;    // the block being filled
+
+  //
+  // SSA construction, see read_var:
+  //
+  int** defs;    // for each block, the value of each variable
+  bool* filled;  // have the block's instructions been built?
+  bool* sealed;  // have all its predecessors been filled?
+};
+
+//
+// A register of the executable form, see ssa_execute:
+//
+struct SSA_REGISTER
+{
+  struct BOXED_VALUE value;
+  bool owned;       // does the string belong to the register?
+  bool defined;     // false: a variable that isn't in memory (ENTRY)
+  size_t length;    // owned: the string's length, see append
+  size_t capacity;  // owned: the # of bytes allocated for it
+};
+
+//
+// A branch target that needs moves, see lower:
+//
+struct SSA_STUB
+{
+  int pc;      // the branch
+  int target;  // which of its targets
+  int from;    // the edge
+  int to;
+};
+
+//
+// Names for ssa_print:
+//
+static const char* ssa_op_names[] = {
+#define SSA_NAME(op) #op,
+  SSA_OPCODES(SSA_NAME)
+#undef SSA_NAME
+};
+
+static const char* ssa_operator_names[] = {
+  "+", "-", "*", "**", "%", "/", "==", "!=", "<", "<=", ">", ">=", "is", "in"
+};
+
+
+//
+// Private functions:
+//
+
+//
+// panic
+//
+// Outputs the given error message and exits.
+//
+static void panic(char* msg)
+{
+  output_flush();
+
+  printf("**SSA ERROR\n");
+  printf("**SSA ERROR: %s\n", msg);
+  printf("**SSA ERROR\n");
+  exit(-1);
+}
+
+//
+// new_array
+//
+// Allocates an array of n ints, each initialized to value.
+//
+static int* new_array(int n, int value)
+{
+  int* array = (int*)malloc(sizeof(int) * (n > 0 ? n : 1));
+  if (array == NULL)
+    panic("out of memory (ssa_compile)");
+
+  for (int i = 0; i < n; i++)
+    array[i] = value;
+
+  return array;
+}
+
+//
+// skip_pass
+//
+// Returns the first stmt at or after the given one that isn't
+// a pass, NULL if none.
+//
+static struct STMT* skip_pass(struct STMT* stmt)
+{
+  while (stmt != NULL && stmt->stmt_type == STMT_PASS)
+    stmt = stmt->types.pass->next_stmt;
+
+  return stmt;
+}
+
+//
+// is_branch
+//
+// Does the given stmt branch on a condition (if or while)?
+//
+static bool is_branch(struct STMT* stmt)
+{
+  return stmt->stmt_type == STMT_WHILE_LOOP || stmt->stmt_type == STMT_IF_THEN_ELSE;
+}
+
+//
+// next_stmts
+//
+// Returns the stmts that can follow the given one (at most 2:
+// the true path or loop body first), passes skipped.
+//
+static int next_stmts(struct STMT* stmt, struct STMT* next[2])
+{
+  int n = walk_next(stmt, next);
+
+  for (int i = 0; i < n; i++)
+    next[i] = skip_pass(next[i]);
+
+  return n;
+}
+
+//
+// var_index
+//
+// Returns the index of the variable with the given name,
+// adding the variable if this is the first reference.
+//
+static int var_index(struct SSA_PROGRAM* program, char* var_name)
+{
+  int i = walk_var_index(program->vars, program->num_vars, sizeof(struct RUNTIME_VAR), var_name);
+
+  if (i >= 0)
+    return i;
+
+  program->vars = (struct RUNTIME_VAR*)grow(program->vars, program->num_vars,
+    &program->var_capacity, sizeof(struct RUNTIME_VAR));
+
+  program->vars[program->num_vars].name = var_name;
+  program->vars[program->num_vars].address = -1;
+
+  return program->num_vars++;
+}
+
+//
+// lives_in_memory
+//
+// Does the given variable live in memory (see build)?
+//
+static bool lives_in_memory(struct SSA_PROGRAM* program, int var)
+{
+  return program->in_memory || program->var_in_memory[var];
+}
+
+
+//
+// Building the control flow graph:
+//
+
+//
+// find_stmt
+//
+// Returns what we know about the given stmt, adding it if
+// this is the first reference.
+//
+static struct SSA_STMT_INFO* find_stmt(struct SSA_BUILDER* builder, struct STMT* stmt)
+{
+  for (int i = 0; i < builder->num_stmts; i++)
+    if (builder->stmts[i].stmt == stmt)
+      return &builder->stmts[i];
+
+  builder->stmts = (struct SSA_STMT_INFO*)grow(builder->stmts, builder->num_stmts,
+    &builder->stmt_capacity, sizeof(struct SSA_STMT_INFO));
+
+  struct SSA_STMT_INFO* info = &builder->stmts[builder->num_stmts++];
+
+  info->stmt = stmt;
+  info->num_preds = 0;
+  info->branch_target = false;
+  info->block = -1;
+  info->preheader = -1;
+
+  return info;
+}
+
+//
+// collect_var
+//
+// Notes a variable the program refers to (see walk_vars).
+//
+static void collect_var(void* context, char* name, int use)
+{
+  var_index((struct SSA_PROGRAM*)context, name);
+}
+
+//
+// collect_stmts
+//
+// Finds every stmt of the program, and the edges into it;
+// also the variables.
+//
+static void collect_stmts(struct SSA_BUILDER* builder, struct STMT* first)
+{
+  struct SSA_PROGRAM* program = builder->program;
+
+  if (first == NULL)
+    return;
+
+  find_stmt(builder, first)->num_preds++;  // from the entry
+
+  for (int i = 0; i < builder->num_stmts; i++) {
+    struct STMT* stmt = builder->stmts[i].stmt;
+
+    walk_vars(stmt, collect_var, program);
+
+    struct STMT* next[2];
+    int n = next_stmts(stmt, next);
+
+    if (n == 2 && next[0] == next[1])
+      n = 1;  // both paths lead to the same stmt, one edge
+
+    for (int j = 0; j < n; j++) {
+      if (next[j] == NULL)
+        continue;
+
+      struct SSA_STMT_INFO* info = find_stmt(builder, next[j]);
+
+      info->num_preds++;
+      if (is_branch(stmt))
+        info->branch_target = true;
+    }
+  }
+}
+
+//
+// new_block
+//
+// Adds an empty block that starts with the given stmt (NULL
+// if none), and returns its index.
+//
+static int new_block(struct SSA_PROGRAM* program, struct STMT* stmt)
+{
+  program->blocks = (struct SSA_BLOCK*)grow(program->blocks, program->num_blocks,
+    &program->block_capacity, sizeof(struct SSA_BLOCK));
+
+  struct SSA_BLOCK* block = &program->blocks[program->num_blocks];
+
+  memset(block, 0, sizeof(struct SSA_BLOCK));
+  block->stmt = stmt;
+  block->idom = -1;
+  block->preheader = -1;
+
+  return program->num_blocks++;
+}
+
+//
+// add_edge
+//
+// Adds the edge from -> to.
+//
+static void add_edge(struct SSA_PROGRAM* program, int from, int to)
+{
+  struct SSA_BLOCK* source = &program->blocks[from];
+
+  for (int i = 0; i < source->num_succs; i++)
+    if (source->succs[i] == to)
+      return;
+
+  assert(source->num_succs < 2);
+  source->succs[source->num_succs++] = to;
+
+  struct SSA_BLOCK* target = &program->blocks[to];
+
+  target->preds = (int*)grow(target->preds, target->num_preds,
+    &target->pred_capacity, sizeof(int));
+  target->preds[target->num_preds++] = from;
+}
+
+//
+// in_loop_body
+//
+// Is the given stmt part of the body of the given while loop?
+// That is, can it be reached from the loop body without going
+// through the loop?
+//
+static bool in_loop_body(struct SSA_BUILDER* builder, struct STMT* loop, struct STMT* stmt)
+{
+  struct STMT** worklist = (struct STMT**)malloc(sizeof(struct STMT*) * (builder->num_stmts + 1));
+  bool* visited = (bool*)calloc(builder->num_stmts + 1, sizeof(bool));
+
+  if (worklist == NULL || visited == NULL)
+    panic("out of memory (ssa_compile)");
+
+  int count = 0;
+  bool found = false;
+
+  struct STMT* body = skip_pass(loop->types.while_loop->loop_body);
+
+  if (body != NULL && body != loop) {
+    worklist[count++] = body;
+    visited[find_stmt(builder, body) - builder->stmts] = true;
+  }
+
+  while (count > 0 && !found) {
+    struct STMT* current = worklist[--count];
+    struct STMT* next[2];
+
+    if (current == stmt)
+      found = true;
+
+    int n = next_stmts(current, next);
+
+    for (int i = 0; i < n; i++) {
+      if (next[i] == NULL || next[i] == loop)
+        continue;
+
+      int index = (int)(find_stmt(builder, next[i]) - builder->stmts);
+
+      if (!visited[index]) {
+        visited[index] = true;
+        worklist[count++] = next[i];
+      }
+    }
+  }
+
+  free(worklist);
+  free(visited);
+
+  return found;
+}
+
+//
+// target_block
+//
+// The block an edge from the given stmt (NULL: the entry) to
+// the given stmt leads to: the block the stmt starts, but for
+// a while loop entered from outside the loop, its preheader.
+//
+static int target_block(struct SSA_BUILDER* builder, struct STMT* from, struct STMT* to)
+{
+  if (to == NULL)
+    return builder->exit;
+
+  struct SSA_STMT_INFO* info = find_stmt(builder, to);
+
+  if (to->stmt_type == STMT_WHILE_LOOP && from != to &&
+    (from == NULL || !in_loop_body(builder, to, from)))
+  {
+    return info->preheader;
+  }
+
+  return info->block;
+}
+
+//
+// build_cfg
+//
+// Divides the stmts into blocks, and adds the edges between
+// them. A block starts with a stmt that is reached from more
+// than one place (or from an if or while), and with every if
+// and while, which end their block. Block 0 is the entry, and
+// every while loop gets a preheader, which is where the loop
+// is entered from (loop invariants are moved there).
+//
+static void build_cfg(struct SSA_BUILDER* builder, struct STMT* first)
+{
+  struct SSA_PROGRAM* program = builder->program;
+
+  new_block(program, NULL);  // the entry
+  builder->exit = new_block(program, NULL);
+
+  for (int i = 0; i < builder->num_stmts; i++) {
+    struct SSA_STMT_INFO* info = &builder->stmts[i];
+
+    if (info->stmt == first || info->num_preds != 1 || info->branch_target || is_branch(info->stmt))
+      info->block = new_block(program, info->stmt);
+
+    if (info->stmt->stmt_type == STMT_WHILE_LOOP) {
+      info->preheader = new_block(program, NULL);
+      program->blocks[info->block].preheader = info->preheader;
+    }
+  }
+
+  add_edge(program, 0, target_block(builder, NULL, skip_pass(first)));
+
+  for (int i = 0; i < builder->num_stmts; i++) {
+    struct SSA_STMT_INFO* info = &builder->stmts[i];
+
+    if (info->preheader >= 0)
+      add_edge(program, info->preheader, info->block);
+
+    if (info->block < 0)
+      continue;
+
+    //
+    // follow the stmts of the block to its end:
+    //
+    struct STMT* stmt = info->stmt;
+
+    for (;;) {
+      struct STMT* next[2];
+      int n = next_stmts(stmt, next);
+
+      if (is_branch(stmt)) {
+        for (int j = 0; j < n; j++)
+          add_edge(program, info->block, target_block(builder, stmt, next[j]));
+        break;
+      }
+
+      if (next[0] == NULL || find_stmt(builder, next[0])->block >= 0) {
+        add_edge(program, info->block, target_block(builder, stmt, next[0]));
+        break;
+      }
+
+      stmt = next[0];
+    }
+  }
+}
+
+//
+// compute_order
+//
+// Orders the blocks in reverse postorder: a block comes before
+// its successors, except along the edges that close a loop.
+//
+static void compute_order(struct SSA_PROGRAM* program)
+{
+  int n = program->num_blocks;
+  int* stack = new_array(n, 0);
+  int* next_succ = new_array(n, 0);
+  int* postorder = new_array(n, 0);
+  bool* visited = (bool*)calloc(n, sizeof(bool));
+
+  if (visited == NULL)
+    panic("out of memory (ssa_compile)");
+
+  int depth = 0;
+  int count = 0;
+
+  stack[depth++] = 0;
+  visited[0] = true;
+
+  while (depth > 0) {
+    int b = stack[depth - 1];
+    struct SSA_BLOCK* block = &program->blocks[b];
+
+    if (next_succ[b] < block->num_succs) {
+      int succ = block->succs[next_succ[b]++];
+
+      if (!visited[succ]) {
+        visited[succ] = true;
+        stack[depth++] = succ;
+      }
+    }
+    else {
+      postorder[count++] = b;
+      depth--;
+    }
+  }
+
+  program->order = new_array(count, 0);
+  program->num_order = count;
+
+  for (int i = 0; i < count; i++)
+    program->order[i] = postorder[count - 1 - i];
+
+  free(stack);
+  free(next_succ);
+  free(postorder);
+  free(visited);
+}
+
+
+//
+// Building the instructions:
+//
+
+//
+// new_instr
+//
+// Adds an instruction to the given block, and returns it (its
+// value); a phi goes after the block's other phis, anything
+// else at the end.
+//
+static int new_instr(struct SSA_PROGRAM* program, int block, int op, int line, int var, int arg0, int arg1)
+{
+  program->instrs = (struct SSA_INSTR*)grow(program->instrs, program->num_instrs,
+    &program->instr_capacity, sizeof(struct SSA_INSTR));
+
+  int value = program->num_instrs++;
+  struct SSA_INSTR* instr = &program->instrs[value];
+
+  memset(instr, 0, sizeof(struct SSA_INSTR));
+  instr->op = op;
+  instr->line = line;
+  instr->block = block;
+  instr->var = var;
+  instr->operator = OPERATOR_NO_OP;
+  instr->args[0] = arg0;
+  instr->args[1] = arg1;
+  instr->targets[0] = -1;
+  instr->targets[1] = -1;
+  instr->constant = box_none();
+  instr->reg = value;
+
+  struct SSA_BLOCK* b = &program->blocks[block];
+
+  b->instrs = (int*)grow(b->instrs, b->num_instrs, &b->instr_capacity, sizeof(int));
+
+  if (op == SSA_PHI) {
+    memmove(&b->instrs[b->num_phis + 1], &b->instrs[b->num_phis], sizeof(int) * (b->num_instrs - b->num_phis));
+    b->instrs[b->num_phis++] = value;
+  }
+  else {
+    b->instrs[b->num_instrs] = value;
+  }
+
+  b->num_instrs++;
+
+  return value;
+}
+
+static int read_var(struct SSA_BUILDER* builder, int var, int block);
+
+//
+// add_phi_args
+//
+// Fills in the args of the given phi: the value of its
+// variable at the end of each predecessor of its block.
+//
+static void add_phi_args(struct SSA_BUILDER* builder, int phi)
+{
+  struct SSA_PROGRAM* program = builder->program;
+  int block = program->instrs[phi].block;
+  int var = program->instrs[phi].var;
+  int num_preds = program->blocks[block].num_preds;
+
+  int* args = new_array(num_preds, -1);
+
+  for (int i = 0; i < num_preds; i++)
+    args[i] = read_var(builder, var, program->blocks[block].preds[i]);
+
+  program->instrs[phi].phi_args = args;
+}
+
+//
+// read_var
+// write_var
+//
+// The value of the given variable at the current end of the
+// given block, and assigning it a new value. This is the SSA
+// construction of Braun et al.: a block that doesn't assign
+// the variable gets its value from its predecessor, or a phi
+// if it has more than one. A block whose predecessors haven't
+// all been built yet (the top of a loop) isn't sealed, so its
+// phis are completed later, see seal_block.
+//
+static int read_var(struct SSA_BUILDER* builder, int var, int block)
+{
+  struct SSA_PROGRAM* program = builder->program;
+  int value = builder->defs[block][var];
+
+  if (value >= 0)
+    return value;
+
+  if (!builder->sealed[block]) {
+    value = new_instr(program, block, SSA_PHI, 0, var, -1, -1);
+  }
+  else if (program->blocks[block].num_preds == 1) {
+    value = read_var(builder, var, program->blocks[block].preds[0]);
+  }
+  else {
+    //
+    // the phi is the variable's value before its args are
+    // read, which ends the search around a loop:
+    //
+    value = new_instr(program, block, SSA_PHI, 0, var, -1, -1);
+    builder->defs[block][var] = value;
+    add_phi_args(builder, value);
+  }
+
+  builder->defs[block][var] = value;
+
+  return value;
+}
+
+static void write_var(struct SSA_BUILDER* builder, int var, int value)
+{
+  builder->defs[builder->block][var] = value;
+}
+
+//
+// seal_block
+//
+// All the predecessors of the given block have been filled,
+// so its incomplete phis can be completed.
+//
+static void seal_block(struct SSA_BUILDER* builder, int block)
+{
+  struct SSA_PROGRAM* program = builder->program;
+
+  builder->sealed[block] = true;
+
+  for (int i = 0; i < program->blocks[block].num_phis; i++) {
+    int phi = program->blocks[block].instrs[i];
+
+    if (program->instrs[phi].phi_args == NULL)
+      add_phi_args(builder, phi);
+  }
+}
+
+//
+// preds_filled
+//
+// Have all the predecessors of the given block been filled?
+//
+static bool preds_filled(struct SSA_BUILDER* builder, int block)
+{
+  struct SSA_BLOCK* b = &builder->program->blocks[block];
+
+  for (int i = 0; i < b->num_preds; i++)
+    if (!builder->filled[b->preds[i]])
+      return false;
+
+  return true;
+}
+
+//
+// emit
+//
+// Adds an instruction to the block being filled. If it can
+// stop the program, it gets a snapshot of the values of the
+// variables that live in registers.
+//
+static int emit(struct SSA_BUILDER* builder, int op, int line, int var, int arg0, int arg1, bool can_stop)
+{
+  struct SSA_PROGRAM* program = builder->program;
+  int* snapshot = NULL;
+
+  if (can_stop && !program->in_memory && program->num_vars > 0) {
+    snapshot = new_array(program->num_vars, -1);
+
+    for (int i = 0; i < program->num_vars; i++)
+      if (!lives_in_memory(program, i))
+        snapshot[i] = read_var(builder, i, builder->block);
+  }
+
+  int value = new_instr(program, builder->block, op, line, var, arg0, arg1);
+
+  program->instrs[value].snapshot = snapshot;
+
+  return value;
+}
+
+//
+// build_var
+// build_element
+// build_unary
+// build_expr
+//
+// Builds the instructions computing the value of a variable,
+// an element, unary expression, or expression, and returns
+// its value.
+//
+static int build_var(struct SSA_BUILDER* builder, int line, int var)
+{
+  struct SSA_PROGRAM* program = builder->program;
+
+  if (lives_in_memory(program, var))
+    return emit(builder, SSA_LOAD, line, var, -1, -1, true);
+
+  int value = read_var(builder, var, builder->block);
+
+  emit(builder, SSA_CHECK, line, var, value, -1, true);
+
+  return value;
+}
+
+static int build_element(struct SSA_BUILDER* builder, int line, struct ELEMENT* element)
+{
+  struct SSA_PROGRAM* program = builder->program;
+  char* literal = element->element_value;
+
+  if (element->element_type == ELEMENT_IDENTIFIER)
+    return build_var(builder, line, var_index(program, literal));
+
+  if (element->element_type == ELEMENT_NONE) {
+    int fail = emit(builder, SSA_FAIL, line, -1, -1, -1, true);
+
+    program->instrs[fail].operator = RUNTIME_UNEXPECTED_ELEMENT;
+    return fail;
+  }
+
+  struct BOXED_VALUE constant;
+
+  switch (element->element_type) {
+  case ELEMENT_INT_LITERAL:
+    constant = box_int(atoi(literal));
+    break;
+
+  case ELEMENT_REAL_LITERAL:
+    constant = box_real(atof(literal));
+    break;
+
+  case ELEMENT_STR_LITERAL:
+    constant = box_str(literal);
+    break;
+
+  case ELEMENT_TRUE:
+    constant = box_bool(true);
+    break;
+
+  default:
+    assert(element->element_type == ELEMENT_FALSE);
+    constant = box_bool(false);
+    break;
+  }
+
+  int value = emit(builder, SSA_CONST, line, -1, -1, -1, false);
+
+  program->instrs[value].constant = constant;
+
+  return value;
+}
+
+static int build_unary(struct SSA_BUILDER* builder, int line, struct UNARY_EXPR* unary)
+{
+  struct SSA_PROGRAM* program = builder->program;
+
+  switch (unary->expr_type) {
+  case UNARY_ELEMENT:
+    return build_element(builder, line, unary->element);
+
+  case UNARY_ADDRESS_OF:
+    return emit(builder, SSA_ADDR, line, var_index(program, unary->element->element_value), -1, -1, true);
+
+  case UNARY_PTR_DEREF:
+    {
+      int var = var_index(program, unary->element->element_value);
+      int ptr = build_var(builder, line, var);
+
+      return emit(builder, SSA_DEREF, line, var, ptr, -1, true);
+    }
+
+  default:
+    {
+      int fail = emit(builder, SSA_FAIL, line, -1, -1, -1, true);
+
+      program->instrs[fail].operator = RUNTIME_UNSUPPORTED_UNARY;
+      return fail;
+    }
+  }
+}
+
+static int build_expr(struct SSA_BUILDER* builder, int line, struct VALUE_EXPR* expr)
+{
+  assert(expr->lhs != NULL);
+
+  int lhs = build_unary(builder, line, expr->lhs);
+
+  if (!expr->isBinaryExpr)
+    return lhs;
+
+  assert(expr->rhs != NULL);
+  assert(expr->operator != OPERATOR_NO_OP);
+
+  int rhs = build_unary(builder, line, expr->rhs);
+  int value = emit(builder, SSA_BINOP, line, -1, lhs, rhs, true);
+
+  builder->program->instrs[value].operator = expr->operator;
+
+  return value;
+}
+
+//
+// build_call
+//
+// Builds the instructions of a call of a builtin function,
+// and returns its value. The function is looked up now, once;
+// calling one we don't have is an error.
+//
+static int build_call(struct SSA_BUILDER* builder, int line, char* function_name, struct ELEMENT* parameter)
+{
+  struct SSA_PROGRAM* program = builder->program;
+  int index = builtin_lookup(function_name);
+
+  if (index < 0) {
+    int fail = emit(builder, SSA_FAIL, line, -1, -1, -1, true);
+
+    program->instrs[fail].operator = RUNTIME_UNDEFINED;
+    program->instrs[fail].constant = box_str(function_name);
+    return fail;
+  }
+
+  int arg = (parameter != NULL) ? build_element(builder, line, parameter) : -1;
+  int value = emit(builder, SSA_CALL, line, -1, arg, -1, true);
+
+  program->instrs[value].operator = index;
+
+  return value;
+}
+
+//
+// is_append
+//
+// Returns true if the given assignment is x = x + e, where x
+// lives in memory (see SSA_APPEND).
+//
+static bool is_append(struct SSA_PROGRAM* program, struct STMT_ASSIGNMENT* assign)
+{
+  if (assign->isPtrDeref || assign->rhs->value_type != VALUE_EXPR)
+    return false;
+
+  struct VALUE_EXPR* expr = assign->rhs->types.expr;
+
+  return expr->isBinaryExpr &&
+    expr->operator == OPERATOR_PLUS &&
+    expr->lhs->expr_type == UNARY_ELEMENT &&
+    expr->lhs->element->element_type == ELEMENT_IDENTIFIER &&
+    strcmp(expr->lhs->element->element_value, assign->var_name) == 0 &&
+    lives_in_memory(program, var_index(program, assign->var_name));
+}
+
+//
+// build_stmt
+//
+// Builds the instructions of an assignment or call.
+//
+static void build_stmt(struct SSA_BUILDER* builder, struct STMT* stmt)
+{
+  struct SSA_PROGRAM* program = builder->program;
+  int line = stmt->line;
+
+  if (stmt->stmt_type == STMT_ASSIGNMENT) {
+    struct STMT_ASSIGNMENT* assign = stmt->types.assignment;
+    struct VALUE_EXPR* expr = NULL;
+    int value;
+
+    if (is_append(program, assign)) {
+      //
+      // x's cell is looked up first, so an undefined x is the
+      // error even if e has one too (as in execute()):
+      //
+      int var = var_index(program, assign->var_name);
+      int address = emit(builder, SSA_ADDR, line, var, -1, -1, true);
+      int rhs = build_unary(builder, line, assign->rhs->types.expr->rhs);
+
+      emit(builder, SSA_APPEND, line, var, address, rhs, true);
+      return;
+    }
+
+    if (assign->rhs->value_type == VALUE_FUNCTION_CALL) {
+      struct VALUE_FUNCTION_CALL* call = assign->rhs->types.function_call;
+
+      value = build_call(builder, line, call->function_name, call->parameter);
+    }
+    else {
+      expr = assign->rhs->types.expr;
+      value = build_expr(builder, line, expr);
+    }
+
+    int var = var_index(program, assign->var_name);
+
+    if (assign->isPtrDeref) {
+      int ptr = build_var(builder, line, var);
+
+      emit(builder, SSA_STOREP, line, var, ptr, value, true);
+    }
+    else if (lives_in_memory(program, var)) {
+      emit(builder, SSA_STORE, line, var, value, -1, true);
+    }
+    else {
+      //
+      // "x = y" or "x = 1" copies a value, which x is then
+      // another name for (see propagate_copies):
+      //
+      if (expr != NULL && !expr->isBinaryExpr && expr->lhs->expr_type == UNARY_ELEMENT)
+        value = emit(builder, SSA_COPY, line, -1, value, -1, false);
+
+      int before = read_var(builder, var, builder->block);
+
+      emit(builder, SSA_DEFINE, line, var, before, -1, false);
+      write_var(builder, var, value);
+    }
+  }
+  else {
+    assert(stmt->stmt_type == STMT_FUNCTION_CALL);
+
+    struct STMT_FUNCTION_CALL* call = stmt->types.function_call;
+
+    //
+    // print has an instruction of its own; any other function
+    // is called, and what it returns is discarded:
+    //
+    if (strcmp(call->function_name, "print") != 0)
+      build_call(builder, line, call->function_name, call->parameter);
+    else if (call->parameter == NULL)
+      emit(builder, SSA_PRINT, line, -1, -1, -1, false);
+    else
+      emit(builder, SSA_PRINT, line, -1, build_element(builder, line, call->parameter), -1, true);
+  }
+}
+
+//
+// emit_jump
+//
+static void emit_jump(struct SSA_BUILDER* builder, int target)
+{
+  int jump = emit(builder, SSA_JUMP, 0, -1, -1, -1, false);
+
+  builder->program->instrs[jump].targets[0] = target;
+}
+
+//
+// fill_block
+//
+// Builds the instructions of the given block.
+//
+static void fill_block(struct SSA_BUILDER* builder, int block)
+{
+  struct SSA_PROGRAM* program = builder->program;
+
+  builder->block = block;
+
+  if (!builder->sealed[block] && preds_filled(builder, block))
+    seal_block(builder, block);
+
+  if (block == 0) {
+    //
+    // the entry: variables in registers start with their values
+    // in memory, if any:
+    //
+    for (int i = 0; i < program->num_vars; i++) {
+      if (lives_in_memory(program, i))
+        continue;
+
+      program->entries[i] = emit(builder, SSA_ENTRY, 0, i, -1, -1, false);
+      write_var(builder, i, program->entries[i]);
+    }
+
+    emit_jump(builder, program->blocks[block].succs[0]);
+  }
+  else if (block == builder->exit) {
+    emit(builder, SSA_RETURN, 0, -1, -1, -1, true);
+  }
+  else if (program->blocks[block].stmt == NULL) {
+    //
+    // a loop preheader:
+    //
+    emit_jump(builder, program->blocks[block].succs[0]);
+  }
+  else {
+    struct STMT* stmt = program->blocks[block].stmt;
+
+    for (;;) {
+      struct STMT* next[2];
+      int n = next_stmts(stmt, next);
+
+      if (is_branch(stmt)) {
+        struct VALUE_EXPR* condition = (stmt->stmt_type == STMT_WHILE_LOOP) ?
+          stmt->types.while_loop->condition : stmt->types.if_then_else->condition;
+
+        int value = build_expr(builder, stmt->line, condition);
+        int true_block = target_block(builder, stmt, next[0]);
+        int false_block = target_block(builder, stmt, next[1]);
+
+        if (true_block == false_block) {
+          emit_jump(builder, true_block);
+        }
+        else {
+          int branch = emit(builder, SSA_BRANCH, stmt->line, -1, value, -1, false);
+
+          program->instrs[branch].targets[0] = true_block;
+          program->instrs[branch].targets[1] = false_block;
+        }
+        break;
+      }
+
+      build_stmt(builder, stmt);
+
+      if (n == 0 || next[0] == NULL || find_stmt(builder, next[0])->block >= 0) {
+        emit_jump(builder, target_block(builder, stmt, next[0]));
+        break;
+      }
+
+      stmt = next[0];
+    }
+  }
+
+  builder->filled[block] = true;
+
+  for (int i = 0; i < program->blocks[block].num_succs; i++) {
+    int succ = program->blocks[block].succs[i];
+
+    if (!builder->sealed[succ] && preds_filled(builder, succ))
+      seal_block(builder, succ);
+  }
+}
+
+//
+// build
+//
+// Builds the blocks and instructions of the given program
+// graph, in SSA form.
+//
+static void build(struct SSA_PROGRAM* program, struct STMT* graph)
+{
+  struct SSA_BUILDER builder;
+
+  memset(&builder, 0, sizeof(builder));
+  builder.program = program;
+
+  struct STMT* first = skip_pass(graph);
+
+  collect_stmts(&builder, first);
+
+  //
+  // a variable whose address is taken lives in memory, where
+  // pointers can reach it; if they can reach any variable (see
+  // escape.h), or a quota is set (which limits every write as
+  // it is made), every variable does:
+  //
+  struct ESCAPE_INFO* escape = escape_analyze(first);
+
+  if (quota_limit() > 0 || (escape->uses_pointers && !escape->confined))
+    program->in_memory = true;
+
+  program->var_in_memory = (bool*)malloc(sizeof(bool) * (program->num_vars + 1));
+  if (program->var_in_memory == NULL)
+    panic("out of memory (ssa_compile)");
+
+  for (int i = 0; i < program->num_vars; i++)
+    program->var_in_memory[i] = program->in_memory || escape_in_memory(escape, program->vars[i].name);
+
+  escape_destroy(escape);
+
+  build_cfg(&builder, first);
+  compute_order(program);
+
+  program->entries = new_array(program->num_vars, -1);
+
+  builder.defs = (int**)malloc(sizeof(int*) * program->num_blocks);
+  builder.filled = (bool*)calloc(program->num_blocks, sizeof(bool));
+  builder.sealed = (bool*)calloc(program->num_blocks, sizeof(bool));
+
+  if (builder.defs == NULL || builder.filled == NULL || builder.sealed == NULL)
+    panic("out of memory (ssa_compile)");
+
+  for (int i = 0; i < program->num_blocks; i++)
+    builder.defs[i] = new_array(program->num_vars, -1);
+
+  for (int i = 0; i < program->num_order; i++)
+    fill_block(&builder, program->order[i]);
+
+  for (int i = 0; i < program->num_blocks; i++)
+    free(builder.defs[i]);
+
+  free(builder.defs);
+  free(builder.filled);
+  free(builder.sealed);
+  free(builder.stmts);
+}
+
+
+//
+// Optimizations:
+//
+
+//
+// resolve
+//
+// Follows the given value's replacements (forward[v] >= 0 if
+// v was replaced) to the value that replaces it.
+//
+static int resolve(int* forward, int value)
+{
+  while (value >= 0 && forward[value] >= 0)
+    value = forward[value];
+
+  return value;
+}
+
+//
+// cleanup
+//
+// After an optimization: replaces the uses of each replaced
+// value, and removes the dead instructions from their blocks.
+//
+static void cleanup(struct SSA_PROGRAM* program, int* forward)
+{
+  for (int i = 0; i < program->num_instrs; i++) {
+    struct SSA_INSTR* instr = &program->instrs[i];
+
+    if (instr->dead)
+      continue;
+
+    instr->args[0] = resolve(forward, instr->args[0]);
+    instr->args[1] = resolve(forward, instr->args[1]);
+
+    if (instr->phi_args != NULL)
+      for (int j = 0; j < program->blocks[instr->block].num_preds; j++)
+        instr->phi_args[j] = resolve(forward, instr->phi_args[j]);
+
+    if (instr->snapshot != NULL)
+      for (int j = 0; j < program->num_vars; j++)
+        instr->snapshot[j] = resolve(forward, instr->snapshot[j]);
+  }
+
+  for (int i = 0; i < program->num_vars; i++)
+    program->entries[i] = resolve(forward, program->entries[i]);
+
+  for (int b = 0; b < program->num_blocks; b++) {
+    struct SSA_BLOCK* block = &program->blocks[b];
+    int count = 0;
+    int phis = 0;
+
+    for (int i = 0; i < block->num_instrs; i++) {
+      struct SSA_INSTR* instr = &program->instrs[block->instrs[i]];
+
+      if (instr->dead)
+        continue;
+
+      if (instr->op == SSA_PHI)
+        phis++;
+
+      block->instrs[count++] = block->instrs[i];
+    }
+
+    block->num_instrs = count;
+    block->num_phis = phis;
+  }
+}
+
+//
+// kill
+//
+// Removes the given instruction; uses of its value use the
+// given value instead (-1 if there are none).
+//
+static void kill(struct SSA_PROGRAM* program, int* forward, int value, int replacement)
+{
+  struct SSA_INSTR* instr = &program->instrs[value];
+
+  instr->dead = true;
+  forward[value] = replacement;
+
+  free(instr->phi_args);
+  free(instr->snapshot);
+  instr->phi_args = NULL;
+  instr->snapshot = NULL;
+}
+
+//
+// propagate_copies
+//
+// "y = x": y's value is x's, so the copy is removed and its
+// uses use x's value.
+//
+static void propagate_copies(struct SSA_PROGRAM* program, int* forward)
+{
+  for (int i = 0; i < program->num_instrs; i++)
+    if (!program->instrs[i].dead && program->instrs[i].op == SSA_COPY) {
+      kill(program, forward, i, program->instrs[i].args[0]);
+      program->stats.copies++;
+    }
+
+  cleanup(program, forward);
+}
+
+//
+// remove_trivial_phis
+//
+// A phi whose args are all the same value (or the phi itself,
+// around a loop that doesn't assign the variable) is that
+// value. Removing one can make others trivial, so repeat until
+// nothing changes.
+//
+static void remove_trivial_phis(struct SSA_PROGRAM* program, int* forward)
+{
+  bool changed = true;
+
+  while (changed) {
+    changed = false;
+
+    for (int i = 0; i < program->num_instrs; i++) {
+      struct SSA_INSTR* instr = &program->instrs[i];
+
+      if (instr->dead || instr->op != SSA_PHI)
+        continue;
+
+      int same = -1;
+      bool trivial = true;
+
+      for (int j = 0; j < program->blocks[instr->block].num_preds && trivial; j++) {
+        int arg = resolve(forward, instr->phi_args[j]);
+
+        if (arg == i || arg == same)
+          continue;
+
+        if (same >= 0)
+          trivial = false;
+
+        same = arg;
+      }
+
+      if (trivial && same >= 0) {
+        kill(program, forward, i, same);
+        program->stats.phis++;
+        changed = true;
+      }
+    }
+  }
+
+  cleanup(program, forward);
+}
+
+//
+// remove_checks
+//
+// Only a variable's value on entry can be undefined (if the
+// variable isn't in memory when the program starts), so a
+// check of any other value is removed: the variable has been
+// assigned on every path. Likewise a variable assigned on
+// every path already has its memory cell, so the define is
+// removed. The value a define replaces isn't a use.
+//
+static void remove_checks(struct SSA_PROGRAM* program, int* forward)
+{
+  bool* may_be_entry = (bool*)calloc(program->num_instrs, sizeof(bool));
+
+  if (may_be_entry == NULL)
+    panic("out of memory (ssa_compile)");
+
+  for (int i = 0; i < program->num_instrs; i++)
+    if (!program->instrs[i].dead && program->instrs[i].op == SSA_ENTRY)
+      may_be_entry[i] = true;
+
+  bool changed = true;
+
+  while (changed) {
+    changed = false;
+
+    for (int i = 0; i < program->num_instrs; i++) {
+      struct SSA_INSTR* instr = &program->instrs[i];
+
+      if (instr->dead || instr->op != SSA_PHI || may_be_entry[i])
+        continue;
+
+      for (int j = 0; j < program->blocks[instr->block].num_preds; j++)
+        if (may_be_entry[instr->phi_args[j]]) {
+          may_be_entry[i] = true;
+          changed = true;
+          break;
+        }
+    }
+  }
+
+  for (int i = 0; i < program->num_instrs; i++) {
+    struct SSA_INSTR* instr = &program->instrs[i];
+
+    if (instr->dead || (instr->op != SSA_CHECK && instr->op != SSA_DEFINE))
+      continue;
+
+    if (!may_be_entry[instr->args[0]]) {
+      kill(program, forward, i, -1);
+      program->stats.checks++;
+    }
+    else if (instr->op == SSA_DEFINE) {
+      instr->args[0] = -1;
+    }
+  }
+
+  free(may_be_entry);
+
+  cleanup(program, forward);
+}
+
+//
+// compute_dominators
+//
+// The immediate dominator of each block: the last block every
+// path from the entry to the block goes through. This is the
+// algorithm of Cooper, Harvey and Kennedy, over the blocks in
+// reverse postorder.
+//
+static void compute_dominators(struct SSA_PROGRAM* program, int* rpo)
+{
+  struct SSA_BLOCK* blocks = program->blocks;
+
+  for (int i = 0; i < program->num_order; i++)
+    rpo[program->order[i]] = i;
+
+  blocks[0].idom = 0;
+
+  bool changed = true;
+
+  while (changed) {
+    changed = false;
+
+    for (int i = 1; i < program->num_order; i++) {
+      int b = program->order[i];
+      int idom = -1;
+
+      for (int j = 0; j < blocks[b].num_preds; j++) {
+        int pred = blocks[b].preds[j];
+
+        if (blocks[pred].idom < 0)
+          continue;  // not processed yet
+
+        if (idom < 0) {
+          idom = pred;
+          continue;
+        }
+
+        //
+        // intersect: walk up from both until they meet:
+        //
+        int x = pred;
+        int y = idom;
+
+        while (x != y) {
+          while (rpo[x] > rpo[y])
+            x = blocks[x].idom;
+          while (rpo[y] > rpo[x])
+            y = blocks[y].idom;
+        }
+
+        idom = x;
+      }
+
+      if (blocks[b].idom != idom) {
+        blocks[b].idom = idom;
+        changed = true;
+      }
+    }
+  }
+
+  blocks[0].idom = -1;
+}
+
+//
+// dominates
+//
+// Does block a dominate block b?
+//
+static bool dominates(struct SSA_PROGRAM* program, int a, int b)
+{
+  while (b >= 0 && b != a)
+    b = program->blocks[b].idom;
+
+  return b == a;
+}
+
+//
+// is_numeric
+//
+static bool is_numeric(int type)
+{
+  return type == RAM_TYPE_INT || type == RAM_TYPE_REAL;
+}
+
+//
+// meet
+//
+// The type of a value that is one of two types.
+//
+static int meet(int type1, int type2)
+{
+  if (type1 == TYPE_UNKNOWN)
+    return type2;
+  if (type2 == TYPE_UNKNOWN || type1 == type2)
+    return type1;
+
+  return TYPE_DYNAMIC;
+}
+
+//
+// binop_type
+//
+// The type of "lhs operator rhs", given the operand types.
+//
+static int binop_type(int lhs, int operator, int rhs)
+{
+  if (lhs == TYPE_UNKNOWN || rhs == TYPE_UNKNOWN)
+    return TYPE_UNKNOWN;
+
+  if (!is_numeric(lhs) || !is_numeric(rhs) || operator == OPERATOR_IS || operator == OPERATOR_IN)
+    return TYPE_DYNAMIC;
+
+  if (operator >= OPERATOR_EQUAL)
+    return RAM_TYPE_BOOLEAN;
+
+  if (lhs == RAM_TYPE_INT && rhs == RAM_TYPE_INT)
+    return RAM_TYPE_INT;
+
+  return RAM_TYPE_REAL;
+}
+
+//
+// infer_types
+//
+// The type of each value, if it always has the same one: the
+// constants' types, and what the operators make of them,
+// through phis until nothing changes.
+//
+static void infer_types(struct SSA_PROGRAM* program, int* types)
+{
+  for (int i = 0; i < program->num_instrs; i++) {
+    struct SSA_INSTR* instr = &program->instrs[i];
+
+    if (instr->op == SSA_CONST)
+      types[i] = unbox_type(instr->constant);
+    else if (instr->op == SSA_PHI || instr->op == SSA_BINOP)
+      types[i] = TYPE_UNKNOWN;
+    else
+      types[i] = TYPE_DYNAMIC;
+  }
+
+  bool changed = true;
+
+  while (changed) {
+    changed = false;
+
+    for (int i = 0; i < program->num_instrs; i++) {
+      struct SSA_INSTR* instr = &program->instrs[i];
+      int type = types[i];
+
+      if (instr->dead)
+        continue;
+
+      if (instr->op == SSA_BINOP)
+        type = binop_type(types[instr->args[0]], instr->operator, types[instr->args[1]]);
+      else if (instr->op == SSA_PHI)
+        for (int j = 0; j < program->blocks[instr->block].num_preds; j++)
+          type = meet(type, types[instr->phi_args[j]]);
+
+      if (type != types[i]) {
+        types[i] = type;
+        changed = true;
+      }
+    }
+  }
+
+  //
+  // what is still unknown only depends on itself (around a
+  // loop), which we don't try to sort out:
+  //
+  for (int i = 0; i < program->num_instrs; i++)
+    if (types[i] == TYPE_UNKNOWN)
+      types[i] = TYPE_DYNAMIC;
+}
+
+//
+// may_fault
+//
+// Can the given instruction stop the program with an error?
+// A binary operation on numbers can't, except int division
+// (by 0).
+//
+static bool may_fault(struct SSA_PROGRAM* program, int* types, int value)
+{
+  struct SSA_INSTR* instr = &program->instrs[value];
+
+  if (instr->op != SSA_BINOP)
+    return instr->op == SSA_CHECK || instr->op == SSA_PRINT || instr->op == SSA_CALL || instr->op == SSA_FAIL ||
+      instr->op == SSA_LOAD || instr->op == SSA_STORE || instr->op == SSA_ADDR ||
+      instr->op == SSA_DEREF || instr->op == SSA_STOREP || instr->op == SSA_APPEND;
+
+  int lhs = types[instr->args[0]];
+  int rhs = types[instr->args[1]];
+
+  if (!is_numeric(lhs) || !is_numeric(rhs) || instr->operator == OPERATOR_IS || instr->operator == OPERATOR_IN)
+    return true;
+
+  return lhs == RAM_TYPE_INT && rhs == RAM_TYPE_INT &&
+    (instr->operator == OPERATOR_DIV || instr->operator == OPERATOR_MOD);
+}
+
+//
+// drop_snapshots
+//
+// An instruction that can't fail doesn't need its snapshot.
+//
+static void drop_snapshots(struct SSA_PROGRAM* program, int* types)
+{
+  for (int i = 0; i < program->num_instrs; i++) {
+    struct SSA_INSTR* instr = &program->instrs[i];
+
+    if (!instr->dead && instr->op == SSA_BINOP && !may_fault(program, types, i)) {
+      free(instr->snapshot);
+      instr->snapshot = NULL;
+    }
+  }
+}
+
+//
+// same_constant
+//
+static bool same_constant(struct BOXED_VALUE a, struct BOXED_VALUE b)
+{
+  int type = unbox_type(a);
+
+  if (type != unbox_type(b))
+    return false;
+
+  switch (type) {
+  case RAM_TYPE_REAL:
+    {
+      double x = unbox_real(a);
+      double y = unbox_real(b);
+
+      return memcmp(&x, &y, sizeof(double)) == 0;
+    }
+
+  case RAM_TYPE_STR:
+    return strcmp(unbox_str(a), unbox_str(b)) == 0;
+
+  default:
+    return unbox_int(a) == unbox_int(b);
+  }
+}
+
+//
+// same_computation
+//
+// Do the given instructions compute the same value (or check
+// the same thing)?
+//
+static bool same_computation(struct SSA_INSTR* a, struct SSA_INSTR* b)
+{
+  if (a->op != b->op)
+    return false;
+
+  switch (a->op) {
+  case SSA_CONST:
+    return same_constant(a->constant, b->constant);
+
+  case SSA_BINOP:
+    return a->operator == b->operator && a->args[0] == b->args[0] && a->args[1] == b->args[1];
+
+  default:
+    assert(a->op == SSA_CHECK);
+    return a->args[0] == b->args[0];
+  }
+}
+
+//
+// eliminate_common
+//
+// A constant, binary operation, or check that repeats one in
+// a block that dominates it (or earlier in the same block) is
+// removed, and its uses use the first one's value. When the
+// variables live in memory, only operations on numbers count,
+// since other values are gone at the end of their statement.
+//
+static void eliminate_common(struct SSA_PROGRAM* program, int* forward, int* types)
+{
+  //
+  // candidates, in the order the blocks are executed (so a
+  // dominating block's instructions come first):
+  //
+  int* candidates = new_array(program->num_instrs, -1);
+  int num_candidates = 0;
+
+  for (int i = 0; i < program->num_order; i++) {
+    struct SSA_BLOCK* block = &program->blocks[program->order[i]];
+
+    for (int j = 0; j < block->num_instrs; j++) {
+      int value = block->instrs[j];
+      struct SSA_INSTR* instr = &program->instrs[value];
+
+      if (instr->op != SSA_CONST && instr->op != SSA_BINOP && instr->op != SSA_CHECK)
+        continue;
+
+      if (instr->op == SSA_BINOP && program->in_memory &&
+        (!is_numeric(types[instr->args[0]]) || !is_numeric(types[instr->args[1]])))
+      {
+        continue;
+      }
+
+      int k;
+
+      for (k = 0; k < num_candidates; k++) {
+        struct SSA_INSTR* first = &program->instrs[candidates[k]];
+
+        if (same_computation(first, instr) && dominates(program, first->block, instr->block))
+          break;
+      }
+
+      if (k < num_candidates) {
+        kill(program, forward, value, candidates[k]);
+        program->stats.common++;
+      }
+      else {
+        candidates[num_candidates++] = value;
+      }
+    }
+  }
+
+  free(candidates);
+
+  cleanup(program, forward);
+}
+
+//
+// insert_before_end
+//
+// Moves the given instruction to the end of the given block,
+// before its jump.
+//
+static void insert_before_end(struct SSA_PROGRAM* program, int value, int b)
+{
+  struct SSA_INSTR* instr = &program->instrs[value];
+  struct SSA_BLOCK* from = &program->blocks[instr->block];
+
+  for (int i = 0; i < from->num_instrs; i++)
+    if (from->instrs[i] == value) {
+      memmove(&from->instrs[i], &from->instrs[i + 1], sizeof(int) * (from->num_instrs - i - 1));
+      from->num_instrs--;
+      break;
+    }
+
+  struct SSA_BLOCK* to = &program->blocks[b];
+
+  to->instrs = (int*)grow(to->instrs, to->num_instrs, &to->instr_capacity, sizeof(int));
+
+  to->instrs[to->num_instrs] = to->instrs[to->num_instrs - 1];  // the jump
+  to->instrs[to->num_instrs - 1] = value;
+  to->num_instrs++;
+
+  instr->block = b;
+}
+
+//
+// hoist_invariants
+//
+// A constant, or an operation that can't fail whose operands
+// are computed outside a loop, is computed once before the
+// loop (in its preheader) instead of on every iteration. The
+// loop's body is every block that reaches the back edges to
+// its header without going through the header. Inner loops
+// come first, so an invariant can move out of several loops.
+//
+static void hoist_invariants(struct SSA_PROGRAM* program, int* types)
+{
+  int n = program->num_blocks;
+  int* headers = new_array(n, -1);
+  int* sizes = new_array(n, 0);
+  int num_loops = 0;
+
+  bool** bodies = (bool**)malloc(sizeof(bool*) * n);
+  int* worklist = new_array(n, -1);
+
+  if (bodies == NULL)
+    panic("out of memory (ssa_compile)");
+
+  for (int h = 0; h < n; h++) {
+    struct SSA_BLOCK* header = &program->blocks[h];
+
+    bodies[h] = NULL;
+
+    if (header->preheader < 0 || header->idom < 0)
+      continue;  // not a loop, or unreachable
+
+    bool* body = (bool*)calloc(n, sizeof(bool));
+
+    if (body == NULL)
+      panic("out of memory (ssa_compile)");
+
+    body[h] = true;
+    sizes[h] = 1;
+
+    int count = 0;
+
+    for (int i = 0; i < header->num_preds; i++)
+      if (header->preds[i] != header->preheader && !body[header->preds[i]]) {
+        body[header->preds[i]] = true;
+        worklist[count++] = header->preds[i];
+      }
+
+    while (count > 0) {
+      struct SSA_BLOCK* block = &program->blocks[worklist[--count]];
+
+      sizes[h]++;
+
+      for (int i = 0; i < block->num_preds; i++)
+        if (!body[block->preds[i]]) {
+          body[block->preds[i]] = true;
+          worklist[count++] = block->preds[i];
+        }
+    }
+
+    bodies[h] = body;
+    headers[num_loops++] = h;
+  }
+
+  //
+  // inner loops first (an inner loop is smaller than the loop
+  // it's in):
+  //
+  for (int i = 1; i < num_loops; i++)
+    for (int j = i; j > 0 && sizes[headers[j]] < sizes[headers[j - 1]]; j--) {
+      int temp = headers[j];
+      headers[j] = headers[j - 1];
+      headers[j - 1] = temp;
+    }
+
+  for (int l = 0; l < num_loops; l++) {
+    int h = headers[l];
+    bool* body = bodies[h];
+    int preheader = program->blocks[h].preheader;
+
+    for (int i = 0; i < program->num_order; i++) {
+      int b = program->order[i];
+
+      if (!body[b])
+        continue;
+
+      struct SSA_BLOCK* block = &program->blocks[b];
+
+      for (int j = 0; j < block->num_instrs; j++) {
+        int value = block->instrs[j];
+        struct SSA_INSTR* instr = &program->instrs[value];
+
+        bool invariant = (instr->op == SSA_CONST) ||
+          (instr->op == SSA_BINOP && !may_fault(program, types, value) &&
+            !body[program->instrs[instr->args[0]].block] &&
+            !body[program->instrs[instr->args[1]].block]);
+
+        if (invariant) {
+          insert_before_end(program, value, preheader);
+          program->stats.hoisted++;
+          j--;
+        }
+      }
+    }
+  }
+
+  for (int i = 0; i < n; i++)
+    free(bodies[i]);
+
+  free(bodies);
+  free(headers);
+  free(sizes);
+  free(worklist);
+}
+
+//
+// remove_dead
+//
+// Removes the values nothing uses: starting from what the
+// program does (prints, stores, branches, errors, and the
+// values the variables have when it stops), mark the values
+// each one uses; the rest are dead. In particular, a value
+// assigned to a variable that is overwritten before it is
+// read is dead. When the variables live in memory every store
+// stays, since a pointer can read any variable.
+//
+static void remove_dead(struct SSA_PROGRAM* program, int* forward, int* types)
+{
+  bool* live = (bool*)calloc(program->num_instrs, sizeof(bool));
+  int* worklist = new_array(program->num_instrs, -1);
+  int count = 0;
+
+  if (live == NULL)
+    panic("out of memory (ssa_compile)");
+
+  for (int i = 0; i < program->num_instrs; i++) {
+    struct SSA_INSTR* instr = &program->instrs[i];
+
+    if (instr->dead)
+      continue;
+
+    bool root = (instr->op != SSA_CONST && instr->op != SSA_ENTRY && instr->op != SSA_PHI &&
+      instr->op != SSA_COPY && instr->op != SSA_BINOP) || may_fault(program, types, i);
+
+    if (root) {
+      live[i] = true;
+      worklist[count++] = i;
+    }
+  }
+
+  while (count > 0) {
+    struct SSA_INSTR* instr = &program->instrs[worklist[--count]];
+    int num_uses = 2;
+
+    if (instr->phi_args != NULL)
+      num_uses += program->blocks[instr->block].num_preds;
+    if (instr->snapshot != NULL)
+      num_uses += program->num_vars;
+
+    for (int i = 0; i < num_uses; i++) {
+      int use;
+
+      if (i < 2)
+        use = instr->args[i];
+      else if (instr->phi_args != NULL && i - 2 < program->blocks[instr->block].num_preds)
+        use = instr->phi_args[i - 2];
+      else
+        use = instr->snapshot[i - 2 - (instr->phi_args != NULL ? program->blocks[instr->block].num_preds : 0)];
+
+      //
+      // a define's arg isn't a use, see remove_checks:
+      //
+      if (instr->op == SSA_DEFINE || use < 0 || live[use])
+        continue;
+
+      live[use] = true;
+      worklist[count++] = use;
+    }
+  }
+
+  for (int i = 0; i < program->num_instrs; i++)
+    if (!program->instrs[i].dead && !live[i]) {
+      kill(program, forward, i, -1);
+      program->stats.dead++;
+    }
+
+  //
+  // a variable's ENTRY is gone if its value isn't needed:
+  //
+  for (int i = 0; i < program->num_vars; i++)
+    if (program->entries[i] >= 0 && program->instrs[program->entries[i]].dead)
+      program->entries[i] = -1;
+
+  free(live);
+  free(worklist);
+
+  cleanup(program, forward);
+}
+
+//
+// optimize
+//
+static void optimize(struct SSA_PROGRAM* program)
+{
+  int* forward = new_array(program->num_instrs, -1);
+  int* types = new_array(program->num_instrs, TYPE_UNKNOWN);
+  int* rpo = new_array(program->num_blocks, -1);
+
+  propagate_copies(program, forward);
+  remove_trivial_phis(program, forward);
+  remove_checks(program, forward);
+
+  compute_dominators(program, rpo);
+  infer_types(program, types);
+  drop_snapshots(program, types);
+
+  eliminate_common(program, forward, types);
+  hoist_invariants(program, types);
+  remove_dead(program, forward, types);
+
+  free(forward);
+  free(types);
+  free(rpo);
+}
+
+
+//
+// Lowering to the executable form:
+//
+
+//
+// new_code
+//
+// Adds an instruction to the executable form, and returns it.
+//
+static struct SSA_CODE* new_code(struct SSA_PROGRAM* program, int op, int line)
+{
+  program->code = (struct SSA_CODE*)grow(program->code, program->num_code,
+    &program->code_capacity, sizeof(struct SSA_CODE));
+
+  struct SSA_CODE* code = &program->code[program->num_code++];
+
+  memset(code, 0, sizeof(struct SSA_CODE));
+  code->op = op;
+  code->line = line;
+  code->dest = -1;
+  code->a = -1;
+  code->b = -1;
+  code->var = -1;
+  code->operator = OPERATOR_NO_OP;
+  code->targets[0] = -1;
+  code->targets[1] = -1;
+  code->constant = box_none();
+
+  return code;
+}
+
+//
+// num_moves
+//
+// The # of moves needed on the edge from -> to: to's phis take
+// their values from the from block.
+//
+static int num_moves(struct SSA_PROGRAM* program, int from, int to)
+{
+  struct SSA_BLOCK* block = &program->blocks[to];
+  int pred = 0;
+  int count = 0;
+
+  while (block->preds[pred] != from)
+    pred++;
+
+  for (int i = 0; i < block->num_phis; i++) {
+    int phi = block->instrs[i];
+
+    if (program->instrs[program->instrs[phi].phi_args[pred]].reg != phi)
+      count++;
+  }
+
+  return count;
+}
+
+//
+// lower_moves
+//
+// The moves on the edge from -> to. They happen at the same
+// time, so if one reads a phi another writes, they go through
+// temporary registers (after the values' registers).
+//
+static void lower_moves(struct SSA_PROGRAM* program, int from, int to)
+{
+  struct SSA_BLOCK* block = &program->blocks[to];
+  int pred = 0;
+  bool temps = false;
+
+  while (block->preds[pred] != from)
+    pred++;
+
+  for (int i = 0; i < block->num_phis; i++) {
+    int reg = program->instrs[program->instrs[block->instrs[i]].phi_args[pred]].reg;
+
+    if (reg != block->instrs[i] && program->instrs[reg].op == SSA_PHI && program->instrs[reg].block == to)
+      temps = true;
+  }
+
+  int temp = program->num_instrs;
+
+  for (int i = 0; i < block->num_phis; i++) {
+    int phi = block->instrs[i];
+    int reg = program->instrs[program->instrs[phi].phi_args[pred]].reg;
+
+    if (reg == phi)
+      continue;
+
+    struct SSA_CODE* code = new_code(program, SSA_MOVE, 0);
+
+    code->dest = temps ? temp++ : phi;
+    code->a = reg;
+  }
+
+  if (!temps)
+    return;
+
+  if (temp > program->num_registers)
+    program->num_registers = temp;
+
+  temp = program->num_instrs;
+
+  for (int i = 0; i < block->num_phis; i++) {
+    int phi = block->instrs[i];
+
+    if (program->instrs[program->instrs[phi].phi_args[pred]].reg == phi)
+      continue;
+
+    struct SSA_CODE* code = new_code(program, SSA_MOVE, 0);
+
+    code->dest = phi;
+    code->a = temp++;
+  }
+}
+
+//
+// reads
+//
+// Does the given instruction read the given value (as an
+// operand, or in its snapshot)?
+//
+static bool reads(struct SSA_PROGRAM* program, struct SSA_INSTR* instr, int value)
+{
+  if (instr->args[0] == value || instr->args[1] == value)
+    return true;
+
+  if (instr->snapshot != NULL)
+    for (int i = 0; i < program->num_vars; i++)
+      if (instr->snapshot[i] == value)
+        return true;
+
+  return false;
+}
+
+//
+// coalesce
+//
+// The value a loop assigns to a variable ("i = i + 1") is
+// usually only used by the phi at the top of the loop, so
+// it's computed right into the phi's register, and the move
+// at the end of the loop goes away. That's safe if the value
+// is computed in the block that jumps to the phi, and nothing
+// after it in the block still needs the phi's value.
+//
+static void coalesce(struct SSA_PROGRAM* program)
+{
+  int* uses = new_array(program->num_instrs, 0);
+
+  for (int i = 0; i < program->num_instrs; i++) {
+    struct SSA_INSTR* instr = &program->instrs[i];
+
+    if (instr->dead)
+      continue;
+
+    for (int k = 0; k < 2; k++)
+      if (instr->args[k] >= 0)
+        uses[instr->args[k]]++;
+
+    if (instr->phi_args != NULL)
+      for (int k = 0; k < program->blocks[instr->block].num_preds; k++)
+        uses[instr->phi_args[k]]++;
+
+    if (instr->snapshot != NULL)
+      for (int k = 0; k < program->num_vars; k++)
+        if (instr->snapshot[k] >= 0)
+          uses[instr->snapshot[k]]++;
+  }
+
+  for (int s = 0; s < program->num_blocks; s++) {
+    struct SSA_BLOCK* block = &program->blocks[s];
+
+    for (int p = 0; p < block->num_preds; p++) {
+      struct SSA_BLOCK* pred = &program->blocks[block->preds[p]];
+
+      if (pred->num_succs != 1)
+        continue;
+
+      for (int i = 0; i < block->num_phis; i++) {
+        int phi = block->instrs[i];
+        int value = program->instrs[phi].phi_args[p];
+        struct SSA_INSTR* instr = &program->instrs[value];
+
+        if ((instr->op != SSA_BINOP && instr->op != SSA_CONST) ||
+          instr->block != block->preds[p] || uses[value] != 1)
+        {
+          continue;
+        }
+
+        bool safe = true;
+        int j = 0;
+
+        while (pred->instrs[j] != value)
+          j++;
+
+        for (j++; j < pred->num_instrs && safe; j++)
+          if (reads(program, &program->instrs[pred->instrs[j]], phi))
+            safe = false;
+
+        for (int k = 0; k < block->num_phis && safe; k++)
+          if (program->instrs[block->instrs[k]].phi_args[p] == phi)
+            safe = false;
+
+        if (safe)
+          instr->reg = phi;
+      }
+    }
+  }
+
+  free(uses);
+}
+
+//
+// lower
+//
+// Lays the blocks out in reverse postorder, as instructions
+// reading and writing registers (one per value). Phis become
+// moves on the edges into their block; a branch whose target
+// needs moves goes to a stub that does them, placed after the
+// code. Jump targets are block #s until the layout is known;
+// a branch to a stub is -2 - the stub's pc.
+//
+static void lower(struct SSA_PROGRAM* program)
+{
+  int* block_pc = new_array(program->num_blocks, -1);
+  struct SSA_STUB* stubs = (struct SSA_STUB*)malloc(sizeof(struct SSA_STUB) * 2 * (program->num_blocks + 1));
+  int num_stubs = 0;
+
+  if (stubs == NULL)
+    panic("out of memory (ssa_compile)");
+
+  program->num_registers = program->num_instrs;
+
+  coalesce(program);
+
+  for (int i = 0; i < program->num_order; i++) {
+    int b = program->order[i];
+    struct SSA_BLOCK* block = &program->blocks[b];
+    int next = (i + 1 < program->num_order) ? program->order[i + 1] : -1;
+
+    block_pc[b] = program->num_code;
+
+    for (int j = block->num_phis; j < block->num_instrs; j++) {
+      int value = block->instrs[j];
+      struct SSA_INSTR* instr = &program->instrs[value];
+
+      if (instr->op == SSA_JUMP) {
+        lower_moves(program, b, instr->targets[0]);
+
+        if (instr->targets[0] != next)
+          new_code(program, SSA_JUMP, 0)->targets[0] = instr->targets[0];
+        continue;
+      }
+
+      struct SSA_CODE* code = new_code(program, instr->op, instr->line);
+
+      code->var = instr->var;
+      code->operator = instr->operator;
+      code->constant = instr->constant;
+      code->snapshot = instr->snapshot;
+
+      int reg_a = (instr->args[0] >= 0) ? program->instrs[instr->args[0]].reg : -1;
+      int reg_b = (instr->args[1] >= 0) ? program->instrs[instr->args[1]].reg : -1;
+
+      switch (instr->op) {
+      case SSA_CONST:
+      case SSA_ENTRY:
+      case SSA_LOAD:
+      case SSA_ADDR:
+        code->dest = instr->reg;
+        code->own = (instr->op == SSA_LOAD) && !program->in_memory;
+        break;
+
+      case SSA_COPY:
+      case SSA_DEREF:
+        code->op = (instr->op == SSA_COPY) ? SSA_MOVE : SSA_DEREF;
+        code->dest = instr->reg;
+        code->a = reg_a;
+        code->own = (instr->op == SSA_DEREF) && !program->in_memory;
+        break;
+
+      case SSA_BINOP:
+      case SSA_CALL:
+        code->dest = instr->reg;
+        code->a = reg_a;
+        code->b = reg_b;
+        code->own = !program->in_memory;
+        break;
+
+      case SSA_BRANCH:
+        code->a = reg_a;
+        code->reset = program->in_memory;
+
+        for (int k = 0; k < 2; k++) {
+          code->targets[k] = instr->targets[k];
+
+          if (num_moves(program, b, instr->targets[k]) > 0) {
+            stubs[num_stubs].pc = program->num_code - 1;
+            stubs[num_stubs].target = k;
+            stubs[num_stubs].from = b;
+            stubs[num_stubs].to = instr->targets[k];
+            num_stubs++;
+          }
+        }
+        break;
+
+      default:
+        code->a = reg_a;
+        code->b = reg_b;
+        code->reset = program->in_memory &&
+          (instr->op == SSA_STORE || instr->op == SSA_STOREP || instr->op == SSA_APPEND ||
+            instr->op == SSA_PRINT);
+        break;
+      }
+    }
+  }
+
+  //
+  // the stubs, each doing the moves and jumping to the target
+  // block:
+  //
+  for (int i = 0; i < num_stubs; i++) {
+    struct SSA_STUB* stub = &stubs[i];
+
+    program->code[stub->pc].targets[stub->target] = -2 - program->num_code;
+
+    lower_moves(program, stub->from, stub->to);
+    new_code(program, SSA_JUMP, 0)->targets[0] = stub->to;
+  }
+
+  //
+  // and now that the layout is known, the targets:
+  //
+  for (int pc = 0; pc < program->num_code; pc++) {
+    struct SSA_CODE* code = &program->code[pc];
+
+    if (code->op != SSA_JUMP && code->op != SSA_BRANCH)
+      continue;
+
+    for (int k = 0; k < 2; k++)
+      if (code->targets[k] >= 0)
+        code->targets[k] = block_pc[code->targets[k]];
+      else if (code->targets[k] <= -2)
+        code->targets[k] = -2 - code->targets[k];
+  }
+
+  free(block_pc);
+  free(stubs);
+}
+
+
+//
+// Execution:
+//
+
+//
+// release
+//
+// Frees the register's string, if it owns one.
+//
+static inline void release(struct SSA_REGISTER* reg)
+{
+  if (reg->owned) {
+    quota_release(reg->capacity);
+    free(unbox_str(reg->value));
+    reg->owned = false;
+  }
+}
+
+//
+// set_register
+//
+// Sets the register to the given value; if owned, the value
+// is a string the register should have its own copy of.
+//
+static inline void set_register(struct SSA_REGISTER* reg, struct BOXED_VALUE value, bool owned)
+{
+  release(reg);
+
+  if (owned) {
+    char* s = unbox_str(value);
+    size_t size = strlen(s) + 1;
+    char* copy = (char*)malloc(size);
+
+    if (copy == NULL)
+      panic("out of memory (ssa_execute)");
+
+    quota_charge(size);
+    memcpy(copy, s, size);
+
+    value = box_str(copy);
+    reg->length = size - 1;
+    reg->capacity = size;
+  }
+
+  reg->value = value;
+  reg->owned = owned;
+  reg->defined = true;
+}
+
+//
+// append
+//
+// Appends the string to the one the register owns, in place:
+// the register's buffer grows by doubling, so a loop that
+// builds a string with "s = s + t" takes linear time (see
+// runtime_append, which does the same for memory). Returns
+// RUNTIME_OK or RUNTIME_OUT_OF_QUOTA.
+//
+static int append(struct SSA_REGISTER* reg, char* rhs)
+{
+  assert(reg->owned && unbox_str(reg->value) != rhs);
+
+  size_t rhs_length = strlen(rhs);
+  size_t needed = reg->length + rhs_length + 1;
+  char* s = unbox_str(reg->value);
+
+  if (needed > reg->capacity) {
+    size_t capacity = reg->capacity < 16 ? 16 : reg->capacity;
+
+    while (capacity < needed)
+      capacity *= 2;
+
+    if (!quota_charge(capacity - reg->capacity)) {
+      //
+      // no room to double, is there room for the string?
+      //
+      capacity = needed;
+
+      if (!quota_charge(capacity - reg->capacity))
+        return RUNTIME_OUT_OF_QUOTA;
+    }
+
+    s = (char*)realloc(s, capacity);
+
+    if (s == NULL)
+      panic("out of memory (ssa_execute)");
+
+    reg->value = box_str(s);
+    reg->capacity = capacity;
+  }
+
+  memcpy(s + reg->length, rhs, rhs_length + 1);
+  reg->length += rhs_length;
+
+  return RUNTIME_OK;
+}
+
+//
+// truth
+//
+// Returns the truth value of the given condition value (read
+// in place, see run).
+//
+static inline bool truth(struct BOXED_VALUE* value)
+{
+  if (unbox_type(*value) == RAM_TYPE_BOOLEAN)
+    return unbox_int(*value) != 0;
+
+  return runtime_is_true(*value);
+}
+
+//
+// write_back
+//
+// The program has stopped: writes each variable's value (as
+// given by the snapshot) to memory, unless the variable lives
+// there, or still has its value from when the program started.
+//
+static void write_back(struct SSA_PROGRAM* program, struct SSA_REGISTER* registers,
+  int* snapshot, struct RAM* memory)
+{
+  if (snapshot == NULL)
+    return;
+
+  for (int i = 0; i < program->num_vars; i++) {
+    int value = snapshot[i];
+
+    if (value < 0 || value == program->entries[i] || !registers[value].defined)
+      continue;
+
+    runtime_store(memory, &program->vars[i], registers[value].value);
+  }
+}
+
+//
+// run
+//
+// Executes the code until it ends, or an error occurs.
+//
+static void run(struct SSA_PROGRAM* program, struct SSA_REGISTER* registers,
+  struct RAM* memory, struct ARENA* scratch)
+{
+#if SSA_THREADED
+  static void* dispatch[SSA_NUM_OPS] = {
+#define SSA_LABEL_ADDR(op) &&op_##op,
+    SSA_OPCODES(SSA_LABEL_ADDR)
+#undef SSA_LABEL_ADDR
+  };
+
+#define SSA_CASE(op)    op_##op:
+#define SSA_NEXT()      goto *dispatch[ip->op]
+#define SSA_BEGIN()     SSA_NEXT();
+#define SSA_END()
+#else
+#define SSA_CASE(op)    case SSA_##op:
+#define SSA_NEXT()      continue
+#define SSA_BEGIN()     for (;;) switch (ip->op) {
+#define SSA_END()       }
+#endif
+
+//
+// the end of a statement when the variables live in memory
+// (the only time the scratch arena holds on to anything):
+//
+#define SSA_RESET()                                                 \
+  do {                                                              \
+    if (ip->reset && scratch->used > 0)                             \
+      arena_reset(scratch);                                         \
+  } while (0)
+
+  struct RUNTIME_VAR* vars = program->vars;
+  struct SSA_CODE* code = program->code;
+  struct SSA_CODE* ip = code;
+
+  int   status = RUNTIME_OK;
+  char* var_name = NULL;
+
+  SSA_BEGIN()
+
+  SSA_CASE(CONST)
+  {
+    set_register(&registers[ip->dest], ip->constant, false);
+
+    ip++;
+    SSA_NEXT();
+  }
+
+  SSA_CASE(ENTRY)
+  {
+    int address = runtime_lookup(memory, &vars[ip->var]);
+
+    if (address < 0) {
+      release(&registers[ip->dest]);
+      registers[ip->dest].defined = false;
+    }
+    else {
+      struct BOXED_VALUE value = runtime_read_cell(memory, address);
+
+      set_register(&registers[ip->dest], value, unbox_type(value) == RAM_TYPE_STR);
+    }
+
+    ip++;
+    SSA_NEXT();
+  }
+
+  SSA_CASE(MOVE)
+  {
+    struct SSA_REGISTER* from = &registers[ip->a];
+
+    if (from->defined) {
+      set_register(&registers[ip->dest], from->value, from->owned);
+    }
+    else {
+      release(&registers[ip->dest]);
+      registers[ip->dest].defined = false;
+    }
+
+    ip++;
+    SSA_NEXT();
+  }
+
+  SSA_CASE(BINOP)
+  {
+    struct BOXED_VALUE* a = &registers[ip->a].value;
+    struct BOXED_VALUE* b = &registers[ip->b].value;
+    struct BOXED_VALUE lhs;
+
+    if (unbox_type(*a) == RAM_TYPE_INT && unbox_type(*b) == RAM_TYPE_INT) {
+      int x = unbox_int(*a);
+      int y = unbox_int(*b);
+      struct SSA_REGISTER* dest = &registers[ip->dest];
+      bool done = true;
+
+      release(dest);
+
+      //
+      // the result goes straight into the register (building it
+      // in a temporary first costs a store-forwarding stall).
+      // + - * wrap around, see RUNTIME_WRAP:
+      //
+      switch (ip->operator) {
+      case OPERATOR_PLUS:      dest->value = box_int(RUNTIME_WRAP(x, +, y)); break;
+      case OPERATOR_MINUS:     dest->value = box_int(RUNTIME_WRAP(x, -, y)); break;
+      case OPERATOR_ASTERISK:  dest->value = box_int(RUNTIME_WRAP(x, *, y)); break;
+      case OPERATOR_EQUAL:     dest->value = box_bool(x == y); break;
+      case OPERATOR_NOT_EQUAL: dest->value = box_bool(x != y); break;
+      case OPERATOR_LT:        dest->value = box_bool(x < y); break;
+      case OPERATOR_LTE:       dest->value = box_bool(x <= y); break;
+      case OPERATOR_GT:        dest->value = box_bool(x > y); break;
+      case OPERATOR_GTE:       dest->value = box_bool(x >= y); break;
+      default:                 done = false; break;
+      }
+
+      if (done) {
+        dest->defined = true;
+
+        ip++;
+        SSA_NEXT();
+      }
+    }
+
+    //
+    // "s = s + t" in a loop computes s + t right into s's
+    // register (see coalesce); if the register owns s, t is
+    // appended in place:
+    //
+    if (ip->operator == OPERATOR_PLUS && ip->dest == ip->a && ip->b != ip->a &&
+      registers[ip->a].owned && unbox_type(*b) == RAM_TYPE_STR)
+    {
+      status = append(&registers[ip->a], unbox_str(*b));
+
+      if (status != RUNTIME_OK)
+        goto failed;
+
+      ip++;
+      SSA_NEXT();
+    }
+
+    lhs = *a;
+
+    struct BOXED_VALUE rhs = *b;
+
+    status = runtime_binary_op(scratch, &lhs, ip->operator, &rhs);
+
+    if (status != RUNTIME_OK)
+      goto failed;
+
+    //
+    // a string result is in the scratch arena, which only
+    // lasts until the end of the statement:
+    //
+    bool owned = ip->own && unbox_type(lhs) == RAM_TYPE_STR;
+
+    set_register(&registers[ip->dest], lhs, owned);
+
+    if (owned)
+      arena_reset(scratch);
+
+    ip++;
+    SSA_NEXT();
+  }
+
+  SSA_CASE(CHECK)
+  {
+    if (!registers[ip->a].defined) {
+      status = RUNTIME_UNDEFINED;
+      var_name = vars[ip->var].name;
+      goto failed;
+    }
+
+    ip++;
+    SSA_NEXT();
+  }
+
+  SSA_CASE(DEFINE)
+  {
+    if (runtime_lookup(memory, &vars[ip->var]) < 0) {
+      status = runtime_store(memory, &vars[ip->var], box_none());
+
+      if (status != RUNTIME_OK) {
+        var_name = vars[ip->var].name;
+        goto failed;
+      }
+    }
+
+    ip++;
+    SSA_NEXT();
+  }
+
+  SSA_CASE(LOAD)
+  SSA_CASE(ADDR)
+  {
+    int address = runtime_lookup(memory, &vars[ip->var]);
+
+    if (address < 0) {
+      status = RUNTIME_UNDEFINED;
+      var_name = vars[ip->var].name;
+      goto failed;
+    }
+
+    if (ip->op == SSA_LOAD) {
+      struct BOXED_VALUE value = runtime_read_cell(memory, address);
+
+      set_register(&registers[ip->dest], value, ip->own && unbox_type(value) == RAM_TYPE_STR);
+    }
+    else
+      set_register(&registers[ip->dest], box_ptr(address), false);
+
+    ip++;
+    SSA_NEXT();
+  }
+
+  SSA_CASE(STORE)
+  {
+    status = runtime_store(memory, &vars[ip->var], registers[ip->a].value);
+
+    SSA_RESET();
+
+    if (status != RUNTIME_OK) {
+      var_name = vars[ip->var].name;
+      goto failed;
+    }
+
+    ip++;
+    SSA_NEXT();
+  }
+
+  SSA_CASE(DEREF)
+  SSA_CASE(STOREP)
+  {
+    struct BOXED_VALUE ptr = registers[ip->a].value;
+
+    status = runtime_check_ptr(memory, ptr);
+
+    if (status == RUNTIME_OK) {
+      if (ip->op == SSA_DEREF) {
+        struct BOXED_VALUE value = runtime_read_cell(memory, unbox_int(ptr));
+
+        set_register(&registers[ip->dest], value, ip->own && unbox_type(value) == RAM_TYPE_STR);
+      }
+      else
+        status = runtime_write_cell_by_addr(memory, registers[ip->b].value, unbox_int(ptr));
+    }
+
+    SSA_RESET();
+
+    if (status != RUNTIME_OK) {
+      var_name = vars[ip->var].name;
+      goto failed;
+    }
+
+    ip++;
+    SSA_NEXT();
+  }
+
+  SSA_CASE(APPEND)
+  {
+    //
+    // x = x + e, where x lives in memory: a string is appended
+    // to x's cell in place (see runtime_append), anything else
+    // is added and written back, as execute() does:
+    //
+    int address = unbox_int(registers[ip->a].value);
+
+    struct BOXED_VALUE value = runtime_read_cell(memory, address);
+
+    struct BOXED_VALUE rhs = registers[ip->b].value;
+
+    if (unbox_type(value) == RAM_TYPE_STR &&
+      unbox_type(rhs) == RAM_TYPE_STR &&
+      unbox_str(rhs) != unbox_str(value))  // not s = s + s
+    {
+      status = runtime_append(memory, address, unbox_str(rhs));
+    }
+    else {
+      status = runtime_binary_op(scratch, &value, OPERATOR_PLUS, &rhs);
+
+      if (status == RUNTIME_OK) {
+        status = runtime_write_cell_by_addr(memory, value, address);
+
+        if (status != RUNTIME_OK)
+          var_name = vars[ip->var].name;
+      }
+    }
+
+    SSA_RESET();
+
+    if (status != RUNTIME_OK)
+      goto failed;
+
+    ip++;
+    SSA_NEXT();
+  }
+
+  SSA_CASE(PRINT)
+  {
+    if (ip->a < 0)
+      output_char('\n');
+    else
+      status = runtime_print(registers[ip->a].value);
+
+    SSA_RESET();
+
+    if (status != RUNTIME_OK)
+      goto failed;
+
+    ip++;
+    SSA_NEXT();
+  }
+
+  SSA_CASE(CALL)
+  {
+    struct BUILTIN* builtin = builtin_get(ip->operator);
+    struct BOXED_VALUE args[BUILTIN_MAX_ARGS];
+    struct BOXED_VALUE result;
+    int num_args = 0;
+
+    if (ip->a >= 0)
+      args[num_args++] = registers[ip->a].value;
+
+    status = builtin_call(builtin, scratch, args, num_args, &result);
+
+    if (status != RUNTIME_OK) {
+      var_name = builtin->name;
+      goto failed;
+    }
+
+    struct SSA_REGISTER* dest = &registers[ip->dest];
+    bool owned = ip->own && unbox_type(result) == RAM_TYPE_STR;
+
+    //
+    // a string result is in the scratch arena, or is the
+    // argument (str of a string), which may be the string this
+    // very register owns:
+    //
+    if (owned && dest->owned && unbox_str(result) == unbox_str(dest->value)) {
+      ip++;
+      SSA_NEXT();
+    }
+
+    set_register(dest, result, owned);
+
+    if (owned && scratch->used > 0)
+      arena_reset(scratch);
+
+    ip++;
+    SSA_NEXT();
+  }
+
+  SSA_CASE(FAIL)
+  {
+    status = ip->operator;
+
+    if (unbox_type(ip->constant) == RAM_TYPE_STR)
+      var_name = unbox_str(ip->constant);
+
+    goto failed;
+  }
+
+  SSA_CASE(JUMP)
+  {
+    ip = code + ip->targets[0];
+    SSA_NEXT();
+  }
+
+  SSA_CASE(BRANCH)
+  {
+    bool condition = truth(&registers[ip->a].value);
+
+    SSA_RESET();
+
+    ip = code + (condition ? ip->targets[0] : ip->targets[1]);
+    SSA_NEXT();
+  }
+
+  SSA_CASE(RETURN)
+  {
+    write_back(program, registers, ip->snapshot, memory);
+    return;
+  }
+
+  //
+  // never in the executable form:
+  //
+  SSA_CASE(PHI)
+  SSA_CASE(COPY)
+  {
+    panic("unexpected instruction (ssa_execute)");
+  }
+
+  SSA_END()
+
+failed:
+  runtime_report(status, var_name, ip->line);
+  write_back(program, registers, ip->snapshot, memory);
+
+#undef SSA_RESET
+#undef SSA_END
+#undef SSA_BEGIN
+#undef SSA_NEXT
+#undef SSA_CASE
+}
+
+//
+// Public functions:
+//
+
+//
+// ssa_compile
+//
+struct SSA_PROGRAM* ssa_compile(struct STMT* program)
+{
+  struct SSA_PROGRAM* compiled = (struct SSA_PROGRAM*)malloc(sizeof(struct SSA_PROGRAM));
+  if (compiled == NULL)
+    panic("out of memory (ssa_compile)");
+
+  memset(compiled, 0, sizeof(struct SSA_PROGRAM));
+
+  build(compiled, program);
+  optimize(compiled);
+  lower(compiled);
+
+  return compiled;
+}
+
+//
+// ssa_execute
+//
+void ssa_execute(struct SSA_PROGRAM* program, struct RAM* memory)
+{
+  //
+  // addresses depend on the memory, so look them up again:
+  //
+  for (int i = 0; i < program->num_vars; i++)
+    program->vars[i].address = -1;
+
+  //
+  // start accounting from what memory holds now:
+  //
+  runtime_begin(memory);
+
+  struct SSA_REGISTER* registers =
+    (struct SSA_REGISTER*)calloc(program->num_registers + 1, sizeof(struct SSA_REGISTER));
+
+  if (registers == NULL)
+    panic("out of memory (ssa_execute)");
+
+  struct ARENA* scratch = arena_create(SCRATCH_ARENA_SIZE);
+
+  if (program->num_code > 0)
+    run(program, registers, memory, scratch);
+
+  for (int i = 0; i < program->num_registers; i++)
+    release(&registers[i]);
+
+  free(registers);
+  arena_destroy(scratch);
+
+  runtime_end();
+}
+
+//
+// print_value
+//
+static void print_value(int value)
+{
+  if (value < 0)
+    printf(" -");
+  else
+    printf(" v%d", value);
+}
+
+//
+// ssa_print
+//
+void ssa_print(struct SSA_PROGRAM* program)
+{
+  if (program == NULL)
+    panic("program ptr is null (ssa_print)");
+
+  struct SSA_STATS* stats = &program->stats;
+
+  if (program->in_memory)
+    printf("**SSA (variables in memory)**\n");
+  else {
+    printf("**SSA (variables in registers");
+
+    int num_in_memory = 0;
+
+    for (int i = 0; i < program->num_vars; i++)
+      if (program->var_in_memory[i])
+        printf("%s%s", (num_in_memory++ == 0) ? ", except " : ", ", program->vars[i].name);
+
+    printf("%s)**\n", (num_in_memory > 0) ? " in memory" : "");
+  }
+  printf("**%d copies propagated, %d trivial phis, %d checks removed, %d common subexpressions, %d hoisted, %d dead**\n",
+    stats->copies, stats->phis, stats->checks, stats->common, stats->hoisted, stats->dead);
+
+  for (int i = 0; i < program->num_order; i++) {
+    int b = program->order[i];
+    struct SSA_BLOCK* block = &program->blocks[b];
+
+    printf("b%d:", b);
+
+    if (block->num_preds > 0) {
+      printf(" preds");
+      for (int j = 0; j < block->num_preds; j++)
+        printf(" b%d", block->preds[j]);
+    }
+
+    if (block->preheader >= 0)
+      printf(" (loop, preheader b%d)", block->preheader);
+
+    printf("\n");
+
+    for (int j = 0; j < block->num_instrs; j++) {
+      int value = block->instrs[j];
+      struct SSA_INSTR* instr = &program->instrs[value];
+
+      if (instr->op == SSA_CONST || instr->op == SSA_ENTRY || instr->op == SSA_PHI ||
+        instr->op == SSA_COPY || instr->op == SSA_BINOP || instr->op == SSA_LOAD ||
+        instr->op == SSA_ADDR || instr->op == SSA_DEREF || instr->op == SSA_CALL)
+      {
+        printf("  v%d = %s", value, ssa_op_names[instr->op]);
+      }
+      else
+        printf("  %s", ssa_op_names[instr->op]);
+
+      switch (instr->op) {
+      case SSA_CONST:
+        {
+          struct BOXED_VALUE constant = instr->constant;
+
+          switch (unbox_type(constant)) {
+          case RAM_TYPE_INT:
+            printf(" %d", unbox_int(constant));
+            break;
+          case RAM_TYPE_REAL:
+            printf(" %lf", unbox_real(constant));
+            break;
+          case RAM_TYPE_STR:
+            printf(" '%s'", unbox_str(constant));
+            break;
+          default:
+            printf(" %s", unbox_int(constant) ? "True" : "False");
+            break;
+          }
+          break;
+        }
+
+      case SSA_PHI:
+        for (int k = 0; k < block->num_preds; k++)
+          printf(" [b%d: v%d]", block->preds[k], instr->phi_args[k]);
+        break;
+
+      case SSA_BINOP:
+        print_value(instr->args[0]);
+        printf(" %s", ssa_operator_names[instr->operator]);
+        print_value(instr->args[1]);
+        break;
+
+      case SSA_CALL:
+        printf(" %s", builtin_get(instr->operator)->name);
+        print_value(instr->args[0]);
+        break;
+
+      case SSA_FAIL:
+        printf(" %d", instr->operator);
+        if (unbox_type(instr->constant) == RAM_TYPE_STR)
+          printf(" %s", unbox_str(instr->constant));
+        break;
+
+      case SSA_JUMP:
+        printf(" b%d", instr->targets[0]);
+        break;
+
+      case SSA_BRANCH:
+        print_value(instr->args[0]);
+        printf(" b%d b%d", instr->targets[0], instr->targets[1]);
+        break;
+
+      default:
+        if (instr->args[0] >= 0)
+          print_value(instr->args[0]);
+        if (instr->args[1] >= 0)
+          print_value(instr->args[1]);
+        break;
+      }
+
+      if (instr->var >= 0)
+        printf(" %s", program->vars[instr->var].name);
+
+      if (instr->line > 0)
+        printf("  (line %d)", instr->line);
+
+      if (instr->op == SSA_RETURN && instr->snapshot != NULL) {
+        printf("  [");
+        for (int k = 0, n = 0; k < program->num_vars; k++)
+          if (instr->snapshot[k] >= 0)
+            printf("%s%s=v%d", (n++ > 0) ? ", " : "", program->vars[k].name, instr->snapshot[k]);
+        printf("]");
+      }
+
+      printf("\n");
+    }
+  }
+
+  printf("**END SSA**\n");
+}
+
+//
+// ssa_destroy
+//
+void ssa_destroy(struct SSA_PROGRAM* program)
+{
+  if (program == NULL)
+    panic("program ptr is null (ssa_destroy)");
+
+  for (int i = 0; i < program->num_instrs; i++) {
+    free(program->instrs[i].phi_args);
+    free(program->instrs[i].snapshot);
+  }
+
+  for (int i = 0; i < program->num_blocks; i++) {
+    free(program->blocks[i].instrs);
+    free(program->blocks[i].preds);
+  }
+
+  free(program->instrs);
+  free(program->blocks);
+  free(program->order);
+  free(program->vars);
+  free(program->entries);
+  free(program->var_in_memory);
+  free(program->code);
+  free(program);
+}
@@ -0,0 +1,286 @@
+/*ssa.h*/
+
+//
+// SSA intermediate representation for nuPython. The program
+// graph is converted into basic blocks of instructions in
+// static single assignment form: every instruction computes
+// a value at most once (v0, v1, ...), and where control flow
+// merges --- the top of a while loop, the stmt after an if ---
+// a phi instruction selects the value of each variable from
+// the block we came from.
+//
+// The IR is then optimized:
+//
+//   copy propagation    "y = x" makes y another name for the
+//                       value of x, so uses of y use it directly
+//   check elimination   a variable that has been assigned on
+//                       every path needs no "is it defined?"
+//                       check
+//   common subexpressions
+//                       a computation (or check) repeated in a
+//                       block dominated by the first one reuses
+//                       the first one's value
+//   loop-invariant code motion
+//                       a computation whose operands don't change
+//                       in a loop, and that can't fail, moves to
+//                       the loop's preheader (executed once,
+//                       before the loop)
+//   dead-store elimination
+//                       a value nothing reads is not computed;
+//                       in particular a value assigned to a
+//                       variable that is overwritten before it
+//                       is read
+//
+// and executed by a small interpreter over the optimized IR
+// (see ssa_execute), or output (see ssa_print).
+//
+// Variables live in registers while the program executes, and
+// are written to memory when it stops: at the end, or when an
+// error occurs. A variable's memory cell is created when it's
+// first assigned, so memory looks exactly as it would after
+// execute(). A variable whose address is taken (&x) lives in
+// memory instead, and is read and written there, since
+// pointers can reach it. If pointers can reach any variable
+// (see escape.h), or a memory quota is set (which limits every
+// write as it is made), every variable lives in memory.
+//
+// The semantics --- operators, truth values, printing, and the
+// error messages --- are those of the tree-walking executor,
+// since both go through runtime.h.
+//
+// NOTE: the high-water mark (--memstats) counts the strings
+// the registers hold, so it can differ from execute()'s.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+#pragma once
+
+#include <stdbool.h>  // true, false
+
+#include "programgraph.h"
+#include "ram.h"
+#include "box.h"
+#include "runtime.h"
+
+
+//
+// The instructions, as an X-macro so the enum and the names
+// output by ssa_print are generated from the same list. args
+// are values (instructions), var a variable:
+//
+//   CONST    the constant
+//   ENTRY    the value of var in memory when execution starts
+//            (undefined if it isn't there)
+//   PHI      the value from the predecessor block we came from
+//            (phi_args, one per predecessor)
+//   COPY     args[0], from "y = x" (removed by copy propagation)
+//   BINOP    args[0] <operator> args[1]
+//   CHECK    error if args[0] is undefined (the value of var)
+//   DEFINE   creates var's memory cell, if it doesn't exist yet;
+//            args[0] is the value var had before
+//   LOAD     var, read from memory
+//   STORE    var = args[0], written to memory
+//   ADDR     &var
+//   DEREF    the value at address args[0] (read from var)
+//   STOREP   the value at address args[0] (read from var) =
+//            args[1]
+//   APPEND   var = var + args[1], where args[0] is &var: a
+//            string is appended in place (see runtime_append)
+//   PRINT    print args[0], or an empty line if none
+//   CALL     builtin operator (see builtins.h) called with
+//            args[0], or with no arguments if none
+//   FAIL     error (operator is the enum RUNTIME_STATUS; the
+//            name in the error message is constant, if a
+//            string)
+//   MOVE     args[0], a phi's value on an edge (execution only)
+//   JUMP     continue with block targets[0]
+//   BRANCH   continue with block targets[0] if args[0] is
+//            true, else targets[1]
+//   RETURN   end of the program
+//
+// LOAD, STORE, ADDR and APPEND are only used for variables
+// that live in memory; ENTRY, PHI, COPY, CHECK and DEFINE only
+// for those that don't.
+//
+#define SSA_OPCODES(X)  \
+  X(CONST)              \
+  X(ENTRY)              \
+  X(PHI)                \
+  X(COPY)               \
+  X(BINOP)              \
+  X(CHECK)              \
+  X(DEFINE)             \
+  X(LOAD)               \
+  X(STORE)              \
+  X(ADDR)               \
+  X(DEREF)              \
+  X(STOREP)             \
+  X(APPEND)             \
+  X(PRINT)              \
+  X(CALL)               \
+  X(FAIL)               \
+  X(MOVE)               \
+  X(JUMP)               \
+  X(BRANCH)             \
+  X(RETURN)
+
+enum SSA_OPS
+{
+#define SSA_ENUM(op) SSA_##op,
+  SSA_OPCODES(SSA_ENUM)
+#undef SSA_ENUM
+  SSA_NUM_OPS
+};
+
+struct SSA_INSTR
+{
+  int  op;        // enum SSA_OPS
+  int  line;      // line # of the statement, for error messages
+  int  block;     // the block it's in
+  int  var;       // variable (index into vars), else -1
+  int  operator;  // BINOP: enum OPERATORS, CALL: builtin, FAIL: enum RUNTIME_STATUS
+  int  args[2];   // operands (values), -1 if none
+  int* phi_args;  // PHI: one value per predecessor of the block
+  int  targets[2];  // JUMP and BRANCH: blocks
+
+  struct BOXED_VALUE constant;  // CONST, FAIL
+
+  //
+  // an instruction that can stop the program (an error, or
+  // RETURN) knows the value of every variable in a register at
+  // that point, to write them to memory:
+  //
+  int* snapshot;  // one value per variable (-1 if in memory), NULL if none
+
+  int  reg;       // the register it's computed into, see coalesce
+  bool dead;      // removed by an optimization
+};
+
+struct SSA_BLOCK
+{
+  int* instrs;    // the instructions, phis first, in order
+  int  num_instrs;
+  int  instr_capacity;
+  int  num_phis;
+
+  int* preds;     // predecessor blocks, in the order of phi_args
+  int  num_preds;
+  int  pred_capacity;
+
+  int  succs[2];   // successor blocks (targets of the terminator)
+  int  num_succs;
+
+  struct STMT* stmt;  // first stmt of the block, NULL if none
+
+  int  idom;       // immediate dominator, -1 for the entry block
+  int  preheader;  // if a loop header: its preheader, else -1
+};
+
+//
+// An instruction of the executable form, see ssa_execute.
+// Registers are numbered as the values are (but a value can
+// share its phi's register, see SSA_INSTR.reg):
+//
+struct SSA_CODE
+{
+  int  op;        // enum SSA_OPS (never PHI or COPY)
+  int  line;
+  int  dest;      // register written, -1 if none
+  int  a;         // registers read, -1 if none
+  int  b;
+  int  var;
+  int  operator;
+  int  targets[2];  // JUMP and BRANCH: instruction #s
+  bool own;       // BINOP, CALL, LOAD, DEREF: copy a string result to the register
+  bool reset;     // end of a statement: reset the scratch arena
+  int* snapshot;  // see struct SSA_INSTR
+
+  struct BOXED_VALUE constant;
+};
+
+//
+// What the optimizations did:
+//
+struct SSA_STATS
+{
+  int copies;      // copies propagated
+  int phis;        // trivial phis removed
+  int checks;      // checks (and defines) removed
+  int common;      // common subexpressions reused
+  int hoisted;     // loop invariants moved to a preheader
+  int dead;        // dead values removed
+};
+
+struct SSA_PROGRAM
+{
+  struct SSA_INSTR* instrs;  // the values, v0, v1, ...
+  int    num_instrs;
+  int    instr_capacity;
+
+  struct SSA_BLOCK* blocks;  // block 0 is the entry
+  int    num_blocks;
+  int    block_capacity;
+
+  int*   order;              // the blocks in reverse postorder
+  int    num_order;          // (unreachable blocks are left out)
+
+  struct RUNTIME_VAR* vars;  // the variables
+  int    num_vars;
+  int    var_capacity;
+  int*   entries;            // ENTRY value of each variable
+
+  bool   in_memory;          // every variable lives in memory?
+  bool*  var_in_memory;      // does each variable live in memory?
+
+  struct SSA_STATS stats;
+
+  struct SSA_CODE* code;     // the executable form
+  int    num_code;
+  int    code_capacity;
+  int    num_registers;
+};
+
+
+//
+// Public functions:
+//
+
+//
+// ssa_compile
+//
+// Given a nuPython program graph, converts it into SSA form,
+// optimizes it, and returns a pointer to the dynamically-
+// allocated program, ready to execute.
+//
+// NOTE: the program refers to names and strings in the program
+// graph, so the graph must outlive the program.
+//
+struct SSA_PROGRAM* ssa_compile(struct STMT* program);
+
+//
+// ssa_execute
+//
+// Executes the program against the given memory, exactly as
+// execute() would execute the program graph. If a semantic
+// error occurs, an error message is output and execution
+// stops. The program can be executed again.
+//
+void ssa_execute(struct SSA_PROGRAM* program, struct RAM* memory);
+
+//
+// ssa_print
+//
+// Outputs the (optimized) blocks and instructions of the
+// program, and what the optimizations did.
+//
+void ssa_print(struct SSA_PROGRAM* program);
+
+//
+// ssa_destroy
+//
+// Frees all the memory associated with the program.
+//
+void ssa_destroy(struct SSA_PROGRAM* program);
@@ -0,0 +1,1616 @@
+/*transpile.c*/
+
+//
+// Translation of nuPython programs to C, see transpile.h.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+// to eliminate warnings about stdlib in Visual Studio
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>  // true, false
+#include <stdarg.h>
+#include <string.h>
+#include <assert.h>
+
+#include "programgraph.h"
+#include "ram.h"
+#include "escape.h"
+#include "runtime.h"
+#include "builtins.h"
+#include "transpile.h"
+#include "util.h"
+#include "walk.h"
+
+
+//
+// The text a macro expands to, so the runtime's NUPY_WRAP is
+// RUNTIME_WRAP (see runtime.h) rather than a copy of it:
+//
+#define TRANSPILE_STRING(x) #x
+#define TRANSPILE_EXPANSION(x) TRANSPILE_STRING(x)
+
+//
+// The runtime included in every C program we write:
+//
+static const char* runtime[] = {
+  "//\n",
+  "// nuPython runtime: values, memory, operators, print and the\n",
+  "// builtin functions, with the semantics (and error messages)\n",
+  "// of execute()\n",
+  "//\n",
+  "#include <stdio.h>\n",
+  "#include <stdlib.h>\n",
+  "#include <stdbool.h>\n",
+  "#include <string.h>\n",
+  "#include <math.h>\n",
+  "\n",
+  "enum NUPY_TYPES { NUPY_NONE = 0, NUPY_INT, NUPY_REAL, NUPY_STR, NUPY_PTR, NUPY_BOOLEAN };\n",
+  "\n",
+  "enum NUPY_OPERATORS\n",
+  "{\n",
+  "  NUPY_PLUS, NUPY_MINUS, NUPY_ASTERISK, NUPY_POWER, NUPY_MOD, NUPY_DIV,\n",
+  "  NUPY_EQUAL, NUPY_NOT_EQUAL, NUPY_LT, NUPY_LTE, NUPY_GT, NUPY_GTE, NUPY_IS, NUPY_IN\n",
+  "};\n",
+  "\n",
+  "struct NUPY_VALUE\n",
+  "{\n",
+  "  int    type;  // enum NUPY_TYPES\n",
+  "  int    i;     // int, ptr, boolean\n",
+  "  double r;\n",
+  "  char*  s;\n",
+  "  bool   temp;  // s belongs to this value alone\n",
+  "  size_t length;    // a variable's s: its length, see nupy_append\n",
+  "  size_t capacity;  // and the # of bytes allocated for it\n",
+  "};\n",
+  "\n",
+  "//\n",
+  "// ints wrap around, as in the interpreter, rather than overflow\n",
+  "// (which C leaves undefined):\n",
+  "//\n",
+  "#define NUPY_WRAP(lhs, op, rhs) " TRANSPILE_EXPANSION(RUNTIME_WRAP(lhs, op, rhs)) "\n",
+  "\n",
+  "//\n",
+  "// memory, for programs that use pointers:\n",
+  "//\n",
+  "struct NUPY_CELL\n",
+  "{\n",
+  "  const char* name;\n",
+  "  struct NUPY_VALUE value;\n",
+  "};\n",
+  "\n",
+  "static struct NUPY_CELL* nupy_cells = NULL;\n",
+  "static int nupy_num_cells = 0;\n",
+  "static int nupy_capacity = 0;\n",
+  "\n",
+  "static inline struct NUPY_VALUE nupy_value(int type, int i, double r, char* s)\n",
+  "{\n",
+  "  struct NUPY_VALUE value = { type, i, r, s, false, 0, 0 };\n",
+  "  return value;\n",
+  "}\n",
+  "\n",
+  "static inline struct NUPY_VALUE nupy_int(int i)   { return nupy_value(NUPY_INT, i, 0.0, NULL); }\n",
+  "static inline struct NUPY_VALUE nupy_real(double r) { return nupy_value(NUPY_REAL, 0, r, NULL); }\n",
+  "static inline struct NUPY_VALUE nupy_bool(bool b) { return nupy_value(NUPY_BOOLEAN, b, 0.0, NULL); }\n",
+  "static inline struct NUPY_VALUE nupy_ptr(int a)   { return nupy_value(NUPY_PTR, a, 0.0, NULL); }\n",
+  "static inline struct NUPY_VALUE nupy_str(char* s) { return nupy_value(NUPY_STR, 0, 0.0, s); }\n",
+  "\n",
+  "//\n",
+  "// errors stop the program:\n",
+  "//\n",
+  "static inline void nupy_undefined(const char* name, int line)\n",
+  "{\n",
+  "  printf(\"**SEMANTIC ERROR: name '%s' is not defined (line %d)\\n\", name, line);\n",
+  "  exit(0);\n",
+  "}\n",
+  "\n",
+  "static inline void nupy_invalid_address(const char* name, int line)\n",
+  "{\n",
+  "  printf(\"**SEMANTIC ERROR: '%s' contains invalid address (line %d)\\n\", name, line);\n",
+  "  exit(0);\n",
+  "}\n",
+  "\n",
+  "static inline void nupy_invalid_operands(int line)\n",
+  "{\n",
+  "  printf(\"**SEMANTIC ERROR: invalid operand types (line %d)\\n\", line);\n",
+  "  exit(0);\n",
+  "}\n",
+  "\n",
+  "static inline void nupy_invalid_arguments(const char* name, int line)\n",
+  "{\n",
+  "  printf(\"**SEMANTIC ERROR: invalid arguments for %s() (line %d)\\n\", name, line);\n",
+  "  exit(0);\n",
+  "}\n",
+  "\n",
+  "static inline void nupy_invalid_string(const char* name, int line)\n",
+  "{\n",
+  "  printf(\"**SEMANTIC ERROR: invalid string for %s() (line %d)\\n\", name, line);\n",
+  "  exit(0);\n",
+  "}\n",
+  "\n",
+  "static inline void nupy_division_by_zero(int line)\n",
+  "{\n",
+  "  printf(\"**EXECUTION ERROR: division by zero (line %d)\\n\", line);\n",
+  "  exit(0);\n",
+  "}\n",
+  "\n",
+  "static inline struct NUPY_VALUE nupy_fail_unary(void)\n",
+  "{\n",
+  "  printf(\"else block\\n\");\n",
+  "  exit(0);\n",
+  "}\n",
+  "\n",
+  "static inline struct NUPY_VALUE nupy_fail_element(void)\n",
+  "{\n",
+  "  printf(\"**EXECUTION ERROR: unexpected element type in get_element_value\");\n",
+  "  exit(0);\n",
+  "}\n",
+  "\n",
+  "static inline char* nupy_dup(const char* s1, const char* s2)\n",
+  "{\n",
+  "  size_t len1 = strlen(s1);\n",
+  "  size_t len2 = strlen(s2);\n",
+  "  char* s = (char*)malloc(len1 + len2 + 1);\n",
+  "\n",
+  "  if (s == NULL) {\n",
+  "    printf(\"**EXECUTION ERROR: out of memory\\n\");\n",
+  "    exit(0);\n",
+  "  }\n",
+  "\n",
+  "  memcpy(s, s1, len1);\n",
+  "  memcpy(s + len1, s2, len2 + 1);\n",
+  "  return s;\n",
+  "}\n",
+  "\n",
+  "static inline void nupy_release(struct NUPY_VALUE value)\n",
+  "{\n",
+  "  if (value.type == NUPY_STR && value.temp)\n",
+  "    free(value.s);\n",
+  "}\n",
+  "\n",
+  "//\n",
+  "// var = value; a variable owns its string:\n",
+  "//\n",
+  "static inline void nupy_assign(struct NUPY_VALUE* var, struct NUPY_VALUE value)\n",
+  "{\n",
+  "  if (value.type == NUPY_STR) {\n",
+  "    if (!value.temp)\n",
+  "      value.s = nupy_dup(value.s, \"\");\n",
+  "\n",
+  "    value.length = strlen(value.s);\n",
+  "    value.capacity = value.length + 1;\n",
+  "  }\n",
+  "\n",
+  "  value.temp = false;\n",
+  "\n",
+  "  if (var->type == NUPY_STR)\n",
+  "    free(var->s);\n",
+  "\n",
+  "  *var = value;\n",
+  "}\n",
+  "\n",
+  "static inline void nupy_store(int* address, const char* name, struct NUPY_VALUE value)\n",
+  "{\n",
+  "  if (*address < 0) {\n",
+  "    if (nupy_num_cells == nupy_capacity) {\n",
+  "      nupy_capacity = (nupy_capacity == 0) ? 4 : 2 * nupy_capacity;\n",
+  "      nupy_cells = (struct NUPY_CELL*)realloc(nupy_cells, nupy_capacity * sizeof(struct NUPY_CELL));\n",
+  "\n",
+  "      if (nupy_cells == NULL) {\n",
+  "        printf(\"**EXECUTION ERROR: out of memory\\n\");\n",
+  "        exit(0);\n",
+  "      }\n",
+  "    }\n",
+  "\n",
+  "    nupy_cells[nupy_num_cells].name = name;\n",
+  "    nupy_cells[nupy_num_cells].value = nupy_value(NUPY_NONE, 0, 0.0, NULL);\n",
+  "    *address = nupy_num_cells++;\n",
+  "  }\n",
+  "\n",
+  "  nupy_assign(&nupy_cells[*address].value, value);\n",
+  "}\n",
+  "\n",
+  "static inline void nupy_check_ptr(struct NUPY_VALUE ptr, const char* name, int line)\n",
+  "{\n",
+  "  bool payload = (ptr.type == NUPY_INT || ptr.type == NUPY_PTR || ptr.type == NUPY_BOOLEAN);\n",
+  "\n",
+  "  if (payload && (ptr.i < 0 || ptr.i >= nupy_num_cells))\n",
+  "    nupy_invalid_address(name, line);\n",
+  "\n",
+  "  if (ptr.type != NUPY_PTR)\n",
+  "    nupy_invalid_operands(line);\n",
+  "}\n",
+  "\n",
+  "static inline struct NUPY_VALUE nupy_deref(struct NUPY_VALUE ptr, const char* name, int line)\n",
+  "{\n",
+  "  nupy_check_ptr(ptr, name, line);\n",
+  "  return nupy_cells[ptr.i].value;\n",
+  "}\n",
+  "\n",
+  "static inline void nupy_store_ptr(struct NUPY_VALUE ptr, const char* name, int line, struct NUPY_VALUE value)\n",
+  "{\n",
+  "  nupy_check_ptr(ptr, name, line);\n",
+  "  nupy_assign(&nupy_cells[ptr.i].value, value);\n",
+  "}\n",
+  "\n",
+  "//\n",
+  "// int ** by repeated squaring, wrapping around as * does (a\n",
+  "// negative exponent gives a truncated fraction):\n",
+  "//\n",
+  "static inline int nupy_int_pow(int base, int exponent)\n",
+  "{\n",
+  "  if (exponent < 0)\n",
+  "    return (int)pow(base, exponent);\n",
+  "\n",
+  "  unsigned int result = 1;\n",
+  "  unsigned int square = (unsigned int)base;\n",
+  "\n",
+  "  for (; exponent > 0; exponent >>= 1) {\n",
+  "    if (exponent & 1)\n",
+  "      result *= square;\n",
+  "    square *= square;\n",
+  "  }\n",
+  "\n",
+  "  return (int)result;\n",
+  "}\n",
+  "\n",
+  "//\n",
+  "// int / and %, failing on 0 as the interpreter does; INT_MIN\n",
+  "// / -1 wraps around rather than trap:\n",
+  "//\n",
+  "static inline int nupy_int_div(int lhs, int rhs, int line)\n",
+  "{\n",
+  "  if (rhs == 0)\n",
+  "    nupy_division_by_zero(line);\n",
+  "\n",
+  "  return (rhs == -1) ? NUPY_WRAP(0, -, lhs) : lhs / rhs;\n",
+  "}\n",
+  "\n",
+  "static inline int nupy_int_mod(int lhs, int rhs, int line)\n",
+  "{\n",
+  "  if (rhs == 0)\n",
+  "    nupy_division_by_zero(line);\n",
+  "\n",
+  "  return (rhs == -1) ? 0 : lhs % rhs;\n",
+  "}\n",
+  "\n",
+  "static inline struct NUPY_VALUE nupy_int_op(int lhs, int op, int rhs, int line)\n",
+  "{\n",
+  "  switch (op) {\n",
+  "  case NUPY_PLUS:      return nupy_int(NUPY_WRAP(lhs, +, rhs));\n",
+  "  case NUPY_MINUS:     return nupy_int(NUPY_WRAP(lhs, -, rhs));\n",
+  "  case NUPY_ASTERISK:  return nupy_int(NUPY_WRAP(lhs, *, rhs));\n",
+  "  case NUPY_POWER:     return nupy_int(nupy_int_pow(lhs, rhs));\n",
+  "  case NUPY_MOD:       return nupy_int(nupy_int_mod(lhs, rhs, line));\n",
+  "  case NUPY_DIV:       return nupy_int(nupy_int_div(lhs, rhs, line));\n",
+  "  case NUPY_EQUAL:     return nupy_bool(lhs == rhs);\n",
+  "  case NUPY_NOT_EQUAL: return nupy_bool(lhs != rhs);\n",
+  "  case NUPY_LT:        return nupy_bool(lhs < rhs);\n",
+  "  case NUPY_LTE:       return nupy_bool(lhs <= rhs);\n",
+  "  case NUPY_GT:        return nupy_bool(lhs > rhs);\n",
+  "  case NUPY_GTE:       return nupy_bool(lhs >= rhs);\n",
+  "  default:             return nupy_int(lhs);\n",
+  "  }\n",
+  "}\n",
+  "\n",
+  "static inline struct NUPY_VALUE nupy_real_op(double lhs, int op, double rhs)\n",
+  "{\n",
+  "  switch (op) {\n",
+  "  case NUPY_PLUS:      return nupy_real(lhs + rhs);\n",
+  "  case NUPY_MINUS:     return nupy_real(lhs - rhs);\n",
+  "  case NUPY_ASTERISK:  return nupy_real(lhs * rhs);\n",
+  "  case NUPY_POWER:     return nupy_real(pow(lhs, rhs));\n",
+  "  case NUPY_MOD:       return nupy_real(fmod(lhs, rhs));\n",
+  "  case NUPY_DIV:       return nupy_real(lhs / rhs);\n",
+  "  case NUPY_EQUAL:     return nupy_bool(lhs == rhs);\n",
+  "  case NUPY_NOT_EQUAL: return nupy_bool(lhs != rhs);\n",
+  "  case NUPY_LT:        return nupy_bool(lhs < rhs);\n",
+  "  case NUPY_LTE:       return nupy_bool(lhs <= rhs);\n",
+  "  case NUPY_GT:        return nupy_bool(lhs > rhs);\n",
+  "  case NUPY_GTE:       return nupy_bool(lhs >= rhs);\n",
+  "  default:             return nupy_real(lhs);\n",
+  "  }\n",
+  "}\n",
+  "\n",
+  "static inline struct NUPY_VALUE nupy_str_op(char* lhs, int op, char* rhs)\n",
+  "{\n",
+  "  struct NUPY_VALUE result;\n",
+  "\n",
+  "  switch (op) {\n",
+  "  case NUPY_PLUS:\n",
+  "    result = nupy_str(nupy_dup(lhs, rhs));\n",
+  "    result.temp = true;\n",
+  "    return result;\n",
+  "  case NUPY_EQUAL:     return nupy_bool(strcmp(lhs, rhs) == 0);\n",
+  "  case NUPY_NOT_EQUAL: return nupy_bool(strcmp(lhs, rhs) != 0);\n",
+  "  case NUPY_LT:        return nupy_bool(strcmp(lhs, rhs) < 0);\n",
+  "  case NUPY_LTE:       return nupy_bool(strcmp(lhs, rhs) <= 0);\n",
+  "  case NUPY_GT:        return nupy_bool(strcmp(lhs, rhs) > 0);\n",
+  "  default:             return nupy_bool(strcmp(lhs, rhs) >= 0);\n",
+  "  }\n",
+  "}\n",
+  "\n",
+  "//\n",
+  "// pointer arithmetic: + and - offset the lhs, which keeps its\n",
+  "// type; other operators leave the lhs unchanged\n",
+  "//\n",
+  "static inline struct NUPY_VALUE nupy_ptr_op(struct NUPY_VALUE lhs, int op, struct NUPY_VALUE rhs)\n",
+  "{\n",
+  "  int result = lhs.i;\n",
+  "\n",
+  "  if (op == NUPY_PLUS)\n",
+  "    result = lhs.i + rhs.i;\n",
+  "  else if (op == NUPY_MINUS)\n",
+  "    result = lhs.i - rhs.i;\n",
+  "\n",
+  "  switch (lhs.type) {\n",
+  "  case NUPY_PTR:     return nupy_ptr(result);\n",
+  "  case NUPY_BOOLEAN: return nupy_bool(result != 0);\n",
+  "  default:           return nupy_int(result);\n",
+  "  }\n",
+  "}\n",
+  "\n",
+  "//\n",
+  "// lhs op rhs, where they aren't both strings; the string\n",
+  "// operators are only reached through nupy_binary, once both\n",
+  "// operands are known to be strings:\n",
+  "//\n",
+  "static inline struct NUPY_VALUE nupy_num_binary(struct NUPY_VALUE lhs, int op, struct NUPY_VALUE rhs, int line)\n",
+  "{\n",
+  "  struct NUPY_VALUE result = nupy_value(NUPY_NONE, 0, 0.0, NULL);\n",
+  "  bool lhs_payload = (lhs.type == NUPY_INT || lhs.type == NUPY_PTR || lhs.type == NUPY_BOOLEAN);\n",
+  "  bool rhs_payload = (rhs.type == NUPY_INT || rhs.type == NUPY_PTR || rhs.type == NUPY_BOOLEAN);\n",
+  "\n",
+  "  if (lhs.type == NUPY_INT && rhs.type == NUPY_INT)\n",
+  "    result = nupy_int_op(lhs.i, op, rhs.i, line);\n",
+  "  else if (lhs.type == NUPY_REAL && rhs.type == NUPY_REAL)\n",
+  "    result = nupy_real_op(lhs.r, op, rhs.r);\n",
+  "  else if (lhs.type == NUPY_INT && rhs.type == NUPY_REAL)\n",
+  "    result = nupy_real_op(lhs.i, op, rhs.r);\n",
+  "  else if (lhs.type == NUPY_REAL && rhs.type == NUPY_INT)\n",
+  "    result = nupy_real_op(lhs.r, op, rhs.i);\n",
+  "  else if ((lhs.type == NUPY_PTR || rhs.type == NUPY_PTR) && lhs_payload && rhs_payload)\n",
+  "    result = nupy_ptr_op(lhs, op, rhs);\n",
+  "  else\n",
+  "    nupy_invalid_operands(line);\n",
+  "\n",
+  "  nupy_release(lhs);\n",
+  "  nupy_release(rhs);\n",
+  "  return result;\n",
+  "}\n",
+  "\n",
+  "static inline struct NUPY_VALUE nupy_binary(struct NUPY_VALUE lhs, int op, struct NUPY_VALUE rhs, int line)\n",
+  "{\n",
+  "  if (lhs.type != NUPY_STR || rhs.type != NUPY_STR)\n",
+  "    return nupy_num_binary(lhs, op, rhs, line);\n",
+  "\n",
+  "  if (op == NUPY_MINUS || op == NUPY_ASTERISK || op == NUPY_POWER || op == NUPY_MOD ||\n",
+  "    op == NUPY_DIV || op == NUPY_IS || op == NUPY_IN)\n",
+  "    nupy_invalid_operands(line);\n",
+  "\n",
+  "  struct NUPY_VALUE result = nupy_str_op(lhs.s, op, rhs.s);\n",
+  "\n",
+  "  nupy_release(lhs);\n",
+  "  nupy_release(rhs);\n",
+  "  return result;\n",
+  "}\n",
+  "\n",
+  "//\n",
+  "// var = var + rhs; a string grows in place, its buffer doubling\n",
+  "// as needed, so a loop appending to it takes linear time (see\n",
+  "// runtime_append). rhs may be the var's own string (s = s + s):\n",
+  "//\n",
+  "static inline void nupy_append(struct NUPY_VALUE* var, struct NUPY_VALUE rhs, int line)\n",
+  "{\n",
+  "  if (var->type != NUPY_STR || rhs.type != NUPY_STR) {\n",
+  "    nupy_assign(var, nupy_num_binary(*var, NUPY_PLUS, rhs, line));\n",
+  "    return;\n",
+  "  }\n",
+  "\n",
+  "  bool self = (rhs.s == var->s);\n",
+  "  size_t rhs_length = strlen(rhs.s);\n",
+  "  size_t needed = var->length + rhs_length + 1;\n",
+  "\n",
+  "  if (needed > var->capacity) {\n",
+  "    size_t capacity = var->capacity < 16 ? 16 : var->capacity;\n",
+  "\n",
+  "    while (capacity < needed)\n",
+  "      capacity *= 2;\n",
+  "\n",
+  "    char* s = (char*)realloc(var->s, capacity);\n",
+  "\n",
+  "    if (s == NULL) {\n",
+  "      printf(\"**EXECUTION ERROR: out of memory\\n\");\n",
+  "      exit(0);\n",
+  "    }\n",
+  "\n",
+  "    var->s = s;\n",
+  "    var->capacity = capacity;\n",
+  "  }\n",
+  "\n",
+  "  memmove(var->s + var->length, self ? var->s : rhs.s, rhs_length);\n",
+  "  var->length += rhs_length;\n",
+  "  var->s[var->length] = '\\0';\n",
+  "\n",
+  "  nupy_release(rhs);\n",
+  "}\n",
+  "\n",
+  "static inline bool nupy_truth(struct NUPY_VALUE value)\n",
+  "{\n",
+  "  bool truth;\n",
+  "\n",
+  "  switch (value.type) {\n",
+  "  case NUPY_REAL: truth = (value.r != 0.0); break;\n",
+  "  case NUPY_STR:  truth = (value.s[0] != '\\0'); break;\n",
+  "  case NUPY_NONE: truth = false; break;\n",
+  "  default:        truth = (value.i != 0); break;\n",
+  "  }\n",
+  "\n",
+  "  nupy_release(value);\n",
+  "  return truth;\n",
+  "}\n",
+  "\n",
+  "static inline void nupy_print(struct NUPY_VALUE value)\n",
+  "{\n",
+  "  switch (value.type) {\n",
+  "  case NUPY_INT:     printf(\"%d\\n\", value.i); break;\n",
+  "  case NUPY_REAL:    printf(\"%lf\\n\", value.r); break;\n",
+  "  case NUPY_STR:     printf(\"%s\\n\", value.s); break;\n",
+  "  case NUPY_BOOLEAN: printf(value.i == 0 ? \"False\\n\" : \"True\\n\"); break;\n",
+  "  case NUPY_PTR:     printf(\"%d\\n\", value.i); break;\n",
+  "  default:\n",
+  "    printf(\"**EXECUTION ERROR: unexpected element type in execute_function_call\");\n",
+  "    exit(0);\n",
+  "  }\n",
+  "}\n",
+  "\n",
+  "//\n",
+  "// the builtin functions, see builtins.h: each takes the # of\n",
+  "// arguments and the argument (if any), and a new string it\n",
+  "// returns is temp\n",
+  "//\n",
+  "static inline struct NUPY_VALUE nupy_builtin_print(int num_args, struct NUPY_VALUE arg, int line)\n",
+  "{\n",
+  "  if (num_args == 0)\n",
+  "    printf(\"\\n\");\n",
+  "  else\n",
+  "    nupy_print(arg);\n",
+  "\n",
+  "  return nupy_value(NUPY_NONE, 0, 0.0, NULL);\n",
+  "}\n",
+  "\n",
+  "static inline struct NUPY_VALUE nupy_builtin_input(int num_args, struct NUPY_VALUE arg, int line)\n",
+  "{\n",
+  "  if (num_args > 0) {\n",
+  "    if (arg.type != NUPY_STR)\n",
+  "      nupy_invalid_arguments(\"input\", line);\n",
+  "    printf(\"%s\", arg.s);\n",
+  "  }\n",
+  "\n",
+  "  fflush(stdout);\n",
+  "\n",
+  "  char chunk[256];\n",
+  "  char* s = nupy_dup(\"\", \"\");\n",
+  "\n",
+  "  while (fgets(chunk, sizeof(chunk), stdin) != NULL) {\n",
+  "    char* longer = nupy_dup(s, chunk);\n",
+  "    size_t n = strlen(chunk);\n",
+  "\n",
+  "    free(s);\n",
+  "    s = longer;\n",
+  "\n",
+  "    if (n > 0 && chunk[n - 1] == '\\n')\n",
+  "      break;\n",
+  "  }\n",
+  "\n",
+  "  size_t length = strlen(s);\n",
+  "\n",
+  "  while (length > 0 && (s[length - 1] == '\\n' || s[length - 1] == '\\r'))\n",
+  "    s[--length] = '\\0';\n",
+  "\n",
+  "  struct NUPY_VALUE result = nupy_str(s);\n",
+  "  result.temp = true;\n",
+  "  return result;\n",
+  "}\n",
+  "\n",
+  "static inline struct NUPY_VALUE nupy_builtin_int(int num_args, struct NUPY_VALUE arg, int line)\n",
+  "{\n",
+  "  switch (arg.type) {\n",
+  "  case NUPY_INT:     return arg;\n",
+  "  case NUPY_BOOLEAN: return nupy_int(arg.i);\n",
+  "  case NUPY_REAL:\n",
+  "    if (!(arg.r > -2147483649.0 && arg.r < 2147483648.0))\n",
+  "      nupy_invalid_arguments(\"int\", line);\n",
+  "    return nupy_int((int)arg.r);\n",
+  "  case NUPY_STR: {\n",
+  "    int i = atoi(arg.s);\n",
+  "    if (i == 0 && arg.s[0] != '0')\n",
+  "      nupy_invalid_string(\"int\", line);\n",
+  "    return nupy_int(i);\n",
+  "  }\n",
+  "  default:\n",
+  "    nupy_invalid_arguments(\"int\", line);\n",
+  "    return arg;\n",
+  "  }\n",
+  "}\n",
+  "\n",
+  "static inline struct NUPY_VALUE nupy_builtin_float(int num_args, struct NUPY_VALUE arg, int line)\n",
+  "{\n",
+  "  switch (arg.type) {\n",
+  "  case NUPY_REAL:    return arg;\n",
+  "  case NUPY_INT:\n",
+  "  case NUPY_BOOLEAN: return nupy_real(arg.i);\n",
+  "  case NUPY_STR: {\n",
+  "    double r = atof(arg.s);\n",
+  "    if (r == 0.0 && arg.s[0] != '0')\n",
+  "      nupy_invalid_string(\"float\", line);\n",
+  "    return nupy_real(r);\n",
+  "  }\n",
+  "  default:\n",
+  "    nupy_invalid_arguments(\"float\", line);\n",
+  "    return arg;\n",
+  "  }\n",
+  "}\n",
+  "\n",
+  "static inline struct NUPY_VALUE nupy_builtin_str(int num_args, struct NUPY_VALUE arg, int line)\n",
+  "{\n",
+  "  char buffer[400];  // room for any %lf\n",
+  "\n",
+  "  switch (arg.type) {\n",
+  "  case NUPY_STR:     return arg;\n",
+  "  case NUPY_BOOLEAN: return nupy_str(arg.i ? \"True\" : \"False\");\n",
+  "  case NUPY_NONE:    return nupy_str(\"None\");\n",
+  "  case NUPY_REAL:    snprintf(buffer, sizeof(buffer), \"%lf\", arg.r); break;\n",
+  "  default:           snprintf(buffer, sizeof(buffer), \"%d\", arg.i); break;\n",
+  "  }\n",
+  "\n",
+  "  struct NUPY_VALUE result = nupy_str(nupy_dup(buffer, \"\"));\n",
+  "  result.temp = true;\n",
+  "  return result;\n",
+  "}\n",
+  "\n",
+  "static inline struct NUPY_VALUE nupy_builtin_len(int num_args, struct NUPY_VALUE arg, int line)\n",
+  "{\n",
+  "  if (arg.type != NUPY_STR)\n",
+  "    nupy_invalid_arguments(\"len\", line);\n",
+  "\n",
+  "  return nupy_int((int)strlen(arg.s));\n",
+  "}\n",
+  "\n",
+  "static inline struct NUPY_VALUE nupy_builtin_abs(int num_args, struct NUPY_VALUE arg, int line)\n",
+  "{\n",
+  "  switch (arg.type) {\n",
+  "  case NUPY_INT:\n",
+  "  case NUPY_BOOLEAN: return nupy_int(arg.i < 0 ? NUPY_WRAP(0, -, arg.i) : arg.i);\n",
+  "  case NUPY_REAL:    return nupy_real(fabs(arg.r));\n",
+  "  default:\n",
+  "    nupy_invalid_arguments(\"abs\", line);\n",
+  "    return arg;\n",
+  "  }\n",
+  "}\n",
+  NULL
+};
+
+//
+// The operators, as named in the runtime (enum NUPY_OPERATORS)
+// and in C, in the order of enum OPERATORS:
+//
+static const char* operator_names[] = {
+  "NUPY_PLUS", "NUPY_MINUS", "NUPY_ASTERISK", "NUPY_POWER", "NUPY_MOD", "NUPY_DIV",
+  "NUPY_EQUAL", "NUPY_NOT_EQUAL", "NUPY_LT", "NUPY_LTE", "NUPY_GT", "NUPY_GTE", "NUPY_IS", "NUPY_IN"
+};
+
+static const char* c_operators[] = {
+  "+", "-", "*", NULL, "%", "/", "==", "!=", "<", "<=", ">", ">=", NULL, NULL
+};
+
+//
+// The type of a variable or expression: RAM_TYPE_INT,
+// RAM_TYPE_REAL or RAM_TYPE_BOOLEAN if it's always of that
+// type (a native C value), else one of these:
+//
+#define TYPE_UNKNOWN -1  // not known yet
+#define TYPE_DYNAMIC -2  // a runtime value, struct NUPY_VALUE
+
+struct TRANSPILE_VAR
+{
+  char* name;       // first, see walk_var_index
+  int   type;
+  bool  in_memory;  // lives in the runtime's memory (see escape.h)?
+  bool  read;       // does the program read it (see emit_defined)?
+};
+
+//
+// Each statement becomes a label, if something jumps to it:
+//
+struct TRANSPILE_LABEL
+{
+  struct STMT* stmt;
+  bool emitted;  // has the code for the stmt been written?
+  bool target;   // does anything jump to it?
+};
+
+struct TRANSPILER
+{
+  FILE* output;  // NULL when only looking for jump targets
+
+  struct TRANSPILE_VAR* vars;
+  int num_vars;
+  int var_capacity;
+
+  struct TRANSPILE_LABEL* labels;
+  int num_labels;
+  int label_capacity;
+
+  bool pointers;  // does the program use & or *?
+  int  temps;     // temporaries of the current statement
+};
+
+//
+// An operand, computed into the temporary t<temp>:
+//
+struct TRANSPILE_OPERAND
+{
+  int temp;
+  int type;
+};
+
+
+//
+// Private functions:
+//
+
+//
+// emit
+//
+// printf to the output, if there is one.
+//
+static void emit(struct TRANSPILER* transpiler, const char* format, ...)
+{
+  if (transpiler->output == NULL)
+    return;
+
+  va_list args;
+
+  va_start(args, format);
+  vfprintf(transpiler->output, format, args);
+  va_end(args);
+}
+
+//
+// emit_string
+//
+// Outputs the given string as a C string literal.
+//
+static void emit_string(struct TRANSPILER* transpiler, char* s)
+{
+  emit(transpiler, "\"");
+
+  for (; *s != '\0'; s++) {
+    unsigned char c = (unsigned char)*s;
+
+    if (c == '"' || c == '\\')
+      emit(transpiler, "\\%c", c);
+    else if (c < ' ' || c > '~')
+      emit(transpiler, "\\%03o", c);
+    else
+      emit(transpiler, "%c", c);
+  }
+
+  emit(transpiler, "\"");
+}
+
+//
+// find_var
+//
+// Returns the variable with the given name, adding it if this
+// is the first reference.
+//
+static struct TRANSPILE_VAR* find_var(struct TRANSPILER* transpiler, char* name)
+{
+  int i = walk_var_index(transpiler->vars, transpiler->num_vars, sizeof(struct TRANSPILE_VAR), name);
+
+  if (i >= 0)
+    return &transpiler->vars[i];
+
+  transpiler->vars = (struct TRANSPILE_VAR*)grow(transpiler->vars, transpiler->num_vars,
+    &transpiler->var_capacity, sizeof(struct TRANSPILE_VAR));
+
+  struct TRANSPILE_VAR* var = &transpiler->vars[transpiler->num_vars++];
+
+  var->name = name;
+  var->type = TYPE_UNKNOWN;
+  var->in_memory = false;
+  var->read = false;
+
+  return var;
+}
+
+//
+// find_label
+//
+// Returns the label of the given statement, adding it if this
+// is the first reference.
+//
+static struct TRANSPILE_LABEL* find_label(struct TRANSPILER* transpiler, struct STMT* stmt)
+{
+  for (int i = 0; i < transpiler->num_labels; i++)
+    if (transpiler->labels[i].stmt == stmt)
+      return &transpiler->labels[i];
+
+  transpiler->labels = (struct TRANSPILE_LABEL*)grow(transpiler->labels, transpiler->num_labels,
+    &transpiler->label_capacity, sizeof(struct TRANSPILE_LABEL));
+
+  struct TRANSPILE_LABEL* label = &transpiler->labels[transpiler->num_labels++];
+
+  label->stmt = stmt;
+  label->emitted = false;
+  label->target = false;
+
+  return label;
+}
+
+//
+// label_id
+//
+// The number of the given statement's label, s_<id> in C.
+//
+static int label_id(struct TRANSPILER* transpiler, struct STMT* stmt)
+{
+  return (int)(find_label(transpiler, stmt) - transpiler->labels);
+}
+
+//
+// collect_var
+//
+// Notes a variable the program refers to (see walk_vars), and
+// whether it's a use of pointers.
+//
+static void collect_var(void* context, char* name, int use)
+{
+  struct TRANSPILER* transpiler = (struct TRANSPILER*)context;
+
+  find_var(transpiler, name);
+
+  if (use == WALK_ADDRESS_OF || use == WALK_DEREF || use == WALK_STORED_VIA)
+    transpiler->pointers = true;
+}
+
+//
+// collect
+//
+// Finds all the statements of the program (in label order),
+// all the variables, and whether the program uses pointers.
+//
+static void collect(struct TRANSPILER* transpiler, struct STMT* program)
+{
+  if (program == NULL)
+    return;
+
+  find_label(transpiler, program);
+
+  for (int i = 0; i < transpiler->num_labels; i++) {
+    struct STMT* stmt = transpiler->labels[i].stmt;
+
+    walk_vars(stmt, collect_var, transpiler);
+
+    struct STMT* next[2];
+    int n = walk_next(stmt, next);
+
+    for (int j = 0; j < n; j++)
+      if (next[j] != NULL)
+        find_label(transpiler, next[j]);
+  }
+}
+
+//
+// unary_type
+// expr_type
+//
+// The type of a unary or binary expression, given what we know
+// about the variables so far.
+//
+static int unary_type(struct TRANSPILER* transpiler, struct UNARY_EXPR* unary)
+{
+  if (unary->expr_type != UNARY_ELEMENT)
+    return TYPE_DYNAMIC;
+
+  switch (unary->element->element_type) {
+  case ELEMENT_IDENTIFIER:
+    return find_var(transpiler, unary->element->element_value)->type;
+
+  case ELEMENT_INT_LITERAL:
+    return RAM_TYPE_INT;
+
+  case ELEMENT_REAL_LITERAL:
+    return RAM_TYPE_REAL;
+
+  case ELEMENT_TRUE:
+  case ELEMENT_FALSE:
+    return RAM_TYPE_BOOLEAN;
+
+  default:  // strings, None
+    return TYPE_DYNAMIC;
+  }
+}
+
+static int binary_type(int lhs, int operator, int rhs)
+{
+  if (lhs == TYPE_UNKNOWN || rhs == TYPE_UNKNOWN)
+    return TYPE_UNKNOWN;
+
+  //
+  // only ints and reals have native operators:
+  //
+  if ((lhs != RAM_TYPE_INT && lhs != RAM_TYPE_REAL) ||
+    (rhs != RAM_TYPE_INT && rhs != RAM_TYPE_REAL))
+  {
+    return TYPE_DYNAMIC;
+  }
+
+  switch (operator) {
+  case OPERATOR_EQUAL:
+  case OPERATOR_NOT_EQUAL:
+  case OPERATOR_LT:
+  case OPERATOR_LTE:
+  case OPERATOR_GT:
+  case OPERATOR_GTE:
+    return RAM_TYPE_BOOLEAN;
+
+  case OPERATOR_IS:
+  case OPERATOR_IN:
+    return TYPE_DYNAMIC;
+
+  default:
+    return (lhs == RAM_TYPE_INT && rhs == RAM_TYPE_INT) ? RAM_TYPE_INT : RAM_TYPE_REAL;
+  }
+}
+
+static int expr_type(struct TRANSPILER* transpiler, struct VALUE_EXPR* expr)
+{
+  int lhs = unary_type(transpiler, expr->lhs);
+
+  if (!expr->isBinaryExpr)
+    return lhs;
+
+  return binary_type(lhs, expr->operator, unary_type(transpiler, expr->rhs));
+}
+
+//
+// infer_types
+//
+// Gives each variable the type of everything assigned to it,
+// if that's always the same native type; else it's dynamic.
+// Repeats until nothing changes, since the type of an
+// assignment depends on the types of the variables in it.
+//
+static bool infer_pass(struct TRANSPILER* transpiler)
+{
+  bool changed = false;
+
+  for (int i = 0; i < transpiler->num_labels; i++) {
+    struct STMT* stmt = transpiler->labels[i].stmt;
+
+    if (stmt->stmt_type != STMT_ASSIGNMENT || stmt->types.assignment->isPtrDeref)
+      continue;
+
+    struct STMT_ASSIGNMENT* assign = stmt->types.assignment;
+    struct TRANSPILE_VAR* var = find_var(transpiler, assign->var_name);
+
+    int type = (assign->rhs->value_type == VALUE_FUNCTION_CALL) ?
+      TYPE_DYNAMIC : expr_type(transpiler, assign->rhs->types.expr);
+
+    if (type == TYPE_UNKNOWN || type == var->type || var->type == TYPE_DYNAMIC)
+      continue;
+
+    var->type = (var->type == TYPE_UNKNOWN) ? type : TYPE_DYNAMIC;
+    changed = true;
+  }
+
+  return changed;
+}
+
+static void infer_types(struct TRANSPILER* transpiler)
+{
+  //
+  // a variable in memory is dynamic:
+  //
+  for (int i = 0; i < transpiler->num_vars; i++)
+    if (transpiler->vars[i].in_memory)
+      transpiler->vars[i].type = TYPE_DYNAMIC;
+
+  while (infer_pass(transpiler))
+    ;
+
+  //
+  // a variable only ever assigned from itself (never defined)
+  // is dynamic, and so is whatever is assigned from it:
+  //
+  for (int i = 0; i < transpiler->num_vars; i++)
+    if (transpiler->vars[i].type == TYPE_UNKNOWN)
+      transpiler->vars[i].type = TYPE_DYNAMIC;
+
+  while (infer_pass(transpiler))
+    ;
+}
+
+//
+// c_type
+//
+// The C type of the given type.
+//
+static const char* c_type(int type)
+{
+  switch (type) {
+  case RAM_TYPE_INT:
+    return "int";
+
+  case RAM_TYPE_REAL:
+    return "double";
+
+  case RAM_TYPE_BOOLEAN:
+    return "bool";
+
+  default:
+    return "struct NUPY_VALUE";
+  }
+}
+
+//
+// emit_boxed
+//
+// Outputs the given operand as a runtime value.
+//
+static void emit_boxed(struct TRANSPILER* transpiler, struct TRANSPILE_OPERAND operand)
+{
+  switch (operand.type) {
+  case RAM_TYPE_INT:
+    emit(transpiler, "nupy_int(t%d)", operand.temp);
+    break;
+
+  case RAM_TYPE_REAL:
+    emit(transpiler, "nupy_real(t%d)", operand.temp);
+    break;
+
+  case RAM_TYPE_BOOLEAN:
+    emit(transpiler, "nupy_bool(t%d)", operand.temp);
+    break;
+
+  default:
+    emit(transpiler, "t%d", operand.temp);
+    break;
+  }
+}
+
+//
+// new_temp
+//
+// Starts the declaration of the next temporary, of the given
+// type; the caller outputs its initial value.
+//
+static struct TRANSPILE_OPERAND new_temp(struct TRANSPILER* transpiler, int type)
+{
+  struct TRANSPILE_OPERAND operand;
+
+  operand.temp = ++transpiler->temps;
+  operand.type = type;
+
+  emit(transpiler, "    %s t%d = ", c_type(type), operand.temp);
+
+  return operand;
+}
+
+//
+// emit_defined
+//
+// Outputs the check that the given variable is defined. Every
+// read of a variable starts with the check, so this is also
+// where we learn that the variable is read.
+//
+static void emit_defined(struct TRANSPILER* transpiler, struct TRANSPILE_VAR* var, int line)
+{
+  var->read = true;
+
+  if (var->in_memory)
+    emit(transpiler, "    if (a_%s < 0) nupy_undefined(\"%s\", %d);\n", var->name, var->name, line);
+  else
+    emit(transpiler, "    if (!d_%s) nupy_undefined(\"%s\", %d);\n", var->name, var->name, line);
+}
+
+//
+// emit_var
+//
+// Outputs a variable's value, as a C expression.
+//
+static void emit_var(struct TRANSPILER* transpiler, struct TRANSPILE_VAR* var)
+{
+  if (var->in_memory)
+    emit(transpiler, "nupy_cells[a_%s].value", var->name);
+  else
+    emit(transpiler, "v_%s", var->name);
+}
+
+//
+// emit_unary
+//
+// Outputs the code computing the given unary expression into
+// a temporary, and returns it.
+//
+static struct TRANSPILE_OPERAND emit_unary(struct TRANSPILER* transpiler, struct UNARY_EXPR* unary, int line)
+{
+  struct ELEMENT* element = unary->element;
+  struct TRANSPILE_OPERAND operand;
+
+  if (unary->expr_type == UNARY_ADDRESS_OF || unary->expr_type == UNARY_PTR_DEREF) {
+    struct TRANSPILE_VAR* var = find_var(transpiler, element->element_value);
+
+    emit_defined(transpiler, var, line);
+
+    operand = new_temp(transpiler, TYPE_DYNAMIC);
+
+    if (unary->expr_type == UNARY_ADDRESS_OF)
+      emit(transpiler, "nupy_ptr(a_%s);\n", var->name);
+    else {
+      assert(var->type == TYPE_DYNAMIC);
+
+      emit(transpiler, "nupy_deref(");
+      emit_var(transpiler, var);
+      emit(transpiler, ", \"%s\", %d);\n", var->name, line);
+    }
+
+    return operand;
+  }
+
+  if (unary->expr_type != UNARY_ELEMENT) {
+    operand = new_temp(transpiler, TYPE_DYNAMIC);
+    emit(transpiler, "nupy_fail_unary();\n");
+    return operand;
+  }
+
+  switch (element->element_type) {
+  case ELEMENT_IDENTIFIER:
+    {
+      struct TRANSPILE_VAR* var = find_var(transpiler, element->element_value);
+
+      emit_defined(transpiler, var, line);
+
+      operand = new_temp(transpiler, var->type);
+      emit_var(transpiler, var);
+      emit(transpiler, ";\n");
+    }
+    break;
+
+  case ELEMENT_INT_LITERAL:
+    operand = new_temp(transpiler, RAM_TYPE_INT);
+    emit(transpiler, "%d;\n", atoi(element->element_value));
+    break;
+
+  case ELEMENT_REAL_LITERAL:
+    operand = new_temp(transpiler, RAM_TYPE_REAL);
+    emit(transpiler, "%.17g;\n", atof(element->element_value));
+    break;
+
+  case ELEMENT_STR_LITERAL:
+    operand = new_temp(transpiler, TYPE_DYNAMIC);
+    emit(transpiler, "nupy_str(");
+    emit_string(transpiler, element->element_value);
+    emit(transpiler, ");\n");
+    break;
+
+  case ELEMENT_TRUE:
+    operand = new_temp(transpiler, RAM_TYPE_BOOLEAN);
+    emit(transpiler, "true;\n");
+    break;
+
+  case ELEMENT_FALSE:
+    operand = new_temp(transpiler, RAM_TYPE_BOOLEAN);
+    emit(transpiler, "false;\n");
+    break;
+
+  default:
+    operand = new_temp(transpiler, TYPE_DYNAMIC);
+    emit(transpiler, "nupy_fail_element();\n");
+    break;
+  }
+
+  return operand;
+}
+
+//
+// emit_expr
+//
+// Outputs the code computing the given expression into a
+// temporary, and returns it. Operands are computed in order,
+// so errors are reported in the same order as execute().
+//
+static struct TRANSPILE_OPERAND emit_expr(struct TRANSPILER* transpiler, struct VALUE_EXPR* expr, int line)
+{
+  struct TRANSPILE_OPERAND lhs = emit_unary(transpiler, expr->lhs, line);
+
+  if (!expr->isBinaryExpr)
+    return lhs;
+
+  struct TRANSPILE_OPERAND rhs = emit_unary(transpiler, expr->rhs, line);
+  int operator = expr->operator;
+
+  int type = binary_type(lhs.type, operator, rhs.type);
+  struct TRANSPILE_OPERAND result = new_temp(transpiler, type);
+
+  if (type == TYPE_DYNAMIC) {
+    //
+    // a native operand (int, real or boolean) isn't a string,
+    // so the string operators can't apply (see nupy_num_binary):
+    //
+    bool native = (lhs.type != TYPE_DYNAMIC || rhs.type != TYPE_DYNAMIC);
+
+    emit(transpiler, native ? "nupy_num_binary(" : "nupy_binary(");
+    emit_boxed(transpiler, lhs);
+    emit(transpiler, ", %s, ", operator_names[operator]);
+    emit_boxed(transpiler, rhs);
+    emit(transpiler, ", %d);\n", line);
+  }
+  else if (operator == OPERATOR_POWER) {
+    if (type == RAM_TYPE_INT)
+      emit(transpiler, "nupy_int_pow(t%d, t%d);\n", lhs.temp, rhs.temp);
+    else
+      emit(transpiler, "pow(t%d, t%d);\n", lhs.temp, rhs.temp);
+  }
+  else if (operator == OPERATOR_MOD && type == RAM_TYPE_REAL) {
+    emit(transpiler, "fmod(t%d, t%d);\n", lhs.temp, rhs.temp);
+  }
+  else if (type == RAM_TYPE_INT && operator <= OPERATOR_ASTERISK) {
+    emit(transpiler, "NUPY_WRAP(t%d, %s, t%d);\n", lhs.temp, c_operators[operator], rhs.temp);
+  }
+  else if (type == RAM_TYPE_INT && (operator == OPERATOR_DIV || operator == OPERATOR_MOD)) {
+    emit(transpiler, "nupy_int_%s(t%d, t%d, %d);\n", (operator == OPERATOR_DIV) ? "div" : "mod",
+      lhs.temp, rhs.temp, line);
+  }
+  else {
+    emit(transpiler, "t%d %s t%d;\n", lhs.temp, c_operators[operator], rhs.temp);
+  }
+
+  return result;
+}
+
+//
+// emit_builtin
+//
+// Outputs the code calling the named builtin function (see
+// builtins.h) into a temporary, and returns it. The function
+// is looked up now, so calling one we don't have, or with the
+// wrong # of arguments, is an error in the C program (once
+// the argument is computed, as in execute()).
+//
+// NOTE: the runtime has a nupy_builtin_<name> for every
+// builtin in the registry.
+//
+static struct TRANSPILE_OPERAND emit_builtin(struct TRANSPILER* transpiler, char* function_name,
+  struct ELEMENT* parameter, int line)
+{
+  int index = builtin_lookup(function_name);
+  struct TRANSPILE_OPERAND result;
+
+  if (index < 0) {
+    emit(transpiler, "    nupy_undefined(");
+    emit_string(transpiler, function_name);
+    emit(transpiler, ", %d);\n", line);
+
+    result = new_temp(transpiler, TYPE_DYNAMIC);
+    emit(transpiler, "nupy_value(NUPY_NONE, 0, 0.0, NULL);\n");
+    return result;
+  }
+
+  struct BUILTIN* builtin = builtin_get(index);
+  struct TRANSPILE_OPERAND arg;
+  int num_args = 0;
+
+  if (parameter != NULL) {
+    struct UNARY_EXPR unary;
+
+    unary.expr_type = UNARY_ELEMENT;
+    unary.element = parameter;
+
+    arg = emit_unary(transpiler, &unary, line);
+    num_args++;
+  }
+
+  if (num_args < builtin->min_args || num_args > builtin->max_args)
+    emit(transpiler, "    nupy_invalid_arguments(\"%s\", %d);\n", builtin->name, line);
+
+  result = new_temp(transpiler, TYPE_DYNAMIC);
+  emit(transpiler, "nupy_builtin_%s(%d, ", builtin->name, num_args);
+
+  if (num_args > 0)
+    emit_boxed(transpiler, arg);
+  else
+    emit(transpiler, "nupy_value(NUPY_NONE, 0, 0.0, NULL)");
+
+  emit(transpiler, ", %d);\n", line);
+
+  return result;
+}
+
+//
+// is_append
+//
+// Returns true if the given assignment appends to a variable
+// that isn't a native C value: x = x + e.
+//
+static bool is_append(struct TRANSPILER* transpiler, struct STMT_ASSIGNMENT* assign)
+{
+  if (assign->isPtrDeref || assign->rhs->value_type == VALUE_FUNCTION_CALL)
+    return false;
+
+  struct VALUE_EXPR* expr = assign->rhs->types.expr;
+
+  return expr->isBinaryExpr &&
+    expr->operator == OPERATOR_PLUS &&
+    expr->lhs->expr_type == UNARY_ELEMENT &&
+    expr->lhs->element->element_type == ELEMENT_IDENTIFIER &&
+    strcmp(expr->lhs->element->element_value, assign->var_name) == 0 &&
+    find_var(transpiler, assign->var_name)->type == TYPE_DYNAMIC;
+}
+
+//
+// emit_append
+//
+// Outputs the code for an assignment x = x + e (see is_append),
+// which appends to a string in place (see nupy_append).
+//
+static void emit_append(struct TRANSPILER* transpiler, struct STMT* stmt)
+{
+  struct STMT_ASSIGNMENT* assign = stmt->types.assignment;
+  struct TRANSPILE_VAR* var = find_var(transpiler, assign->var_name);
+
+  emit(transpiler, "  {\n");
+
+  emit_defined(transpiler, var, stmt->line);
+
+  struct TRANSPILE_OPERAND rhs = emit_unary(transpiler, assign->rhs->types.expr->rhs, stmt->line);
+
+  emit(transpiler, "    nupy_append(&");
+  emit_var(transpiler, var);
+  emit(transpiler, ", ");
+  emit_boxed(transpiler, rhs);
+  emit(transpiler, ", %d);\n", stmt->line);
+
+  emit(transpiler, "  }\n");
+}
+
+//
+// emit_assignment
+// emit_call
+// emit_condition
+//
+// Output the code for a statement, in a block of its own so
+// the temporaries are local to it.
+//
+static void emit_assignment(struct TRANSPILER* transpiler, struct STMT* stmt)
+{
+  struct STMT_ASSIGNMENT* assign = stmt->types.assignment;
+  struct TRANSPILE_VAR* var = find_var(transpiler, assign->var_name);
+
+  emit(transpiler, "  {\n");
+
+  struct TRANSPILE_OPERAND value;
+
+  if (assign->rhs->value_type == VALUE_FUNCTION_CALL) {
+    struct VALUE_FUNCTION_CALL* call = assign->rhs->types.function_call;
+
+    value = emit_builtin(transpiler, call->function_name, call->parameter, stmt->line);
+  }
+  else {
+    value = emit_expr(transpiler, assign->rhs->types.expr, stmt->line);
+  }
+
+  if (transpiler->pointers && !assign->isPtrDeref && !var->in_memory) {
+    //
+    // the variable's memory cell is still created when it's
+    // first assigned, so addresses are those of execute():
+    //
+    emit(transpiler, "    if (a_%s < 0) nupy_store(&a_%s, \"%s\", nupy_value(NUPY_NONE, 0, 0.0, NULL));\n",
+      var->name, var->name, var->name);
+  }
+
+  if (assign->isPtrDeref) {
+    assert(var->type == TYPE_DYNAMIC);
+
+    emit_defined(transpiler, var, stmt->line);
+    emit(transpiler, "    nupy_store_ptr(");
+    emit_var(transpiler, var);
+    emit(transpiler, ", \"%s\", %d, ", var->name, stmt->line);
+    emit_boxed(transpiler, value);
+    emit(transpiler, ");\n");
+  }
+  else if (var->in_memory) {
+    emit(transpiler, "    nupy_store(&a_%s, \"%s\", ", var->name, var->name);
+    emit_boxed(transpiler, value);
+    emit(transpiler, ");\n");
+  }
+  else if (var->type == TYPE_DYNAMIC) {
+    emit(transpiler, "    nupy_assign(&v_%s, ", var->name);
+    emit_boxed(transpiler, value);
+    emit(transpiler, ");\n");
+    emit(transpiler, "    d_%s = true;\n", var->name);
+  }
+  else {
+    assert(value.type == var->type);
+
+    emit(transpiler, "    v_%s = t%d;\n", var->name, value.temp);
+    emit(transpiler, "    d_%s = true;\n", var->name);
+  }
+
+  emit(transpiler, "  }\n");
+}
+
+static void emit_call(struct TRANSPILER* transpiler, struct STMT* stmt)
+{
+  struct STMT_FUNCTION_CALL* call = stmt->types.function_call;
+
+  //
+  // print is output inline; any other function is called, and
+  // what it returns is discarded:
+  //
+  if (strcmp(call->function_name, "print") != 0) {
+    emit(transpiler, "  {\n");
+
+    struct TRANSPILE_OPERAND value = emit_builtin(transpiler, call->function_name, call->parameter, stmt->line);
+
+    emit(transpiler, "    nupy_release(t%d);\n", value.temp);
+    emit(transpiler, "  }\n");
+    return;
+  }
+
+  if (call->parameter == NULL) {
+    emit(transpiler, "  printf(\"\\n\");\n");
+    return;
+  }
+
+  struct UNARY_EXPR unary;
+
+  unary.expr_type = UNARY_ELEMENT;
+  unary.element = call->parameter;
+
+  emit(transpiler, "  {\n");
+
+  struct TRANSPILE_OPERAND value = emit_unary(transpiler, &unary, stmt->line);
+
+  switch (value.type) {
+  case RAM_TYPE_INT:
+    emit(transpiler, "    printf(\"%%d\\n\", t%d);\n", value.temp);
+    break;
+
+  case RAM_TYPE_REAL:
+    emit(transpiler, "    printf(\"%%lf\\n\", t%d);\n", value.temp);
+    break;
+
+  case RAM_TYPE_BOOLEAN:
+    emit(transpiler, "    printf(t%d ? \"True\\n\" : \"False\\n\");\n", value.temp);
+    break;
+
+  default:
+    emit(transpiler, "    nupy_print(t%d);\n", value.temp);
+    break;
+  }
+
+  emit(transpiler, "  }\n");
+}
+
+//
+// emit_goto
+//
+// Outputs a jump to the given statement, or a return if it's
+// the end of the program.
+//
+static void emit_goto(struct TRANSPILER* transpiler, struct STMT* stmt)
+{
+  if (stmt == NULL) {
+    emit(transpiler, "return;\n");
+    return;
+  }
+
+  find_label(transpiler, stmt)->target = true;
+
+  emit(transpiler, "goto s_%d;\n", label_id(transpiler, stmt));
+}
+
+static void emit_condition(struct TRANSPILER* transpiler, struct STMT* stmt, struct VALUE_EXPR* condition, struct STMT* otherwise)
+{
+  emit(transpiler, "  {\n");
+
+  struct TRANSPILE_OPERAND value = emit_expr(transpiler, condition, stmt->line);
+
+  switch (value.type) {
+  case RAM_TYPE_INT:
+    emit(transpiler, "    if (t%d == 0) ", value.temp);
+    break;
+
+  case RAM_TYPE_REAL:
+    emit(transpiler, "    if (t%d == 0.0) ", value.temp);
+    break;
+
+  case RAM_TYPE_BOOLEAN:
+    emit(transpiler, "    if (!t%d) ", value.temp);
+    break;
+
+  default:
+    emit(transpiler, "    if (!nupy_truth(t%d)) ", value.temp);
+    break;
+  }
+
+  emit_goto(transpiler, otherwise);
+
+  emit(transpiler, "  }\n");
+}
+
+//
+// emit_stmts
+//
+// Outputs the statements starting from the given one, until
+// we fall off the end of the program (return) or reach a
+// statement that has already been output (goto).
+//
+static void emit_stmts(struct TRANSPILER* transpiler, struct STMT* stmt)
+{
+  while (stmt != NULL) {
+
+    struct TRANSPILE_LABEL* label = find_label(transpiler, stmt);
+
+    if (label->emitted) {
+      emit(transpiler, "  ");
+      emit_goto(transpiler, stmt);
+      return;
+    }
+
+    label->emitted = true;
+
+    if (label->target)
+      emit(transpiler, "s_%d:\n", label_id(transpiler, stmt));
+
+    transpiler->temps = 0;
+
+    if (stmt->stmt_type == STMT_ASSIGNMENT) {
+      if (is_append(transpiler, stmt->types.assignment))
+        emit_append(transpiler, stmt);
+      else
+        emit_assignment(transpiler, stmt);
+      stmt = stmt->types.assignment->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_FUNCTION_CALL) {
+      emit_call(transpiler, stmt);
+      stmt = stmt->types.function_call->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_WHILE_LOOP) {
+      //
+      // the body ends by reaching this stmt again (goto):
+      //
+      struct STMT_WHILE_LOOP* loop = stmt->types.while_loop;
+
+      emit_condition(transpiler, stmt, loop->condition, loop->next_stmt);
+      emit_stmts(transpiler, loop->loop_body);
+
+      stmt = loop->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_IF_THEN_ELSE) {
+      struct STMT_IF_THEN_ELSE* ifthen = stmt->types.if_then_else;
+
+      emit_condition(transpiler, stmt, ifthen->condition, ifthen->false_path);
+      emit_stmts(transpiler, ifthen->true_path);
+
+      stmt = ifthen->false_path;
+    }
+    else {
+      assert(stmt->stmt_type == STMT_PASS);
+
+      emit(transpiler, "  ;\n");
+      stmt = stmt->types.pass->next_stmt;
+    }
+  }//while
+
+  emit(transpiler, "  return;\n");
+}
+
+//
+// emit_declarations
+//
+// Outputs the declarations of the variables: the address for
+// a variable in memory, else its value (native, or the runtime
+// value) and whether it's defined; a variable assigned None
+// is defined. With pointers, every variable has an address. A
+// variable the program never reads is still written, so it's
+// marked as used, which keeps the C compiler quiet about it.
+//
+static void emit_declarations(struct TRANSPILER* transpiler)
+{
+  for (int i = 0; i < transpiler->num_vars; i++) {
+    struct TRANSPILE_VAR* var = &transpiler->vars[i];
+
+    if (transpiler->pointers)
+      emit(transpiler, "  int a_%s = -1;\n", var->name);
+
+    if (var->in_memory)
+      continue;
+
+    if (var->type == TYPE_DYNAMIC)
+      emit(transpiler, "  struct NUPY_VALUE v_%s = { NUPY_NONE };\n", var->name);
+    else
+      emit(transpiler, "  %s v_%s = 0;\n", c_type(var->type), var->name);
+
+    emit(transpiler, "  bool d_%s = false;\n", var->name);
+  }
+
+  for (int i = 0; i < transpiler->num_vars; i++) {
+    struct TRANSPILE_VAR* var = &transpiler->vars[i];
+
+    if (var->read || var->in_memory)
+      continue;
+
+    emit(transpiler, "  (void)v_%s;\n", var->name);
+    emit(transpiler, "  (void)d_%s;\n", var->name);
+  }
+
+  emit(transpiler, "\n");
+}
+
+
+//
+// Public functions:
+//
+
+//
+// transpile
+//
+void transpile(struct STMT* program, FILE* output)
+{
+  struct TRANSPILER transpiler;
+
+  memset(&transpiler, 0, sizeof(transpiler));
+
+  collect(&transpiler, program);
+
+  //
+  // a variable whose address is taken lives in memory, where
+  // pointers can reach it; if they can reach any variable (see
+  // escape.h), every variable does:
+  //
+  struct ESCAPE_INFO* escape = escape_analyze(program);
+
+  for (int i = 0; i < transpiler.num_vars; i++)
+    transpiler.vars[i].in_memory = escape_in_memory(escape, transpiler.vars[i].name);
+
+  escape_destroy(escape);
+
+  infer_types(&transpiler);
+
+  //
+  // a first pass finds the statements jumped to, which need
+  // labels, then the second outputs the code:
+  //
+  transpiler.output = NULL;
+  emit_stmts(&transpiler, program);
+
+  for (int i = 0; i < transpiler.num_labels; i++)
+    transpiler.labels[i].emitted = false;
+
+  transpiler.output = output;
+
+  emit(&transpiler, "//\n// generated by nuPython --transpile\n//\n");
+
+  for (int i = 0; runtime[i] != NULL; i++)
+    emit(&transpiler, "%s", runtime[i]);
+
+  emit(&transpiler, "\nstatic void nupy_program(void)\n{\n");
+
+  emit_declarations(&transpiler);
+  emit_stmts(&transpiler, program);
+
+  emit(&transpiler, "}\n\nint main(void)\n{\n  nupy_program();\n  return 0;\n}\n");
+
+  free(transpiler.vars);
+  free(transpiler.labels);
+}
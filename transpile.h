@@ -0,0 +1,52 @@
+/*transpile.h*/
+
+//
+// Ahead-of-time translation of nuPython programs to C. The
+// program graph is written out as a standalone C program,
+// which the system's C compiler can turn into a native
+// executable:
+//
+//   nupy --transpile=prog.c prog.py
+//   gcc -O2 -o prog prog.c -lm
+//
+// The C program includes a small runtime (values, strings,
+// memory for pointers, the operators, and print) with the
+// semantics and error messages of execute(), and outputs what
+// execute() would output. It compiles without warnings under
+// -Wall; bench/transpile_check.sh checks both of these against
+// a corpus of programs.
+//
+// A variable that only ever holds ints, only reals, or only
+// booleans becomes a native C local of that type. Other
+// variables are C locals holding a runtime value. A variable
+// whose address is taken (&x) lives in the runtime's memory
+// instead, so pointers can reach it; if they can reach any
+// variable (see escape.h), every variable does. Either way
+// addresses are those of execute().
+//
+// NOTE: the program starts with empty memory, and --quota is
+// not enforced.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+#pragma once
+
+#include <stdio.h>
+
+#include "programgraph.h"
+
+
+//
+// Public functions:
+//
+
+//
+// transpile
+//
+// Writes the given program graph, translated to C, to the
+// given output file.
+//
+void transpile(struct STMT* program, FILE* output);
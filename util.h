@@ -46,3 +46,47 @@ char* dupAndStripEOLN(char* s);
 // Example: icmpStrings("apple", "APPLE") returns 0
 //
 int icmpStrings(char* s1, char* s2);
+
+
+//
+// Helpers shared by the execution engines and the compilers
+// that feed them (Hajo Wolfram):
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "output.h"
+
+//
+// SCRATCH_ARENA_SIZE
+//
+// Initial size of the scratch arena an engine uses for
+// temporaries (it grows as needed, see arena.h).
+//
+#define SCRATCH_ARENA_SIZE 4096
+
+//
+// grow
+//
+// Makes sure the given array has room for one more element,
+// doubling its capacity if not. Running out of memory is fatal.
+//
+static inline void* grow(void* array, int count, int* capacity, size_t size)
+{
+  if (count < *capacity)
+    return array;
+
+  int new_capacity = (*capacity == 0) ? 16 : 2 * (*capacity);
+
+  array = realloc(array, size * new_capacity);
+  if (array == NULL) {
+    output_flush();
+    printf("**ERROR: out of memory (grow)\n");
+    exit(-1);
+  }
+
+  *capacity = new_capacity;
+
+  return array;
+}
@@ -0,0 +1,1274 @@
+/*vm.c*/
+
+//
+// Bytecode virtual machine for nuPython, see vm.h.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+// to eliminate warnings about stdlib in Visual Studio
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>  // true, false
+#include <string.h>
+#include <assert.h>
+
+#include "programgraph.h"
+#include "ram.h"
+#include "box.h"
+#include "arena.h"
+#include "output.h"
+#include "runtime.h"
+#include "builtins.h"
+#include "vm.h"
+#include "jit.h"
+#include "util.h"
+
+
+//
+// dispatch with computed goto ("labels as values") when the
+// compiler supports it, otherwise with a switch:
+//
+#if defined(__GNUC__) && !defined(VM_NO_COMPUTED_GOTO)
+#define VM_THREADED 1
+#else
+#define VM_THREADED 0
+#endif
+
+//
+// The operators with their own (quickened) instruction: for
+// each, the instruction, the operator, whether it applies to
+// strings, and what the _II and _RR forms compute (the _II
+// forms as runtime.h says ints are computed). The other
+// operators (BINOP) go through runtime_binary_op:
+//
+#define VM_QUICK_BINOPS(X)                                                      \
+  X(ADD, OPERATOR_PLUS,      true,  box_int,  box_real, +,  RUNTIME_WRAP)       \
+  X(SUB, OPERATOR_MINUS,     false, box_int,  box_real, -,  RUNTIME_WRAP)       \
+  X(MUL, OPERATOR_ASTERISK,  false, box_int,  box_real, *,  RUNTIME_WRAP)       \
+  X(EQ,  OPERATOR_EQUAL,     true,  box_bool, box_bool, ==, RUNTIME_COMPARE)    \
+  X(NE,  OPERATOR_NOT_EQUAL, true,  box_bool, box_bool, !=, RUNTIME_COMPARE)    \
+  X(LT,  OPERATOR_LT,        true,  box_bool, box_bool, <,  RUNTIME_COMPARE)    \
+  X(LE,  OPERATOR_LTE,       true,  box_bool, box_bool, <=, RUNTIME_COMPARE)    \
+  X(GT,  OPERATOR_GT,        true,  box_bool, box_bool, >,  RUNTIME_COMPARE)    \
+  X(GE,  OPERATOR_GTE,       true,  box_bool, box_bool, >=, RUNTIME_COMPARE)
+
+//
+// The _SS forms of the comparisons compare with strcmp (ADD_SS
+// concatenates, or appends in place, see its case):
+//
+#define VM_STR_COMPARES(X)                                      \
+  X(EQ, ==)                                                     \
+  X(NE, !=)                                                     \
+  X(LT, <)                                                      \
+  X(LE, <=)                                                     \
+  X(GT, >)                                                      \
+  X(GE, >=)
+
+//
+// Likewise the comparisons that branch on their result, all
+// of which apply to strings:
+//
+#define VM_QUICK_COMPARES(X)                                    \
+  X(JEQ, OPERATOR_EQUAL,     ==)                                \
+  X(JNE, OPERATOR_NOT_EQUAL, !=)                                \
+  X(JLT, OPERATOR_LT,        <)                                 \
+  X(JLE, OPERATOR_LTE,       <=)                                \
+  X(JGT, OPERATOR_GT,        >)                                 \
+  X(JGE, OPERATOR_GTE,       >=)
+
+//
+// a site that misses this often has operand types that keep
+// changing, and stays generic:
+//
+#define VM_QUICKEN_LIMIT 64
+
+//
+// instruction names, for vm_print_stats:
+//
+static const char* vm_op_names[] = {
+#define VM_NAME(op) #op,
+  VM_OPCODES(VM_NAME)
+#undef VM_NAME
+};
+
+
+//
+// While compiling, remembers where each statement's code
+// starts, so a statement reached a second time (the top of a
+// loop, or the statement after an if) becomes a jump:
+//
+struct VM_LABEL
+{
+  struct STMT* stmt;
+  int pc;
+};
+
+struct VM_COMPILER
+{
+  struct VM_PROGRAM* program;
+
+  struct VM_LABEL* labels;
+  int num_labels;
+  int label_capacity;
+};
+
+
+//
+// Private functions:
+//
+
+//
+// panic
+//
+// Outputs the given error message and exits.
+//
+static void panic(char* msg)
+{
+  output_flush();
+
+  printf("**VM ERROR\n");
+  printf("**VM ERROR: %s\n", msg);
+  printf("**VM ERROR\n");
+  exit(-1);
+}
+
+//
+// emit
+//
+// Appends an instruction to the program, and returns its
+// index (so jumps can be patched later).
+//
+static int emit(struct VM_PROGRAM* program, int op, int line, int a, int b, int c, int d)
+{
+  program->code = (struct VM_INSTR*)grow(program->code, program->num_instrs,
+    &program->code_capacity, sizeof(struct VM_INSTR));
+
+  struct VM_INSTR* instr = &program->code[program->num_instrs];
+
+  instr->op = op;
+  instr->line = line;
+  instr->a = a;
+  instr->b = b;
+  instr->c = c;
+  instr->d = d;
+
+  return program->num_instrs++;
+}
+
+//
+// add_register
+//
+// Adds a register holding the given constant, and returns
+// its index.
+//
+static int add_register(struct VM_PROGRAM* program, struct BOXED_VALUE value)
+{
+  program->registers = (struct BOXED_VALUE*)grow(program->registers, program->num_registers,
+    &program->register_capacity, sizeof(struct BOXED_VALUE));
+
+  program->registers[program->num_registers] = value;
+
+  return program->num_registers++;
+}
+
+//
+// var_slot
+//
+// Returns the slot of the variable with the given name,
+// adding a slot if this is the first reference.
+//
+static int var_slot(struct VM_PROGRAM* program, char* var_name)
+{
+  for (int i = 0; i < program->num_vars; i++)
+    if (strcmp(program->vars[i].name, var_name) == 0)
+      return i;
+
+  program->vars = (struct RUNTIME_VAR*)grow(program->vars, program->num_vars,
+    &program->var_capacity, sizeof(struct RUNTIME_VAR));
+
+  program->vars[program->num_vars].name = var_name;
+  program->vars[program->num_vars].address = -1;
+
+  return program->num_vars++;
+}
+
+//
+// add_loop
+//
+// Adds a while loop starting at the next instruction, and
+// returns its index. The body and exit are filled in as the
+// loop is compiled.
+//
+static int add_loop(struct VM_PROGRAM* program)
+{
+  program->loops = (struct VM_LOOP*)grow(program->loops, program->num_loops,
+    &program->loop_capacity, sizeof(struct VM_LOOP));
+
+  struct VM_LOOP* loop = &program->loops[program->num_loops];
+
+  loop->top = program->num_instrs;
+  loop->body = -1;
+  loop->exit = -1;
+  loop->tried = false;
+  loop->jit = NULL;
+
+  return program->num_loops++;
+}
+
+//
+// find_label
+//
+// Returns where the code for the given statement starts,
+// -1 if it hasn't been compiled yet.
+//
+static int find_label(struct VM_COMPILER* compiler, struct STMT* stmt)
+{
+  for (int i = 0; i < compiler->num_labels; i++)
+    if (compiler->labels[i].stmt == stmt)
+      return compiler->labels[i].pc;
+
+  return -1;
+}
+
+static void add_label(struct VM_COMPILER* compiler, struct STMT* stmt)
+{
+  compiler->labels = (struct VM_LABEL*)grow(compiler->labels, compiler->num_labels,
+    &compiler->label_capacity, sizeof(struct VM_LABEL));
+
+  compiler->labels[compiler->num_labels].stmt = stmt;
+  compiler->labels[compiler->num_labels].pc = compiler->program->num_instrs;
+  compiler->num_labels++;
+}
+
+//
+// emits_code
+//
+// Returns true if compiling the given unary expression emits
+// instructions, false if its value is simply an operand (a
+// variable or a constant).
+//
+static bool emits_code(struct UNARY_EXPR* unary)
+{
+  if (unary->expr_type != UNARY_ELEMENT)
+    return true;
+
+  return unary->element->element_type == ELEMENT_NONE;
+}
+
+//
+// compile_element
+//
+// Compiles a basic element --- an identifier or a literal ---
+// and returns the operand that holds its value: a variable,
+// or a constant register.
+//
+static int compile_element(struct VM_PROGRAM* program, int line, struct ELEMENT* element, int temp)
+{
+  char* literal = element->element_value;
+
+  switch (element->element_type) {
+  case ELEMENT_IDENTIFIER:
+    return VM_VAR_OPERAND(var_slot(program, literal));
+
+  case ELEMENT_INT_LITERAL:
+    return add_register(program, box_int(atoi(literal)));
+
+  case ELEMENT_REAL_LITERAL:
+    return add_register(program, box_real(atof(literal)));
+
+  case ELEMENT_STR_LITERAL:
+    return add_register(program, box_str(literal));
+
+  case ELEMENT_TRUE:
+    return add_register(program, box_bool(true));
+
+  case ELEMENT_FALSE:
+    return add_register(program, box_bool(false));
+
+  default:
+    emit(program, VM_FAIL_ELEMENT, line, 0, 0, 0, 0);
+    return temp;
+  }
+}
+
+//
+// compile_call
+//
+// Compiles a call of a builtin function, which computes what
+// the function returns into the given operand. The function
+// is looked up now, once; calling one we don't have is an
+// error when the call executes.
+//
+static void compile_call(struct VM_PROGRAM* program, int line, char* function_name, struct ELEMENT* parameter, int dest)
+{
+  int index = builtin_lookup(function_name);
+
+  if (index < 0) {
+    int name = add_register(program, box_str(function_name));
+
+    emit(program, VM_FAIL_CALL, line, name, 0, 0, 0);
+    return;
+  }
+
+  int arg = 0;
+  int num_args = 0;
+
+  if (parameter != NULL) {
+    arg = compile_element(program, line, parameter, VM_REG_RHS);
+    num_args = 1;
+  }
+
+  emit(program, VM_CALL, line, dest, index, arg, num_args);
+}
+
+//
+// compile_unary
+//
+// Compiles a unary expression, returning the operand that
+// holds its value. & and * compute their value into the given
+// operand (see compile_element for the others).
+//
+static int compile_unary(struct VM_PROGRAM* program, int line, struct UNARY_EXPR* unary, int temp)
+{
+  struct ELEMENT* element = unary->element;
+
+  switch (unary->expr_type) {
+  case UNARY_ELEMENT:
+    return compile_element(program, line, element, temp);
+
+  case UNARY_ADDRESS_OF:
+    emit(program, VM_ADDR, line, temp, var_slot(program, element->element_value), 0, 0);
+    return temp;
+
+  case UNARY_PTR_DEREF:
+    emit(program, VM_DEREF, line, temp, var_slot(program, element->element_value), 0, 0);
+    return temp;
+
+  default:
+    emit(program, VM_FAIL_UNARY, line, 0, 0, 0, 0);
+    return temp;
+  }
+}
+
+//
+// binop
+//
+// Returns the instruction for the given binary operator.
+//
+static int binop(int operator)
+{
+  switch (operator) {
+#define VM_BINOP_OPCODE(op, operator, str, int_box, real_box, c_op, int_op) case operator: return VM_##op;
+    VM_QUICK_BINOPS(VM_BINOP_OPCODE)
+#undef VM_BINOP_OPCODE
+  default:
+    return VM_BINOP;
+  }
+}
+
+//
+// compare
+//
+// Returns the compare-and-branch instruction for the given
+// operator, -1 if there is none.
+//
+static int compare(int operator)
+{
+  switch (operator) {
+#define VM_COMPARE_OPCODE(op, operator, c_op) case operator: return VM_##op;
+    VM_QUICK_COMPARES(VM_COMPARE_OPCODE)
+#undef VM_COMPARE_OPCODE
+  default:
+    return -1;
+  }
+}
+
+//
+// quicken
+//
+// Returns the form of the given operator instruction to use
+// for the given operands: the quickened form for their types
+// if there is one, else the (generic) instruction itself.
+//
+static int quicken(int op, struct BOXED_VALUE lhs, struct BOXED_VALUE rhs, bool str)
+{
+  int lhs_type = unbox_type(lhs);
+  int rhs_type = unbox_type(rhs);
+
+  if (lhs_type != rhs_type)
+    return op;
+
+  switch (lhs_type) {
+  case RAM_TYPE_INT:
+    return op + VM_QUICK_II;
+
+  case RAM_TYPE_REAL:
+    return op + VM_QUICK_RR;
+
+  case RAM_TYPE_STR:
+    return str ? op + VM_QUICK_SS : op;
+
+  default:
+    return op;
+  }
+}
+
+//
+// compile_operands
+//
+// Compiles the lhs and rhs of a binary expression, returning
+// the operands that hold their values.
+//
+static void compile_operands(struct VM_PROGRAM* program, int line, struct VALUE_EXPR* expr, int* lhs, int* rhs)
+{
+  assert(expr->rhs != NULL);
+  assert(expr->operator != OPERATOR_NO_OP);
+
+  *lhs = compile_unary(program, line, expr->lhs, VM_REG_LHS);
+
+  //
+  // the lhs is evaluated first: if the rhs has code of its
+  // own (which could fail), read the lhs variable beforehand
+  // so errors are reported in the same order:
+  //
+  if (*lhs < 0 && emits_code(expr->rhs)) {
+    emit(program, VM_MOVE, line, VM_REG_LHS, *lhs, 0, 0);
+    *lhs = VM_REG_LHS;
+  }
+
+  *rhs = compile_unary(program, line, expr->rhs, VM_REG_RHS);
+}
+
+//
+// compile_expr
+//
+// Compiles a unary or binary expression whose value goes to
+// the given operand.
+//
+static void compile_expr(struct VM_PROGRAM* program, int line, struct VALUE_EXPR* expr, int dest)
+{
+  assert(expr->lhs != NULL);
+
+  if (!expr->isBinaryExpr) {
+    int value = compile_unary(program, line, expr->lhs, dest);
+
+    if (value != dest)
+      emit(program, VM_MOVE, line, dest, value, 0, 0);
+
+    return;
+  }
+
+  int lhs, rhs;
+
+  compile_operands(program, line, expr, &lhs, &rhs);
+
+  emit(program, binop(expr->operator), line, dest, lhs, expr->operator, rhs);
+}
+
+//
+// compile_branch
+//
+// Compiles the condition of an if or while, followed by a
+// branch to the given target if its truth value is the given
+// one. Returns the index of the branch instruction, so the
+// target can be patched later.
+//
+static int compile_branch(struct VM_PROGRAM* program, int line, struct VALUE_EXPR* condition, bool truth, int target)
+{
+  assert(condition->lhs != NULL);
+
+  if (!condition->isBinaryExpr) {
+    int value = compile_unary(program, line, condition->lhs, VM_REG_LHS);
+
+    return emit(program, VM_JUMPIF, line, target, value, truth, 0);
+  }
+
+  int op = compare(condition->operator);
+
+  if (op < 0) {
+    compile_expr(program, line, condition, VM_REG_LHS);
+
+    return emit(program, VM_JUMPIF, line, target, VM_REG_LHS, truth, 0);
+  }
+
+  int lhs, rhs;
+
+  compile_operands(program, line, condition, &lhs, &rhs);
+
+  return emit(program, op, line, target, lhs, truth, rhs);
+}
+
+//
+// compile_stmts
+//
+// Compiles the statements starting from the given one, until
+// we fall off the end of the program (HALT) or reach a
+// statement that has already been compiled (JUMP).
+//
+static void compile_stmts(struct VM_COMPILER* compiler, struct STMT* stmt)
+{
+  struct VM_PROGRAM* program = compiler->program;
+
+  while (stmt != NULL) {
+
+    int pc = find_label(compiler, stmt);
+
+    if (pc >= 0 && stmt->stmt_type == STMT_WHILE_LOOP) {
+      //
+      // the end of a loop body: test the condition here and
+      // go straight back to the body, so each iteration needs
+      // no jump back to the top. On exit, the top tests the
+      // condition once more and leaves the loop:
+      //
+      struct STMT_WHILE_LOOP* loop = stmt->types.while_loop;
+
+      compile_branch(program, stmt->line, loop->condition, true, find_label(compiler, loop->loop_body));
+      emit(program, VM_JUMP, stmt->line, pc, 0, 0, 0);
+      return;
+    }
+
+    if (pc >= 0) {
+      emit(program, VM_JUMP, stmt->line, pc, 0, 0, 0);
+      return;
+    }
+
+    add_label(compiler, stmt);
+
+    int line = stmt->line;
+
+    if (stmt->stmt_type == STMT_ASSIGNMENT) {
+
+      struct STMT_ASSIGNMENT* assign = stmt->types.assignment;
+
+      int slot = var_slot(program, assign->var_name);
+      int dest = assign->isPtrDeref ? VM_REG_LHS : VM_VAR_OPERAND(slot);
+
+      if (assign->rhs->value_type == VALUE_FUNCTION_CALL) {
+        struct VALUE_FUNCTION_CALL* call = assign->rhs->types.function_call;
+
+        compile_call(program, line, call->function_name, call->parameter, dest);
+      }
+      else {
+        compile_expr(program, line, assign->rhs->types.expr, dest);
+      }
+
+      if (assign->isPtrDeref)
+        emit(program, VM_STOREP, line, slot, VM_REG_LHS, 0, 0);
+
+      stmt = assign->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_FUNCTION_CALL) {
+
+      struct STMT_FUNCTION_CALL* call = stmt->types.function_call;
+
+      //
+      // print has instructions of its own; any other function
+      // is called, and what it returns is discarded:
+      //
+      if (strcmp(call->function_name, "print") != 0) {
+        compile_call(program, line, call->function_name, call->parameter, VM_REG_LHS);
+      }
+      else if (call->parameter == NULL) {
+        emit(program, VM_PRINTNL, line, 0, 0, 0, 0);
+      }
+      else {
+        int value = compile_element(program, line, call->parameter, VM_REG_LHS);
+        emit(program, VM_PRINT, line, value, 0, 0, 0);
+      }
+
+      stmt = call->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_WHILE_LOOP) {
+
+      //
+      // the body ends by reaching this stmt again, which
+      // compiles to a test of the condition (see above):
+      //
+      struct STMT_WHILE_LOOP* loop = stmt->types.while_loop;
+
+      int index = add_loop(program);
+
+      emit(program, VM_LOOP, line, index, 0, 0, 0);
+
+      int exit = compile_branch(program, line, loop->condition, false, -1);
+
+      program->loops[index].body = program->num_instrs;
+
+      compile_stmts(compiler, loop->loop_body);
+
+      program->code[exit].a = program->num_instrs;
+      program->loops[index].exit = program->num_instrs;
+
+      stmt = loop->next_stmt;
+    }
+    else if (stmt->stmt_type == STMT_IF_THEN_ELSE) {
+
+      //
+      // the true path goes on to the stmts after the if, so
+      // they are compiled there; the false path then reaches
+      // them again, and jumps:
+      //
+      struct STMT_IF_THEN_ELSE* ifthen = stmt->types.if_then_else;
+
+      int otherwise = compile_branch(program, line, ifthen->condition, false, -1);
+
+      compile_stmts(compiler, ifthen->true_path);
+
+      program->code[otherwise].a = program->num_instrs;
+
+      stmt = ifthen->false_path;
+    }
+    else {
+      assert(stmt->stmt_type == STMT_PASS);
+
+      stmt = stmt->types.pass->next_stmt;
+    }
+  }//while
+
+  emit(program, VM_HALT, 0, 0, 0, 0, 0);
+}
+
+//
+// Public functions:
+//
+
+//
+// vm_compile
+//
+struct VM_PROGRAM* vm_compile(struct STMT* program)
+{
+  struct VM_PROGRAM* compiled = (struct VM_PROGRAM*)calloc(1, sizeof(struct VM_PROGRAM));
+  if (compiled == NULL)
+    panic("out of memory (vm_compile)");
+
+  //
+  // the temporaries come first:
+  //
+  add_register(compiled, box_none());  // VM_REG_LHS
+  add_register(compiled, box_none());  // VM_REG_RHS
+
+  struct VM_COMPILER compiler;
+
+  compiler.program = compiled;
+  compiler.labels = NULL;
+  compiler.num_labels = 0;
+  compiler.label_capacity = 0;
+
+  compile_stmts(&compiler, program);
+
+  free(compiler.labels);
+
+  compiled->sites = (struct VM_SITE*)calloc(compiled->num_instrs, sizeof(struct VM_SITE));
+  if (compiled->sites == NULL)
+    panic("out of memory (vm_compile)");
+
+  return compiled;
+}
+
+//
+// vm_execute
+//
+void vm_execute(struct VM_PROGRAM* program, struct RAM* memory)
+{
+#if VM_THREADED
+  static void* dispatch[VM_NUM_OPS] = {
+#define VM_LABEL_ADDR(op) &&op_##op,
+    VM_OPCODES(VM_LABEL_ADDR)
+#undef VM_LABEL_ADDR
+  };
+
+#define VM_CASE(op)     op_##op:
+#define VM_NEXT()       goto *dispatch[ip->op]
+#define VM_BEGIN()      VM_NEXT();
+#define VM_END()
+#else
+#define VM_CASE(op)     case VM_##op:
+#define VM_NEXT()       continue
+#define VM_BEGIN()      for (;;) switch (ip->op) {
+#define VM_END()        default: panic("unknown instruction (vm_execute)"); }
+#endif
+
+//
+// reads an operand into value; a variable must exist:
+//
+#define VM_READ(value, operand)                                     \
+  do {                                                              \
+    int _operand = (operand);                                       \
+    if (_operand >= 0)                                              \
+      value = reg[_operand];                                        \
+    else {                                                          \
+      int _slot = VM_OPERAND_SLOT(_operand);                        \
+      int _address = runtime_lookup(memory, &vars[_slot]);          \
+      if (_address < 0) {                                           \
+        status = RUNTIME_UNDEFINED;                                 \
+        var_name = vars[_slot].name;                                \
+        goto failed;                                                \
+      }                                                             \
+      value = runtime_read_cell(memory, _address);                  \
+    }                                                               \
+  } while (0)
+
+//
+// writes value to an operand; writing a variable ends the
+// statement, so the scratch arena is reset:
+//
+#define VM_WRITE(operand, value)                                    \
+  do {                                                              \
+    int _operand = (operand);                                       \
+    if (_operand >= 0)                                              \
+      reg[_operand] = value;                                        \
+    else {                                                          \
+      int _slot = VM_OPERAND_SLOT(_operand);                        \
+      status = runtime_store(memory, &vars[_slot], value);          \
+      if (scratch->used > 0)                                        \
+        arena_reset(scratch);                                       \
+      if (status != RUNTIME_OK) {                                   \
+        var_name = vars[_slot].name;                                \
+        goto failed;                                                \
+      }                                                             \
+    }                                                               \
+  } while (0)
+
+  struct BOXED_VALUE* reg = program->registers;
+  struct RUNTIME_VAR* vars = program->vars;
+  struct VM_INSTR* code = program->code;
+  struct VM_INSTR* ip = code;
+  struct VM_SITE* sites = program->sites;
+
+  int   status = RUNTIME_OK;
+  char* var_name = NULL;
+
+  //
+  // addresses depend on the memory, so look them up again:
+  //
+  for (int i = 0; i < program->num_vars; i++)
+    program->vars[i].address = -1;
+
+  //
+  // start accounting from what memory holds now:
+  //
+  runtime_begin(memory);
+
+  //
+  // temporaries come from a scratch arena that is reset
+  // after every statement:
+  //
+  struct ARENA* scratch = arena_create(SCRATCH_ARENA_SIZE);
+
+  VM_BEGIN()
+
+  VM_CASE(MOVE)
+  {
+    struct BOXED_VALUE value;
+
+    VM_READ(value, ip->b);
+    VM_WRITE(ip->a, value);
+
+    ip++;
+    VM_NEXT();
+  }
+
+  VM_CASE(ADDR)
+  {
+    int address = runtime_lookup(memory, &vars[ip->b]);
+
+    if (address < 0) {
+      status = RUNTIME_UNDEFINED;
+      var_name = vars[ip->b].name;
+      goto failed;
+    }
+
+    VM_WRITE(ip->a, box_ptr(address));
+
+    ip++;
+    VM_NEXT();
+  }
+
+  VM_CASE(DEREF)
+  {
+    struct BOXED_VALUE ptr;
+
+    VM_READ(ptr, VM_VAR_OPERAND(ip->b));
+
+    status = runtime_check_ptr(memory, ptr);
+    if (status != RUNTIME_OK) {
+      var_name = vars[ip->b].name;
+      goto failed;
+    }
+
+    VM_WRITE(ip->a, runtime_read_cell(memory, unbox_int(ptr)));
+
+    ip++;
+    VM_NEXT();
+  }
+
+  VM_CASE(STOREP)
+  {
+    struct BOXED_VALUE value;
+    struct BOXED_VALUE ptr;
+
+    VM_READ(value, ip->b);
+    VM_READ(ptr, VM_VAR_OPERAND(ip->a));
+
+    status = runtime_check_ptr(memory, ptr);
+
+    if (status == RUNTIME_OK)
+      status = runtime_write_cell_by_addr(memory, value, unbox_int(ptr));
+
+    if (scratch->used > 0)
+      arena_reset(scratch);
+
+    if (status != RUNTIME_OK) {
+      var_name = vars[ip->a].name;
+      goto failed;
+    }
+
+    ip++;
+    VM_NEXT();
+  }
+
+  VM_CASE(BINOP)
+  {
+    struct BOXED_VALUE lhs;
+    struct BOXED_VALUE rhs;
+
+    VM_READ(lhs, ip->b);
+    VM_READ(rhs, ip->d);
+
+    status = runtime_binary_op(scratch, &lhs, ip->c, &rhs);
+    if (status != RUNTIME_OK)
+      goto failed;
+
+    VM_WRITE(ip->a, lhs);
+
+    ip++;
+    VM_NEXT();
+  }
+
+//
+// An operator instruction, in its generic form: counts a miss,
+// quickens the instruction for the operand types (unless the
+// site has missed too often), and performs the operation with
+// runtime_binary_op. A quickened form checks the operand types
+// and, if they are not the ones it is for, reverts to the
+// generic form and dispatches again:
+//
+#define VM_QUICK_BINOP_CASES(kind, operator, str, int_box, real_box, c_op, int_op) \
+  VM_CASE(kind)                                                     \
+  {                                                                 \
+    struct BOXED_VALUE lhs;                                         \
+    struct BOXED_VALUE rhs;                                         \
+                                                                    \
+    VM_READ(lhs, ip->b);                                            \
+    VM_READ(rhs, ip->d);                                            \
+                                                                    \
+    if (++sites[ip - code].misses <= VM_QUICKEN_LIMIT)              \
+      ip->op = quicken(VM_##kind, lhs, rhs, str);                   \
+                                                                    \
+    status = runtime_binary_op(scratch, &lhs, operator, &rhs);      \
+    if (status != RUNTIME_OK)                                       \
+      goto failed;                                                  \
+                                                                    \
+    VM_WRITE(ip->a, lhs);                                           \
+                                                                    \
+    ip++;                                                           \
+    VM_NEXT();                                                      \
+  }                                                                 \
+                                                                    \
+  VM_CASE(kind##_II)                                                \
+  {                                                                 \
+    struct BOXED_VALUE lhs;                                         \
+    struct BOXED_VALUE rhs;                                         \
+                                                                    \
+    VM_READ(lhs, ip->b);                                            \
+    VM_READ(rhs, ip->d);                                            \
+                                                                    \
+    if (unbox_type(lhs) != RAM_TYPE_INT ||                          \
+      unbox_type(rhs) != RAM_TYPE_INT)                              \
+    {                                                               \
+      ip->op = VM_##kind;                                           \
+      VM_NEXT();                                                    \
+    }                                                               \
+                                                                    \
+    sites[ip - code].hits++;                                        \
+                                                                    \
+    VM_WRITE(ip->a,                                                 \
+      int_box(int_op(unbox_int(lhs), c_op, unbox_int(rhs))));       \
+                                                                    \
+    ip++;                                                           \
+    VM_NEXT();                                                      \
+  }                                                                 \
+                                                                    \
+  VM_CASE(kind##_RR)                                                \
+  {                                                                 \
+    struct BOXED_VALUE lhs;                                         \
+    struct BOXED_VALUE rhs;                                         \
+                                                                    \
+    VM_READ(lhs, ip->b);                                            \
+    VM_READ(rhs, ip->d);                                            \
+                                                                    \
+    if (unbox_type(lhs) != RAM_TYPE_REAL ||                         \
+      unbox_type(rhs) != RAM_TYPE_REAL)                             \
+    {                                                               \
+      ip->op = VM_##kind;                                           \
+      VM_NEXT();                                                    \
+    }                                                               \
+                                                                    \
+    sites[ip - code].hits++;                                        \
+                                                                    \
+    VM_WRITE(ip->a,                                                 \
+      real_box(unbox_real(lhs) c_op unbox_real(rhs)));              \
+                                                                    \
+    ip++;                                                           \
+    VM_NEXT();                                                      \
+  }
+  VM_QUICK_BINOPS(VM_QUICK_BINOP_CASES)
+#undef VM_QUICK_BINOP_CASES
+
+#define VM_STR_COMPARE_CASE(kind, c_op)                             \
+  VM_CASE(kind##_SS)                                                \
+  {                                                                 \
+    struct BOXED_VALUE lhs;                                         \
+    struct BOXED_VALUE rhs;                                         \
+                                                                    \
+    VM_READ(lhs, ip->b);                                            \
+    VM_READ(rhs, ip->d);                                            \
+                                                                    \
+    if (unbox_type(lhs) != RAM_TYPE_STR ||                          \
+      unbox_type(rhs) != RAM_TYPE_STR)                              \
+    {                                                               \
+      ip->op = VM_##kind;                                           \
+      VM_NEXT();                                                    \
+    }                                                               \
+                                                                    \
+    sites[ip - code].hits++;                                        \
+                                                                    \
+    int order = strcmp(unbox_str(lhs), unbox_str(rhs));             \
+                                                                    \
+    VM_WRITE(ip->a, box_bool(order c_op 0));                        \
+                                                                    \
+    ip++;                                                           \
+    VM_NEXT();                                                      \
+  }
+  VM_STR_COMPARES(VM_STR_COMPARE_CASE)
+#undef VM_STR_COMPARE_CASE
+
+  VM_CASE(ADD_SS)
+  {
+    struct BOXED_VALUE lhs;
+    struct BOXED_VALUE rhs;
+    struct BOXED_VALUE result;
+
+    VM_READ(lhs, ip->b);
+    VM_READ(rhs, ip->d);
+
+    if (unbox_type(lhs) != RAM_TYPE_STR ||
+      unbox_type(rhs) != RAM_TYPE_STR)
+    {
+      ip->op = VM_ADD;
+      VM_NEXT();
+    }
+
+    sites[ip - code].hits++;
+
+    if (ip->a == ip->b && ip->a < 0 && unbox_str(lhs) != unbox_str(rhs)) {
+      //
+      // s = s + rhs: append in place (VM_READ found the address):
+      //
+      status = runtime_append(memory, vars[VM_OPERAND_SLOT(ip->a)].address, unbox_str(rhs));
+      if (scratch->used > 0)
+        arena_reset(scratch);
+      if (status != RUNTIME_OK)
+        goto failed;
+
+      ip++;
+      VM_NEXT();
+    }
+
+    status = runtime_concat(scratch, &result, unbox_str(lhs), unbox_str(rhs));
+    if (status != RUNTIME_OK)
+      goto failed;
+
+    VM_WRITE(ip->a, result);
+
+    ip++;
+    VM_NEXT();
+  }
+
+  VM_CASE(PRINT)
+  {
+    struct BOXED_VALUE value;
+
+    VM_READ(value, ip->a);
+
+    status = runtime_print(value);
+    if (status != RUNTIME_OK)
+      goto failed;
+
+    ip++;
+    VM_NEXT();
+  }
+
+  VM_CASE(PRINTNL)
+  {
+    output_char('\n');
+    ip++;
+    VM_NEXT();
+  }
+
+  VM_CASE(CALL)
+  {
+    struct BOXED_VALUE args[BUILTIN_MAX_ARGS];
+    struct BOXED_VALUE result;
+
+    if (ip->d > 0)
+      VM_READ(args[0], ip->c);
+
+    struct BUILTIN* builtin = builtin_get(ip->b);
+
+    status = builtin_call(builtin, scratch, args, ip->d, &result);
+    if (status != RUNTIME_OK) {
+      var_name = builtin->name;
+      goto failed;
+    }
+
+    VM_WRITE(ip->a, result);
+
+    ip++;
+    VM_NEXT();
+  }
+
+  VM_CASE(JUMP)
+  {
+    ip = code + ip->a;
+    VM_NEXT();
+  }
+
+  VM_CASE(LOOP)
+  {
+    struct VM_LOOP* loop = &program->loops[ip->a];
+
+    if (jit_enabled()) {
+      if (!loop->tried) {
+        loop->jit = jit_compile(program, loop, memory);
+        loop->tried = true;
+      }
+
+      //
+      // the machine code runs the whole loop, unless the
+      // variables no longer have the types it was compiled
+      // for:
+      //
+      if (loop->jit != NULL && jit_execute(loop->jit, program, memory)) {
+        ip = code + loop->exit;
+        VM_NEXT();
+      }
+    }
+
+    ip++;
+    VM_NEXT();
+  }
+
+  VM_CASE(JUMPIF)
+  {
+    struct BOXED_VALUE value;
+
+    VM_READ(value, ip->b);
+
+    bool condition = (unbox_type(value) == RAM_TYPE_BOOLEAN) ?
+      (unbox_int(value) != 0) : runtime_is_true(value);
+
+    if (scratch->used > 0)
+      arena_reset(scratch);
+
+    ip = (condition == ip->c) ? code + ip->a : ip + 1;
+    VM_NEXT();
+  }
+
+//
+// Likewise the comparisons that branch on their result:
+//
+#define VM_QUICK_COMPARE_CASES(kind, operator, c_op)                \
+  VM_CASE(kind)                                                     \
+  {                                                                 \
+    struct BOXED_VALUE lhs;                                         \
+    struct BOXED_VALUE rhs;                                         \
+                                                                    \
+    VM_READ(lhs, ip->b);                                            \
+    VM_READ(rhs, ip->d);                                            \
+                                                                    \
+    if (++sites[ip - code].misses <= VM_QUICKEN_LIMIT)              \
+      ip->op = quicken(VM_##kind, lhs, rhs, true);                  \
+                                                                    \
+    status = runtime_binary_op(scratch, &lhs, operator, &rhs);      \
+    if (status != RUNTIME_OK)                                       \
+      goto failed;                                                  \
+                                                                    \
+    bool condition = runtime_is_true(lhs);                          \
+                                                                    \
+    if (scratch->used > 0)                                          \
+      arena_reset(scratch);                                         \
+                                                                    \
+    ip = (condition == ip->c) ? code + ip->a : ip + 1;              \
+    VM_NEXT();                                                      \
+  }                                                                 \
+                                                                    \
+  VM_CASE(kind##_II)                                                \
+  {                                                                 \
+    struct BOXED_VALUE lhs;                                         \
+    struct BOXED_VALUE rhs;                                         \
+                                                                    \
+    VM_READ(lhs, ip->b);                                            \
+    VM_READ(rhs, ip->d);                                            \
+                                                                    \
+    if (unbox_type(lhs) != RAM_TYPE_INT ||                          \
+      unbox_type(rhs) != RAM_TYPE_INT)                              \
+    {                                                               \
+      ip->op = VM_##kind;                                           \
+      VM_NEXT();                                                    \
+    }                                                               \
+                                                                    \
+    sites[ip - code].hits++;                                        \
+                                                                    \
+    bool condition = (unbox_int(lhs) c_op unbox_int(rhs));          \
+                                                                    \
+    ip = (condition == ip->c) ? code + ip->a : ip + 1;              \
+    VM_NEXT();                                                      \
+  }                                                                 \
+                                                                    \
+  VM_CASE(kind##_RR)                                                \
+  {                                                                 \
+    struct BOXED_VALUE lhs;                                         \
+    struct BOXED_VALUE rhs;                                         \
+                                                                    \
+    VM_READ(lhs, ip->b);                                            \
+    VM_READ(rhs, ip->d);                                            \
+                                                                    \
+    if (unbox_type(lhs) != RAM_TYPE_REAL ||                         \
+      unbox_type(rhs) != RAM_TYPE_REAL)                             \
+    {                                                               \
+      ip->op = VM_##kind;                                           \
+      VM_NEXT();                                                    \
+    }                                                               \
+                                                                    \
+    sites[ip - code].hits++;                                        \
+                                                                    \
+    bool condition = (unbox_real(lhs) c_op unbox_real(rhs));        \
+                                                                    \
+    ip = (condition == ip->c) ? code + ip->a : ip + 1;              \
+    VM_NEXT();                                                      \
+  }                                                                 \
+                                                                    \
+  VM_CASE(kind##_SS)                                                \
+  {                                                                 \
+    struct BOXED_VALUE lhs;                                         \
+    struct BOXED_VALUE rhs;                                         \
+                                                                    \
+    VM_READ(lhs, ip->b);                                            \
+    VM_READ(rhs, ip->d);                                            \
+                                                                    \
+    if (unbox_type(lhs) != RAM_TYPE_STR ||                          \
+      unbox_type(rhs) != RAM_TYPE_STR)                              \
+    {                                                               \
+      ip->op = VM_##kind;                                           \
+      VM_NEXT();                                                    \
+    }                                                               \
+                                                                    \
+    sites[ip - code].hits++;                                        \
+                                                                    \
+    int order = strcmp(unbox_str(lhs), unbox_str(rhs));             \
+    bool condition = (order c_op 0);                                \
+                                                                    \
+    ip = (condition == ip->c) ? code + ip->a : ip + 1;              \
+    VM_NEXT();                                                      \
+  }
+  VM_QUICK_COMPARES(VM_QUICK_COMPARE_CASES)
+#undef VM_QUICK_COMPARE_CASES
+
+  VM_CASE(FAIL_UNARY)
+  {
+    status = RUNTIME_UNSUPPORTED_UNARY;
+    goto failed;
+  }
+
+  VM_CASE(FAIL_ELEMENT)
+  {
+    status = RUNTIME_UNEXPECTED_ELEMENT;
+    goto failed;
+  }
+
+  VM_CASE(FAIL_CALL)
+  {
+    status = RUNTIME_UNDEFINED;
+    var_name = unbox_str(reg[ip->a]);
+    goto failed;
+  }
+
+  VM_CASE(HALT)
+  {
+    goto done;
+  }
+
+  VM_END()
+
+failed:
+  runtime_report(status, var_name, ip->line);
+
+done:
+  arena_destroy(scratch);
+
+  runtime_end();
+
+#undef VM_READ
+#undef VM_WRITE
+#undef VM_CASE
+#undef VM_NEXT
+#undef VM_BEGIN
+#undef VM_END
+}
+
+//
+// vm_print_stats
+//
+void vm_print_stats(struct VM_PROGRAM* program)
+{
+  printf("**VM STATS**\n");
+
+  for (int pc = 0; pc < program->num_instrs; pc++) {
+    struct VM_INSTR* instr = &program->code[pc];
+    struct VM_SITE* site = &program->sites[pc];
+
+    if (site->hits == 0 && site->misses == 0)
+      continue;
+
+    printf(" %d: line %d, %s, %llu hits, %llu misses\n",
+      pc, instr->line, vm_op_names[instr->op], site->hits, site->misses);
+  }
+
+  printf("**END STATS**\n");
+}
+
+//
+// vm_destroy
+//
+void vm_destroy(struct VM_PROGRAM* program)
+{
+  if (program == NULL)
+    panic("program ptr is null (vm_destroy)");
+
+  free(program->code);
+  free(program->registers);
+  for (int i = 0; i < program->num_loops; i++)
+    if (program->loops[i].jit != NULL)
+      jit_free(program->loops[i].jit);
+
+  free(program->vars);
+  free(program->sites);
+  free(program->loops);
+  free(program);
+}
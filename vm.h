@@ -0,0 +1,250 @@
+/*vm.h*/
+
+//
+// Bytecode virtual machine for nuPython. The program graph is
+// compiled once into a flat array of instructions over a small
+// register file, and the instructions are then executed in a
+// tight dispatch loop. Compared to walking the program graph,
+// this avoids re-examining the shape of every statement and
+// expression each time it executes, re-parsing literals, and
+// searching memory by name for every variable reference.
+//
+// Registers 0 and 1 hold temporaries (the lhs and rhs of an
+// expression); the remaining registers hold the program's
+// constants, which are converted from their literal text at
+// compile time.
+//
+// Every variable referenced by the program is given a slot
+// (see struct RUNTIME_VAR), and instructions read and write
+// variables directly, so "i = i + 1" is a single instruction.
+//
+// Operators are quickened: the first time an instruction
+// executes, it rewrites itself into a form specialized for the
+// operand types it sees (e.g. ADD becomes ADD_II for two ints),
+// which checks the types and computes inline. If the check
+// fails, the instruction reverts to the generic form, which
+// quickens it again for the new types. Each such instruction
+// (a site) counts its hits and misses, see vm_print_stats.
+//
+// The semantics --- operators, truth values, printing, and the
+// error messages --- are those of the tree-walking executor,
+// since both go through runtime.h.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+#pragma once
+
+#include <stdbool.h>  // true, false
+
+#include "programgraph.h"
+#include "ram.h"
+#include "box.h"
+#include "runtime.h"
+
+
+//
+// The instruction set, as an X-macro so the enum and the
+// dispatch table are generated from the same list. Operands
+// (and the results of MOVE, ADDR, DEREF and the operators)
+// are registers or variables, see VM_VAR_OPERAND:
+//
+//   MOVE     a = b
+//   ADDR     a = address of variable slot b (&x)
+//   DEREF    a = value at the address in variable slot b (*p)
+//   STOREP   value at the address in variable slot a = b
+//   BINOP    a = b <operator c> d
+//   ADD ...  as BINOP, specialized for the operator at compile
+//   ... GE   time, and quickened at run time (see below)
+//   PRINT    print a
+//   PRINTNL  print an empty line
+//   CALL     a = builtin b (see builtins.h) called with d
+//            arguments, the first in c
+//   JUMP     continue at instruction a
+//   JUMPIF   if the truth value of b is c, continue at
+//            instruction a
+//   LOOP     the top of while loop a, see struct VM_LOOP: if
+//            the loop has been compiled to machine code (see
+//            jit.h), runs it instead of the instructions below
+//   JEQ ...  if (b <operator> d) is c, continue at instruction
+//   ... JGE  a: a comparison and JUMPIF in one instruction,
+//            quickened like ADD ... GE
+//   FAIL_UNARY    unary operator we don't support (error)
+//   FAIL_ELEMENT  element we can't evaluate (error)
+//   FAIL_CALL     function we don't have, named by the string
+//                 in constant register a (error)
+//   HALT     end of program
+//
+// An operator instruction is followed by its quickened forms,
+// in the order of enum VM_QUICK_FORMS: _II for int operands,
+// _RR for real operands, and, where the operator applies to
+// strings, _SS for string operands.
+//
+#define VM_OPCODES(X)            \
+  X(MOVE)                        \
+  X(ADDR)                        \
+  X(DEREF)                       \
+  X(STOREP)                      \
+  X(BINOP)                       \
+  VM_QUICKENED_SS(X, ADD)        \
+  VM_QUICKENED(X, SUB)           \
+  VM_QUICKENED(X, MUL)           \
+  VM_QUICKENED_SS(X, EQ)         \
+  VM_QUICKENED_SS(X, NE)         \
+  VM_QUICKENED_SS(X, LT)         \
+  VM_QUICKENED_SS(X, LE)         \
+  VM_QUICKENED_SS(X, GT)         \
+  VM_QUICKENED_SS(X, GE)         \
+  X(PRINT)                       \
+  X(PRINTNL)                     \
+  X(CALL)                        \
+  X(JUMP)                        \
+  X(JUMPIF)                      \
+  X(LOOP)                        \
+  VM_QUICKENED_SS(X, JEQ)        \
+  VM_QUICKENED_SS(X, JNE)        \
+  VM_QUICKENED_SS(X, JLT)        \
+  VM_QUICKENED_SS(X, JLE)        \
+  VM_QUICKENED_SS(X, JGT)        \
+  VM_QUICKENED_SS(X, JGE)        \
+  X(FAIL_UNARY)                  \
+  X(FAIL_ELEMENT)                \
+  X(FAIL_CALL)                   \
+  X(HALT)
+
+#define VM_QUICKENED(X, op)     X(op) X(op##_II) X(op##_RR)
+#define VM_QUICKENED_SS(X, op)  X(op) X(op##_II) X(op##_RR) X(op##_SS)
+
+enum VM_OPS
+{
+#define VM_ENUM(op) VM_##op,
+  VM_OPCODES(VM_ENUM)
+#undef VM_ENUM
+  VM_NUM_OPS
+};
+
+//
+// A quickened form is the generic instruction + one of these:
+//
+enum VM_QUICK_FORMS
+{
+  VM_QUICK_II = 1,
+  VM_QUICK_RR,
+  VM_QUICK_SS
+};
+
+//
+// the temporary registers:
+//
+#define VM_REG_LHS 0
+#define VM_REG_RHS 1
+
+//
+// An operand >= 0 is a register, an operand < 0 is the
+// variable in the given slot. Reading a variable operand
+// reads memory, writing one writes memory:
+//
+#define VM_VAR_OPERAND(slot)     (-1 - (slot))
+#define VM_OPERAND_SLOT(operand) (-1 - (operand))
+
+struct VM_INSTR
+{
+  int op;    // enum VM_OPS
+  int line;  // line # of the statement, for error messages
+  int a;
+  int b;
+  int c;
+  int d;
+};
+
+//
+// The counters of a site: a hit is an execution of the
+// quickened form, a miss one of the generic form (the first
+// execution, or after the operand types changed):
+//
+struct VM_SITE
+{
+  unsigned long long hits;
+  unsigned long long misses;
+};
+
+//
+// A while loop: LOOP, the test that leaves the loop, the
+// body, the test that repeats the body, and a jump back to
+// LOOP (taken when the loop is done). The JIT compiles the
+// loop the first time it is reached:
+//
+struct VM_LOOP
+{
+  int  top;    // the LOOP instruction
+  int  body;   // first instruction of the body
+  int  exit;   // first instruction after the loop
+  bool tried;  // has the JIT tried to compile it?
+
+  struct JIT_LOOP* jit;  // the compiled loop, NULL if none
+};
+
+struct VM_PROGRAM
+{
+  struct VM_INSTR* code;
+  int    num_instrs;
+  int    code_capacity;
+
+  struct BOXED_VALUE* registers;  // temporaries, then constants
+  int    num_registers;
+  int    register_capacity;
+
+  struct RUNTIME_VAR* vars;  // the variable slots
+  int    num_vars;
+  int    var_capacity;
+
+  struct VM_SITE* sites;  // counters, one per instruction
+
+  struct VM_LOOP* loops;  // the while loops
+  int    num_loops;
+  int    loop_capacity;
+};
+
+
+//
+// Public functions:
+//
+
+//
+// vm_compile
+//
+// Given a nuPython program graph, compiles it and returns a
+// pointer to the dynamically-allocated program.
+//
+// NOTE: the compiled program refers to names and strings in
+// the program graph, so the graph must outlive the program.
+//
+struct VM_PROGRAM* vm_compile(struct STMT* program);
+
+//
+// vm_execute
+//
+// Executes the compiled program against the given memory,
+// exactly as execute() would execute the program graph. If
+// a semantic error occurs, an error message is output and
+// execution stops. The program can be executed again.
+//
+void vm_execute(struct VM_PROGRAM* program, struct RAM* memory);
+
+//
+// vm_print_stats
+//
+// Outputs the counters of every site that has executed, with
+// the form it is quickened to now. The counters accumulate
+// over all the executions of the program.
+//
+void vm_print_stats(struct VM_PROGRAM* program);
+
+//
+// vm_destroy
+//
+// Frees all the memory associated with the compiled program.
+//
+void vm_destroy(struct VM_PROGRAM* program);
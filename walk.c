@@ -0,0 +1,134 @@
+/*walk.c*/
+
+//
+// Walking the program graph, see walk.h.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+// to eliminate warnings about stdlib in Visual Studio
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>  // true, false
+#include <string.h>
+#include <assert.h>
+
+#include "programgraph.h"
+#include "walk.h"
+
+
+//
+// Private functions:
+//
+
+//
+// visit_unary
+//
+// Visits the variable of the given unary expression, if any.
+//
+static void visit_unary(struct UNARY_EXPR* unary, void (*visit)(void* context, char* name, int use),
+  void* context)
+{
+  if (unary->element->element_type != ELEMENT_IDENTIFIER)
+    return;
+
+  int use;
+
+  switch (unary->expr_type) {
+  case UNARY_ADDRESS_OF: use = WALK_ADDRESS_OF; break;
+  case UNARY_PTR_DEREF:  use = WALK_DEREF; break;
+  default:               use = WALK_READ; break;
+  }
+
+  visit(context, unary->element->element_value, use);
+}
+
+
+//
+// Public functions:
+//
+
+//
+// walk_next
+//
+int walk_next(struct STMT* stmt, struct STMT* next[2])
+{
+  switch (stmt->stmt_type) {
+  case STMT_ASSIGNMENT:
+    next[0] = stmt->types.assignment->next_stmt;
+    return 1;
+
+  case STMT_FUNCTION_CALL:
+    next[0] = stmt->types.function_call->next_stmt;
+    return 1;
+
+  case STMT_WHILE_LOOP:
+    next[0] = stmt->types.while_loop->loop_body;
+    next[1] = stmt->types.while_loop->next_stmt;
+    return 2;
+
+  case STMT_IF_THEN_ELSE:
+    next[0] = stmt->types.if_then_else->true_path;
+    next[1] = stmt->types.if_then_else->false_path;
+    return 2;
+
+  default:
+    assert(stmt->stmt_type == STMT_PASS);
+    next[0] = stmt->types.pass->next_stmt;
+    return 1;
+  }
+}
+
+//
+// walk_vars
+//
+void walk_vars(struct STMT* stmt, void (*visit)(void* context, char* name, int use), void* context)
+{
+  struct VALUE_EXPR* expr = NULL;
+  struct ELEMENT* parameter = NULL;
+
+  if (stmt->stmt_type == STMT_ASSIGNMENT) {
+    struct STMT_ASSIGNMENT* assign = stmt->types.assignment;
+
+    visit(context, assign->var_name, assign->isPtrDeref ? WALK_STORED_VIA : WALK_ASSIGNED);
+
+    if (assign->rhs->value_type == VALUE_FUNCTION_CALL)
+      parameter = assign->rhs->types.function_call->parameter;
+    else
+      expr = assign->rhs->types.expr;
+  }
+  else if (stmt->stmt_type == STMT_FUNCTION_CALL)
+    parameter = stmt->types.function_call->parameter;
+  else if (stmt->stmt_type == STMT_WHILE_LOOP)
+    expr = stmt->types.while_loop->condition;
+  else if (stmt->stmt_type == STMT_IF_THEN_ELSE)
+    expr = stmt->types.if_then_else->condition;
+
+  if (expr != NULL) {
+    visit_unary(expr->lhs, visit, context);
+
+    if (expr->isBinaryExpr)
+      visit_unary(expr->rhs, visit, context);
+  }
+
+  if (parameter != NULL && parameter->element_type == ELEMENT_IDENTIFIER)
+    visit(context, parameter->element_value, WALK_READ);
+}
+
+//
+// walk_var_index
+//
+int walk_var_index(void* vars, int num_vars, size_t var_size, char* name)
+{
+  char* var = (char*)vars;
+
+  for (int i = 0; i < num_vars; i++, var += var_size)
+    if (strcmp(*(char**)var, name) == 0)
+      return i;
+
+  return -1;
+}
@@ -0,0 +1,66 @@
+/*walk.h*/
+
+//
+// Walking the program graph, for the analyses and compilers
+// that go over a whole program ahead of time (see escape.h,
+// ssa.h and transpile.h): which stmts can follow a stmt, and
+// which variables a stmt refers to, and how.
+//
+// Hajo Wolfram
+// Northwestern University
+// CS 211
+//
+
+#pragma once
+
+#include <stddef.h>   // size_t
+
+#include "programgraph.h"
+
+
+//
+// How a stmt refers to a variable (see walk_vars):
+//
+enum WALK_USES
+{
+  WALK_ASSIGNED = 0,  // x = ...
+  WALK_STORED_VIA,    // *x = ..., x is read (a pointer)
+  WALK_READ,          // x
+  WALK_ADDRESS_OF,    // &x
+  WALK_DEREF          // *x
+};
+
+
+//
+// Public functions:
+//
+
+//
+// walk_next
+//
+// Returns the # of stmts that can follow the given one (at
+// most 2, the true path or loop body first), and stores them
+// in next. A stmt is NULL at the end of the program.
+//
+int walk_next(struct STMT* stmt, struct STMT* next[2]);
+
+//
+// walk_vars
+//
+// Calls visit(context, name, use) for each variable the given
+// stmt refers to, in order: the variable assigned, if any,
+// then those in the expression or function call (use is an
+// enum WALK_USES). & and * only apply to variables, so these
+// are also all the uses of pointers.
+//
+void walk_vars(struct STMT* stmt, void (*visit)(void* context, char* name, int use), void* context);
+
+//
+// walk_var_index
+//
+// Returns the index of the variable with the given name in the
+// given array of num_vars variables, -1 if it's not there. Each
+// variable takes var_size bytes, and starts with its name (a
+// char*), as struct RUNTIME_VAR does.
+//
+int walk_var_index(void* vars, int num_vars, size_t var_size, char* name);